@@ -206,7 +206,7 @@ app.get("/user-data/rope", authMiddleware, (req, res) => {
 // ===============================
 app.get("/data/user", authMiddleware, (req, res) => {
     const user = req.session.user;
-    res.json({ username: user.username });
+    res.json({ username: user.username, id: user.id });
 });
 
 // ===============================
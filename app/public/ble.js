@@ -2,31 +2,147 @@
 const JR_SERVICE_UUID = "6e400001-b5a3-f393-e0a9-e50e24dcca9e";
 const JR_CTRL_UUID    = "6e400002-b5a3-f393-e0a9-e50e24dcca9e";
 const JR_DATA_UUID    = "6e400003-b5a3-f393-e0a9-e50e24dcca9e";
+const JR_HRV_UUID     = "6e400004-b5a3-f393-e0a9-e50e24dcca9e";
+const JR_SYNC_UUID    = "6e400005-b5a3-f393-e0a9-e50e24dcca9e";
+const JR_SUMMARY_UUID = "6e400006-b5a3-f393-e0a9-e50e24dcca9e";
+const JR_PARAMS_UUID  = "6e400007-b5a3-f393-e0a9-e50e24dcca9e";
 
-let device, server, ctrlChar, dataChar;
+let device, server, ctrlChar, dataChar, hrvChar, syncChar, summaryChar, paramsChar;
 
 // ---- Simple workout state (no users) ----
 const workout = {
     active: false,
     startMs: 0,
-    lastJumpCount: 0,
-    hrSamples: [],
-    maxHr: 0,
+    lastJumpCount: 0,  // live display only; totals come from the summary
+    lastTs: 0,       // device timestamp of the newest record applied
     deviceName: "JRope-C6",
 };
 
+// ---- Journal sync (records the device stored while we were away) ----
+const JR_SYNC_END_TYPE = 0xff;
+const JR_SYNC_HEADER_SIZE = 6;   // u32 seq, u8 type, u8 len
+const JOURNAL_SAMPLE = 3;        // components/journal/journal.h
+
+const sync = {
+    cursor: null,    // first journal seq of the current workout
+    done: null,      // resolves with the next cursor when a sync ends
+    records: [],
+    bytes: 0,
+};
+
+// ---- Record delivery (telemetry v2+ sequence numbers) ----
+const JR_PACKET_VERSION = 3;
+const JR_RETX_RECORDS = 128;     // JR_BLE_RETX_RECORDS in jr_ble.cpp
+const FILL_TIMEOUT_MS = 2000;    // give up on a gap after this long
+
+const delivery = {
+    nextSeq: null,       // seq expected next (null = take the first one seen)
+    missing: new Map(),  // seq -> when a gap fill was requested
+    lost: 0,             // records that did not arrive live
+    recovered: 0,        // of those, records resent by the device
+    unrecoverable: 0,    // records the device no longer had
+};
+
+// Control writes/reads from background work (gap fills, clock sync) run one
+// at a time; Web Bluetooth rejects overlapping operations on a characteristic
+let ctrlQueue = Promise.resolve();
+
+function ctrlOp(fn) {
+    const op = ctrlQueue.then(fn);
+    ctrlQueue = op.catch(() => {});
+    return op;
+}
+
+// ---- Clock sync (control 0x07 + read; see jr_ble.h) ----
+const CLOCK_SYNC_ROUNDS = 8;          // exchanges per sync, best one kept
+const CLOCK_SYNC_INTERVAL_MS = 30000;
+const CLOCK_MAX_SAMPLES = 20;         // sync points kept for the drift fit
+
+const clock = {
+    samples: [],     // { hostUs, offsetUs }: device clock minus host clock
+    rttUs: null,     // round trip of the newest sync point
+    offsetUs: 0,     // fitted offset at refUs
+    refUs: 0,
+    drift: 0,        // offset change per host us (ppm * 1e-6)
+    token: 0,
+    timer: null,
+    lastEventUs: null,
+    latencyMs: null, // smoothed event-to-screen latency
+    lastLatencyMs: null,
+    jitterMs: 0,     // RFC 3550 style interarrival jitter
+    maxLatencyMs: 0,
+};
+
+// ---- Runtime parameters (control 0x09; components/ble/jr_params.h) ----
+const JR_PARAM_T_GET = 0x01;
+const JR_PARAM_T_SET = 0x02;
+const JR_PARAM_T_VALUE = 0x81;
+const JR_PARAM_T_ERROR = 0xff;
+const JR_PARAM_ALL = 0xff;
+const PARAMS_TIMEOUT_MS = 2000;
+
+// Labels for JR_PARAMS ids; unknown ids are shown by number
+const JR_PARAM_LABELS = {
+    0x01: "Raw flush rate (Hz)",
+    0x02: "Coalesce window (ms)",
+    0x03: "Heartbeat (ms)",
+    0x10: "Jump detector rate (Hz)",
+    0x11: "Display rate (Hz)",
+    0x20: "Jump threshold (x100)",
+    0x21: "Min jump interval (ms)",
+    0x22: "Timing tolerance (ms)",
+    0x23: "Phase timeout (ms)",
+};
+
+const JR_PARAM_ERRORS = ["ok", "unknown parameter", "out of range", "bad length",
+    "unknown item", "response truncated"];
+
+const params = {
+    token: 0,
+    waiting: new Map(), // token -> resolve
+    values: new Map(),  // id -> { value, min, max }
+};
+
+// ---- Reconnect after a dropout (workout running) ----
+const RECONNECT_RETRY_MS = 500;
+const RECONNECT_GIVE_UP_MS = 60000;
+
+const reconnect = {
+    startMs: null,   // when the link dropped (null = not reconnecting)
+    attempts: 0,
+    linkMs: null,    // disconnect -> GATT connected
+    readyMs: null,   // disconnect -> characteristics found and subscribed
+};
+
+// ---- Raw streaming (detector tuning) ----
+const JR_RAW_FRAME_TYPE = 0xa1;
+const JR_RAW_HEADER_SIZE = 12;
+
+const raw = {
+    active: false,
+    frames: [],      // Uint8Array per notification, kept for download
+    samples: 0,
+    bytes: 0,
+    lostFrames: 0,
+    lastSeq: null,
+    startMs: 0,
+};
+
 function nowMs() {
     return Date.now();
 }
 
+// Wall clock in us with sub-ms resolution
+function hostUs() {
+    return (performance.timeOrigin + performance.now()) * 1000;
+}
+
 function isoFromMs(ms) {
     return new Date(ms).toISOString();
 }
 
-function averageInt(arr) {
-    if (!arr.length) return null;
-    const sum = arr.reduce((a, b) => a + b, 0);
-    return Math.round(sum / arr.length);
+function delay(ms) {
+    return new Promise((resolve) => setTimeout(resolve, ms));
 }
 
 function setStatus(msg) {
@@ -37,8 +153,12 @@ function setStatus(msg) {
 function enableControls(connected) {
     const start = document.getElementById("btnStart");
     const stop = document.getElementById("btnStop");
+    const rawBtn = document.getElementById("btnRaw");
+    const paramsBtn = document.getElementById("btnParams");
     if (start) start.disabled = !connected;
     if (stop) stop.disabled = !connected;
+    if (rawBtn) rawBtn.disabled = !connected;
+    if (paramsBtn) paramsBtn.disabled = !connected || !paramsChar;
 }
 
 async function connectBLE() {
@@ -51,14 +171,64 @@ async function connectBLE() {
     device = await navigator.bluetooth.requestDevice({
         filters: [{ services: [JR_SERVICE_UUID] }],
     });
+    device.addEventListener("gattserverdisconnected", onDisconnected);
+    await openGatt();
+}
 
-    device.addEventListener("gattserverdisconnected", () => {
-        setStatus("Disconnected");
-        enableControls(false);
-    });
+function onDisconnected() {
+    // The device keeps recording the workout; reconnect to catch up
+    setStatus(workout.active ? "Disconnected (workout continues on device)" : "Disconnected");
+    enableControls(false);
+    stopClockSync();
+    if (workout.active) {
+        reconnectLoop().catch((e) => setStatus(String(e)));
+    }
+}
 
+// Reconnects to the same device without the chooser. The firmware
+// advertises fast right after a drop, and a bonded device re-encrypts
+// without a prompt, so this usually succeeds on the first attempts.
+async function reconnectLoop() {
+    reconnect.startMs = nowMs();
+    reconnect.attempts = 0;
+    reconnect.linkMs = null;
+    reconnect.readyMs = null;
+    while (workout.active && !device.gatt.connected) {
+        if (nowMs() - reconnect.startMs > RECONNECT_GIVE_UP_MS) {
+            reconnect.startMs = null;
+            setStatus("Disconnected (press Connect to resume the workout)");
+            return;
+        }
+        reconnect.attempts++;
+        try {
+            await openGatt();
+            return;
+        } catch (e) {
+            console.log(`reconnect attempt ${reconnect.attempts} failed`, e);
+            await delay(RECONNECT_RETRY_MS);
+        }
+    }
+}
+
+// Called on the first live record after a reconnect: the whole dropout as
+// the user saw it, split into link, discovery and resume (sync + 0x03).
+function reconnectDone() {
+    const totalMs = nowMs() - reconnect.startMs;
+    reconnect.startMs = null;
+    const text = `Reconnected in ${totalMs} ms (link ${reconnect.linkMs} ms, ` +
+        `discovery ${reconnect.readyMs - reconnect.linkMs} ms, ` +
+        `resume ${totalMs - reconnect.readyMs} ms, ` +
+        `${reconnect.attempts} attempt${reconnect.attempts === 1 ? "" : "s"})`;
+    const el = document.getElementById("reconnectStats");
+    if (el) el.textContent = text;
+    console.log(text);
+}
+
+// Connects to the chosen device and subscribes to its characteristics.
+async function openGatt() {
     setStatus("Connecting...");
     server = await device.gatt.connect();
+    if (reconnect.startMs !== null) reconnect.linkMs = nowMs() - reconnect.startMs;
 
     const service = await server.getPrimaryService(JR_SERVICE_UUID);
     ctrlChar = await service.getCharacteristic(JR_CTRL_UUID);
@@ -67,70 +237,684 @@ async function connectBLE() {
     await dataChar.startNotifications();
     dataChar.addEventListener("characteristicvaluechanged", onData);
 
+    // HRV is optional: older firmware does not expose it
+    try {
+        hrvChar = await service.getCharacteristic(JR_HRV_UUID);
+        await hrvChar.startNotifications();
+        hrvChar.addEventListener("characteristicvaluechanged", onHrv);
+    } catch (e) {
+        hrvChar = null;
+        console.log("HRV characteristic not available");
+    }
+
+    // Sync is optional as well
+    try {
+        syncChar = await service.getCharacteristic(JR_SYNC_UUID);
+        await syncChar.startNotifications();
+        syncChar.addEventListener("characteristicvaluechanged", onSyncData);
+    } catch (e) {
+        syncChar = null;
+        console.log("Sync characteristic not available");
+    }
+
+    // Session summary (aggregated on the device)
+    try {
+        summaryChar = await service.getCharacteristic(JR_SUMMARY_UUID);
+    } catch (e) {
+        summaryChar = null;
+        console.log("Summary characteristic not available");
+    }
+
+    // Runtime parameters
+    try {
+        paramsChar = await service.getCharacteristic(JR_PARAMS_UUID);
+        await paramsChar.startNotifications();
+        paramsChar.addEventListener("characteristicvaluechanged", onParams);
+        await loadParams();
+    } catch (e) {
+        paramsChar = null;
+        console.log("Params characteristic not available");
+    }
+
+    if (reconnect.startMs !== null) reconnect.readyMs = nowMs() - reconnect.startMs;
     setStatus("Connected");
     enableControls(true);
+    startClockSync();
+
+    if (workout.active) {
+        await resumeWorkout();
+    }
+}
+
+// Applies one live or synced sample to the live view.
+function applySample(ts, jumps) {
+    workout.lastTs = ts;
+    workout.lastJumpCount = jumps;
+}
+
+// Session summary layout: components/ble/jr_session.h
+const JR_SESSION_F_FINAL = 0x01;
+const JR_SESSION_F_HR_VALID = 0x02;
+
+async function readSummary() {
+    const v = await ctrlOp(() => summaryChar.readValue());
+    if (v.byteLength < 28) throw new Error("short session summary");
+    const flags = v.getUint8(27);
+    const hrValid = (flags & JR_SESSION_F_HR_VALID) !== 0;
+    return {
+        sessionId: v.getUint32(0, true),
+        durationMs: v.getUint32(4, true),
+        jumps: v.getUint32(8, true),
+        activeMs: v.getUint32(12, true),
+        longestStreak: v.getUint32(16, true),
+        cadenceAvg: v.getUint16(20, true),
+        cadenceMax: v.getUint16(22, true),
+        hrMin: hrValid ? v.getUint8(24) : null,
+        hrAvg: hrValid ? v.getUint8(25) : null,
+        hrMax: hrValid ? v.getUint8(26) : null,
+        final: (flags & JR_SESSION_F_FINAL) !== 0,
+    };
+}
+
+function showSummary(sum) {
+    const el = document.getElementById("sessionSummary");
+    if (!el) return;
+    const hr = sum.hrAvg === null ? "no HR" : `HR ${sum.hrMin}/${sum.hrAvg}/${sum.hrMax} bpm`;
+    el.textContent =
+        `${sum.jumps} jumps in ${(sum.durationMs / 1000).toFixed(0)} s ` +
+        `(active ${(sum.activeMs / 1000).toFixed(0)} s), ` +
+        `cadence ${sum.cadenceAvg}/${sum.cadenceMax} jpm, ` +
+        `longest streak ${sum.longestStreak}, ${hr}`;
+}
+
+function decodeParams(v) {
+    const res = { token: v.getUint8(0), status: v.getUint8(1), values: [], errors: [] };
+    for (let off = 2; off + 2 <= v.byteLength; off += 2 + v.getUint8(off + 1)) {
+        const type = v.getUint8(off);
+        if (type === JR_PARAM_T_VALUE && off + 15 <= v.byteLength) {
+            res.values.push({
+                id: v.getUint8(off + 2),
+                value: v.getUint32(off + 3, true),
+                min: v.getUint32(off + 7, true),
+                max: v.getUint32(off + 11, true),
+            });
+        } else if (type === JR_PARAM_T_ERROR && off + 4 <= v.byteLength) {
+            res.errors.push({ id: v.getUint8(off + 2), error: v.getUint8(off + 3) });
+        }
+    }
+    return res;
+}
+
+function onParams(event) {
+    const res = decodeParams(event.target.value);
+    const resolve = params.waiting.get(res.token);
+    if (resolve) resolve(res);
+}
+
+// Sends one request ([type, len, ...value] items) and waits for its answer;
+// reads the characteristic when the notification does not come.
+async function paramsRequest(items) {
+    const token = params.token = (params.token + 1) & 0xff;
+    const answer = new Promise((resolve) => {
+        params.waiting.set(token, resolve);
+        setTimeout(() => resolve(null), PARAMS_TIMEOUT_MS);
+    });
+    try {
+        await ctrlOp(() => ctrlChar.writeValue(Uint8Array.from([0x09, token, ...items.flat()])));
+        let res = await answer;
+        if (!res) res = decodeParams(await ctrlOp(() => paramsChar.readValue()));
+        if (res.token !== token) throw new Error("no parameter response");
+        for (const p of res.values) params.values.set(p.id, p);
+        return res;
+    } finally {
+        params.waiting.delete(token);
+    }
+}
+
+async function loadParams() {
+    await paramsRequest([[JR_PARAM_T_GET, 1, JR_PARAM_ALL]]);
+    renderParams();
+}
+
+function renderParams() {
+    const el = document.getElementById("params");
+    if (!el) return;
+    el.replaceChildren();
+    for (const [id, p] of [...params.values].sort((a, b) => a[0] - b[0])) {
+        const label = document.createElement("label");
+        label.textContent = `${JR_PARAM_LABELS[id] || `Param 0x${id.toString(16)}`} `;
+        const input = document.createElement("input");
+        Object.assign(input, { type: "number", min: p.min, max: p.max, value: p.value });
+        input.dataset.paramId = id;
+        label.appendChild(input);
+        el.appendChild(label);
+    }
+}
+
+async function handleParamsClick() {
+    const status = document.getElementById("paramsStatus");
+    const items = [];
+    for (const input of document.querySelectorAll("#params input")) {
+        const id = Number(input.dataset.paramId);
+        const value = Number(input.value);
+        if (!params.values.has(id) || params.values.get(id).value === value) continue;
+        const b = new Uint8Array(4);
+        new DataView(b.buffer).setUint32(0, value >>> 0, true);
+        items.push([JR_PARAM_T_SET, 5, id, ...b]);
+    }
+    if (items.length === 0) return;
+    try {
+        const res = await paramsRequest(items);
+        const err = res.errors[0];
+        if (status) {
+            status.textContent = res.status === 0
+                ? "Saved on the device"
+                : `Not applied: ${JR_PARAM_LABELS[err ? err.id : 0] || ""} ` +
+                  `${JR_PARAM_ERRORS[res.status] || res.status}`;
+        }
+        renderParams();
+    } catch (e) {
+        if (status) status.textContent = String(e);
+    }
+}
+
+function resetDelivery() {
+    delivery.nextSeq = null;
+    delivery.missing.clear();
+}
+
+// Asks the device to resend [first, first + count) (control 0x06).
+function requestFill(first, count) {
+    delivery.lost += count;
+    if (count > JR_RETX_RECORDS) {
+        // Older than anything the device keeps
+        delivery.unrecoverable += count - JR_RETX_RECORDS;
+        first = (first + count - JR_RETX_RECORDS) >>> 0;
+        count = JR_RETX_RECORDS;
+    }
+    const now = nowMs();
+    for (let i = 0; i < count; i++) delivery.missing.set((first + i) >>> 0, now);
+
+    const cmd = new DataView(new ArrayBuffer(7));
+    cmd.setUint8(0, 0x06);
+    cmd.setUint32(1, first, true);
+    cmd.setUint16(5, count, true);
+    ctrlOp(() => ctrlChar.writeValue(cmd))
+        .catch((e) => console.warn("gap fill request failed", e));
+}
+
+// Classifies a record by seq: "live", "filled" (a resent gap) or "dup".
+function trackSeq(seq) {
+    if (delivery.nextSeq === null || seq === delivery.nextSeq) {
+        delivery.nextSeq = (seq + 1) >>> 0;
+        return "live";
+    }
+    const ahead = (seq - delivery.nextSeq) >>> 0;
+    if (ahead < 0x80000000) {
+        // The records in between were dropped on the way
+        requestFill(delivery.nextSeq, ahead);
+        delivery.nextSeq = (seq + 1) >>> 0;
+        return "live";
+    }
+    if (delivery.missing.delete(seq)) {
+        delivery.recovered++;
+        return "filled";
+    }
+    return "dup";
+}
+
+function expireFills() {
+    const cutoff = nowMs() - FILL_TIMEOUT_MS;
+    for (const [seq, requested] of delivery.missing) {
+        if (requested >= cutoff) break; // Map keeps request order
+        delivery.missing.delete(seq);
+        delivery.unrecoverable++;
+    }
+}
+
+// One NTP-style exchange; resolves to { hostUs, offsetUs, rttUs } or null.
+async function clockExchange() {
+    const token = (clock.token = (clock.token + 1) >>> 0);
+    const cmd = new DataView(new ArrayBuffer(5));
+    cmd.setUint8(0, 0x07);
+    cmd.setUint32(1, token, true);
+
+    const t1 = hostUs();
+    await ctrlChar.writeValue(cmd);
+    const v = await ctrlChar.readValue();
+    const t4 = hostUs();
+    if (v.byteLength < 20 || v.getUint32(0, true) !== token) return null;
+
+    const rx = Number(v.getBigUint64(4, true));
+    const tx = Number(v.getBigUint64(12, true));
+    return {
+        hostUs: (t1 + t4) / 2,
+        offsetUs: ((rx - t1) + (tx - t4)) / 2,
+        rttUs: (t4 - t1) - (tx - rx),
+    };
+}
+
+// Least-squares line through the sync points: offset = offsetUs +
+// drift * (host - refUs). One point means no drift estimate yet.
+function fitClock() {
+    const n = clock.samples.length;
+    const last = clock.samples[n - 1];
+    clock.refUs = last.hostUs;
+    if (n < 2) {
+        clock.offsetUs = last.offsetUs;
+        clock.drift = 0;
+        return;
+    }
+    let sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (const p of clock.samples) {
+        const x = p.hostUs - clock.refUs;
+        sx += x;
+        sy += p.offsetUs;
+        sxx += x * x;
+        sxy += x * p.offsetUs;
+    }
+    const den = n * sxx - sx * sx;
+    clock.drift = den > 0 ? (n * sxy - sx * sy) / den : 0;
+    clock.offsetUs = (sy - clock.drift * sx) / n;
+}
+
+async function clockSync() {
+    if (!ctrlChar) return;
+    let best = null;
+    for (let i = 0; i < CLOCK_SYNC_ROUNDS; i++) {
+        const s = await ctrlOp(() => clockExchange());
+        if (s && (!best || s.rttUs < best.rttUs)) best = s;
+    }
+    if (!best) return;
+    clock.samples.push(best);
+    if (clock.samples.length > CLOCK_MAX_SAMPLES) clock.samples.shift();
+    clock.rttUs = best.rttUs;
+    fitClock();
+    showClockStats();
+}
+
+function startClockSync() {
+    stopClockSync();
+    clock.samples = [];
+    clock.lastEventUs = null;
+    clock.latencyMs = null;
+    clock.lastLatencyMs = null;
+    clock.jitterMs = 0;
+    clock.maxLatencyMs = 0;
+    const run = () => clockSync().catch((e) => console.warn("clock sync failed", e));
+    run();
+    clock.timer = setInterval(run, CLOCK_SYNC_INTERVAL_MS);
+}
+
+function stopClockSync() {
+    if (clock.timer !== null) clearInterval(clock.timer);
+    clock.timer = null;
+}
+
+// Device clock (us since boot) to host wall clock (us), or null before the
+// first sync.
+function deviceToHostUs(deviceUs) {
+    if (!clock.samples.length) return null;
+    // deviceUs = h + offsetUs + drift * (h - refUs), solved for h
+    return (deviceUs - clock.offsetUs + clock.drift * clock.refUs) / (1 + clock.drift);
 }
 
+// Measures how long a state change took from the sensor to this page.
+// Heartbeats repeat the last event time and are skipped.
+function trackLatency(eventUs, receivedUs) {
+    if (eventUs === clock.lastEventUs) return;
+    clock.lastEventUs = eventUs;
+    const eventHostUs = deviceToHostUs(eventUs);
+    if (eventHostUs === null) return;
+
+    const latencyMs = (receivedUs - eventHostUs) / 1000;
+    if (clock.latencyMs === null) {
+        clock.latencyMs = latencyMs;
+    } else {
+        clock.jitterMs += (Math.abs(latencyMs - clock.lastLatencyMs) - clock.jitterMs) / 16;
+        clock.latencyMs += (latencyMs - clock.latencyMs) / 16;
+    }
+    clock.lastLatencyMs = latencyMs;
+    if (latencyMs > clock.maxLatencyMs) clock.maxLatencyMs = latencyMs;
+}
+
+function showClockStats() {
+    const el = document.getElementById("clockStats");
+    if (!el || !clock.samples.length) return;
+    let text = `clock ±${(clock.rttUs / 2000).toFixed(1)} ms, ` +
+        `drift ${(clock.drift * 1e6).toFixed(1)} ppm`;
+    if (clock.latencyMs !== null) {
+        text += `; latency ${clock.latencyMs.toFixed(1)} ms ` +
+            `(jitter ${clock.jitterMs.toFixed(1)}, max ${clock.maxLatencyMs.toFixed(1)})`;
+    }
+    el.textContent = text;
+}
+
+// Layout comes from jr_telemetry.js (generated from jr_telemetry.h); a
+// notification carries one or more records
+const JR_RECORD_SIZE = JR_TELEMETRY_SIZE[JR_PACKET_VERSION];
+
 function onData(event) {
-    const v = event.target.value; // DataView
+    const v = event.target.value; // DataView, N back-to-back records
+    if (raw.active) {
+        onRawFrame(v);
+        return;
+    }
+    const count = Math.floor(v.byteLength / JR_RECORD_SIZE);
+    if (count === 0) return;
+    const receivedUs = hostUs();
+
+    let ts, jumps, hr, spo2, flags;
+    let live = false;
+    for (let i = 0; i < count; i++) {
+        const off = i * JR_RECORD_SIZE;
+        const kind = trackSeq(jrTm.seq(v, off));
+        if (kind === "dup") continue;
+        if (kind === "filled") {
+            // Later records already carry a higher count; the session totals
+            // are kept on the device
+            continue;
+        }
+        ts = jrTm.timestamp_ms(v, off);
+        jumps = jrTm.jump_count(v, off);
+        hr = jrTm.heart_rate_bpm(v, off);
+        spo2 = jrTm.spo2_pct(v, off);
+        flags = jrTm.flags(v, off);
+        live = true;
+        trackLatency(jrTm.event_us(v, off), receivedUs);
+
+        applySample(ts, jumps);
+    }
+    expireFills();
 
-    const ts = v.getUint32(0, true);
-    const jumps = v.getUint32(4, true);
-    const hr = v.getUint8(8);
-    const accelMag = v.getUint16(9, true);
-    const flags = v.getUint8(11);
+    const statsEl = document.getElementById("deliveryStats");
+    if (statsEl && delivery.lost > 0) {
+        statsEl.textContent =
+            `${delivery.lost} records lost, ${delivery.recovered} recovered, ` +
+            `${delivery.unrecoverable} unrecoverable`;
+    }
+    if (!live) return;
+    if (reconnect.startMs !== null && reconnect.readyMs !== null) reconnectDone();
 
-    // Update UI
+    // Update UI with the newest record only
     const jumpsEl = document.getElementById("jumpCount");
     const hrEl = document.getElementById("heartRate");
-    const accelEl = document.getElementById("accelMag");
+    const spo2El = document.getElementById("spo2");
 
     if (jumpsEl) jumpsEl.textContent = String(jumps);
     if (hrEl) hrEl.textContent = hr === 0 ? "-" : String(hr);
-    if (accelEl) accelEl.textContent = String(accelMag);
+    if (spo2El) {
+        spo2El.textContent = flags & JR_TM_F.SPO2_VALID ? String(spo2) : "-";
+    }
 
-    // Track for saving later
-    workout.lastJumpCount = jumps;
-    if (workout.active && typeof hr === "number" && hr > 0) {
-        workout.hrSamples.push(hr);
-        if (hr > workout.maxHr) workout.maxHr = hr;
+    showClockStats();
+
+    console.log({ records: count, ts, jumps, hr, spo2, flags });
+}
+
+// Reads one LEB128 varint; returns [value, nextOffset].
+function readVarint(v, off) {
+    let value = 0;
+    let shift = 0;
+    for (let n = 0; n < 5; n++) {
+        if (off >= v.byteLength) break;
+        const b = v.getUint8(off++);
+        value += (b & 0x7f) * 2 ** shift;
+        if ((b & 0x80) === 0) return [value, off];
+        shift += 7;
     }
+    throw new Error("bad varint");
+}
 
-    console.log({ ts, jumps, hr, accelMag, flags });
+function unzigzag(n) {
+    return n % 2 === 0 ? n / 2 : -(n + 1) / 2;
+}
+
+// Decodes one jr_raw_codec frame (see components/ble/jr_raw_codec.h).
+function decodeRawFrame(v) {
+    if (v.byteLength < JR_RAW_HEADER_SIZE || v.getUint8(0) !== JR_RAW_FRAME_TYPE) {
+        throw new Error("not a raw frame");
+    }
+    const channels = v.getUint8(1);
+    const seq = v.getUint16(2, true);
+    const t0Us = v.getUint32(4, true);
+    const periodUs = v.getUint16(8, true);
+    const count = v.getUint8(10);
+
+    const samples = [];
+    let off = JR_RAW_HEADER_SIZE;
+    let z;
+    let prev = null;
+    for (let i = 0; i < count; i++) {
+        let ts = t0Us;
+        if (prev) {
+            [z, off] = readVarint(v, off);
+            ts = (prev.ts + periodUs + unzigzag(z)) >>> 0;
+        }
+        const values = [];
+        for (let c = 0; c < channels; c++) {
+            [z, off] = readVarint(v, off);
+            values.push(((prev ? prev.values[c] : 0) + unzigzag(z)) << 16 >> 16);
+        }
+        prev = { ts, values };
+        samples.push(prev);
+    }
+    if (off !== v.byteLength) throw new Error("trailing bytes in raw frame");
+    return { seq, periodUs, samples };
+}
+
+function onRawFrame(v) {
+    let frame;
+    try {
+        frame = decodeRawFrame(v);
+    } catch (e) {
+        console.warn(e);
+        return;
+    }
+
+    if (raw.lastSeq !== null) {
+        raw.lostFrames += (frame.seq - raw.lastSeq - 1) & 0xffff;
+    }
+    raw.lastSeq = frame.seq;
+    raw.frames.push(new Uint8Array(v.buffer.slice(v.byteOffset, v.byteOffset + v.byteLength)));
+    raw.samples += frame.samples.length;
+    raw.bytes += v.byteLength;
+
+    const last = frame.samples[frame.samples.length - 1];
+    const accelEl = document.getElementById("accelMag");
+    if (accelEl && last) accelEl.textContent = last.values.join(", ");
+
+    const statsEl = document.getElementById("rawStats");
+    const seconds = (nowMs() - raw.startMs) / 1000;
+    if (statsEl && seconds > 0) {
+        statsEl.textContent =
+            `${(raw.samples / seconds).toFixed(0)} samples/s, ` +
+            `${(raw.bytes / seconds).toFixed(0)} B/s, ` +
+            `${raw.lostFrames} lost frames`;
+    }
+}
+
+async function startRawStreaming(rateHz = 200) {
+    if (!ctrlChar) return;
+    raw.active = true;
+    raw.frames = [];
+    raw.samples = 0;
+    raw.bytes = 0;
+    raw.lostFrames = 0;
+    raw.lastSeq = null;
+    raw.startMs = nowMs();
+    try {
+        await ctrlOp(() => ctrlChar.writeValue(Uint8Array.from([0x02, rateHz & 0xff, rateHz >> 8])));
+    } catch (e) {
+        raw.active = false;
+        throw e;
+    }
+}
+
+// Capture format read by tools/jr_raw_decode: u16 LE length + frame bytes.
+function downloadRawCapture() {
+    const parts = [];
+    for (const f of raw.frames) {
+        parts.push(Uint8Array.from([f.length & 0xff, f.length >> 8]), f);
+    }
+    const url = URL.createObjectURL(new Blob(parts, { type: "application/octet-stream" }));
+    const a = document.createElement("a");
+    a.href = url;
+    a.download = `jr_raw_${isoFromMs(raw.startMs).replace(/[:.]/g, "-")}.bin`;
+    a.click();
+    URL.revokeObjectURL(url);
+}
+
+function onHrv(event) {
+    const v = event.target.value; // DataView, jr_hrv_v1_t
+
+    const ts = v.getUint32(0, true);
+    const rrMs = v.getUint16(4, true);
+    const rmssdMs = v.getUint16(6, true) / 10;
+    const sdnnMs = v.getUint16(8, true) / 10;
+    const intervals = v.getUint16(10, true);
+
+    const rmssdEl = document.getElementById("hrvRmssd");
+    const sdnnEl = document.getElementById("hrvSdnn");
+    // RMSSD needs at least two consecutive intervals to mean anything
+    if (rmssdEl) rmssdEl.textContent = intervals < 2 ? "-" : rmssdMs.toFixed(1);
+    if (sdnnEl) sdnnEl.textContent = intervals < 2 ? "-" : sdnnMs.toFixed(1);
+
+    console.log({ ts, rrMs, rmssdMs, sdnnMs, intervals });
+}
+
+function onSyncData(event) {
+    const v = event.target.value; // DataView, back-to-back journal records
+    sync.bytes += v.byteLength;
+
+    let off = 0;
+    while (off + JR_SYNC_HEADER_SIZE <= v.byteLength) {
+        const seq = v.getUint32(off, true);
+        const type = v.getUint8(off + 4);
+        const len = v.getUint8(off + 5);
+        const body = new DataView(v.buffer, v.byteOffset + off + JR_SYNC_HEADER_SIZE, len);
+        off += JR_SYNC_HEADER_SIZE + len;
+
+        if (type === JR_SYNC_END_TYPE) {
+            if (sync.done) sync.done(seq);
+            sync.done = null;
+            return;
+        }
+        sync.records.push({ seq, type, body });
+    }
+}
+
+// Reads the journal range: [oldest, next).
+async function readJournalRange() {
+    const v = await syncChar.readValue();
+    return { oldest: v.getUint32(0, true), next: v.getUint32(4, true) };
+}
+
+// Pulls every journal record from cursor on; resolves with the next cursor.
+async function syncFrom(cursor) {
+    sync.records = [];
+    sync.bytes = 0;
+    const finished = new Promise((resolve) => { sync.done = resolve; });
+    const cmd = new DataView(new ArrayBuffer(5));
+    cmd.setUint8(0, 0x01);
+    cmd.setUint32(1, cursor, true);
+    await syncChar.writeValue(cmd);
+    return finished;
+}
+
+// After a reconnect: fill the gap from the journal, then go live again.
+async function resumeWorkout() {
+    if (syncChar && sync.cursor !== null) {
+        setStatus("Syncing missed data...");
+        const started = nowMs();
+        const next = await syncFrom(sync.cursor);
+
+        let applied = 0;
+        for (const r of sync.records) {
+            if (r.type !== JOURNAL_SAMPLE || r.body.byteLength < 10) continue;
+            const ts = r.body.getUint32(0, true);
+            if (ts <= workout.lastTs) continue; // already seen live
+            applySample(ts, r.body.getUint32(4, true));
+            applied++;
+        }
+        sync.cursor = next;
+
+        const seconds = Math.max((nowMs() - started) / 1000, 0.001);
+        console.log(`sync: ${sync.records.length} records (${applied} new), ` +
+            `${(sync.bytes / 1024 / seconds).toFixed(1)} KB/s`);
+
+        const jumpsEl = document.getElementById("jumpCount");
+        if (jumpsEl) jumpsEl.textContent = String(workout.lastJumpCount);
+    }
+    resetDelivery();
+    await ctrlOp(() => ctrlChar.writeValue(Uint8Array.from([0x03, JR_PACKET_VERSION])));
+    setStatus("Connected");
+}
+
+// ---- Jump profile (control 0x0A; see jr_ble.h) ----
+// The device keeps jump calibration per user id, so a session started for a
+// signed-in user judges the first jumps at that user's level. 0 = anonymous.
+let profileUserId = null;
+
+async function loadProfileUserId() {
+    if (profileUserId !== null) return profileUserId;
+    try {
+        const res = await fetch("/data/user", { credentials: "include" });
+        if (!res.ok) return 0;
+        profileUserId = ((await res.json()).id >>> 0) || 0;
+    } catch (e) {
+        return 0;
+    }
+    return profileUserId;
+}
+
+async function sendProfileUser() {
+    const userId = await loadProfileUserId();
+    if (userId === 0) return;
+    const cmd = new Uint8Array(5);
+    cmd[0] = 0x0a;
+    new DataView(cmd.buffer).setUint32(1, userId, true);
+    // Older firmware rejects 0x0A; the session then starts from scratch
+    await ctrlOp(() => ctrlChar.writeValue(cmd))
+        .catch(e => console.warn("user id not sent", e));
 }
 
 async function startStreaming() {
     if (!ctrlChar) return;
-    await ctrlChar.writeValue(Uint8Array.from([0x01]));
+    resetDelivery();
+    delivery.lost = 0;
+    delivery.recovered = 0;
+    delivery.unrecoverable = 0;
+    await sendProfileUser();
+    await ctrlOp(() => ctrlChar.writeValue(Uint8Array.from([0x01, JR_PACKET_VERSION])));
 }
 
 async function stopStreaming() {
     if (!ctrlChar) return;
-    await ctrlChar.writeValue(Uint8Array.from([0x00]));
+    await ctrlOp(() => ctrlChar.writeValue(Uint8Array.from([0x00])));
+    raw.active = false;
 }
 
 function startWorkout() {
     workout.active = true;
     workout.startMs = nowMs();
-    workout.hrSamples = [];
-    workout.maxHr = 0;
     workout.lastJumpCount = 0;
+    workout.lastTs = 0;
 }
 
-async function saveWorkoutToDb() {
+// sum is the device's session summary, or null when it could not be read
+// (then only the last live count is known).
+async function saveWorkoutToDb(sum) {
     const endMs = nowMs();
-    const durationMs = endMs - workout.startMs;
-
-    const avgHr = averageInt(workout.hrSamples);
-    const maxHr = workout.hrSamples.length ? workout.maxHr : null;
+    const durationMs = sum ? sum.durationMs : endMs - workout.startMs;
 
     const payload = {
-        start_time: isoFromMs(workout.startMs),
+        start_time: isoFromMs(endMs - durationMs),
         end_time: isoFromMs(endMs),
         duration_ms: durationMs,
-        jump_count: workout.lastJumpCount,
-        avg_heart_rate_bpm: avgHr,
-        max_heart_rate_bpm: maxHr,
+        jump_count: sum ? sum.jumps : workout.lastJumpCount,
+        avg_heart_rate_bpm: sum ? sum.hrAvg : null,
+        max_heart_rate_bpm: sum ? sum.hrMax : null,
         device_name: workout.deviceName,
     };
 
@@ -151,20 +935,49 @@ async function saveWorkoutToDb() {
 async function handleStartClick() {
     try {
         startWorkout();
+        // Records written from here on belong to this workout
+        sync.cursor = syncChar ? (await readJournalRange()).next : null;
         await startStreaming();
     } catch (e) {
         setStatus(String(e));
     }
 }
 
+async function handleRawClick() {
+    try {
+        if (raw.active) {
+            await stopStreaming();
+            const saveBtn = document.getElementById("btnSaveRaw");
+            if (saveBtn) saveBtn.disabled = raw.frames.length === 0;
+        } else {
+            await startRawStreaming();
+        }
+        const rawBtn = document.getElementById("btnRaw");
+        if (rawBtn) rawBtn.textContent = raw.active ? "Stop raw" : "Raw stream";
+    } catch (e) {
+        setStatus(String(e));
+    }
+}
+
 async function handleStopClick() {
     try {
         workout.active = false;
 
         await stopStreaming();
 
+        // STOP finalized the summary on the device; one read has the totals
+        let sum = null;
+        if (summaryChar) {
+            try {
+                sum = await readSummary();
+                showSummary(sum);
+            } catch (e) {
+                console.warn("session summary read failed", e);
+            }
+        }
+
         // Save workout to DB
-        await saveWorkoutToDb();
+        await saveWorkoutToDb(sum);
 
         // If history.js is present, refresh the table
         if (typeof window.renderHistory === "function") {
@@ -174,10 +987,12 @@ async function handleStopClick() {
         // Optional: reset UI
         const jump_counts = document.getElementById("jumpCount");
         const hr = document.getElementById("heartRate");
+        const spo2 = document.getElementById("spo2");
         const acceleration = document.getElementById("accelMag");
 
         if (jump_counts) jump_counts.textContent = "0";
         if (hr) hr.textContent = "-";
+        if (spo2) spo2.textContent = "-";
         if (acceleration) acceleration.textContent = "0";
     } catch (e) {
         setStatus(String(e));
@@ -193,6 +1008,14 @@ function initBLE() {
     if (btnStart) btnStart.addEventListener("click", () => handleStartClick());
     if (btnStop) btnStop.addEventListener("click", () => handleStopClick());
 
+    const btnRaw = document.getElementById("btnRaw");
+    const btnSaveRaw = document.getElementById("btnSaveRaw");
+    if (btnRaw) btnRaw.addEventListener("click", () => handleRawClick());
+    if (btnSaveRaw) btnSaveRaw.addEventListener("click", () => downloadRawCapture());
+
+    const btnParams = document.getElementById("btnParams");
+    if (btnParams) btnParams.addEventListener("click", () => handleParamsClick());
+
     setStatus("Disconnected");
     enableControls(false);
 }
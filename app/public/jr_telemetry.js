@@ -0,0 +1,42 @@
+// Generated by tools/jr_schema_gen from components/ble/jr_telemetry.h; do not edit.
+// Telemetry records are little-endian and read in place from the notification's
+// DataView.
+
+const JR_TELEMETRY_VERSION = 3;
+
+// Bytes per record, by version
+const JR_TELEMETRY_SIZE = [0, 12, 16, 24];
+
+const JR_TM_F = {
+    HR_VALID: 0x01, // heart_rate_bpm is a valid reading
+    SPO2_VALID: 0x02, // spo2_pct is a valid reading
+    CALIBRATING: 0x04, // the jump detector is calibrating
+};
+
+// Field readers: jrTm.<field>(view, record offset)
+const jrTm = {
+    timestamp_ms: (v, off) => v.getUint32(off + 0, true), // v1+: ms since boot
+    jump_count: (v, off) => v.getUint32(off + 4, true), // v1+: jumps; relative to START with reset-on-start
+    heart_rate_bpm: (v, off) => v.getUint8(off + 8), // v1+: 0 = invalid
+    spo2_pct: (v, off) => v.getUint16(off + 9, true), // v1+: SpO2 in percent, 0 = invalid
+    flags: (v, off) => v.getUint8(off + 11), // v1+: JR_TM_F_* bits
+    seq: (v, off) => v.getUint32(off + 12, true), // v2+: record sequence number (gap fill)
+    event_us: (v, off) => Number(v.getBigUint64(off + 16, true)), // v3+: device us since boot when the state changed
+};
+
+// Decodes the record at off; fields newer than version are left out.
+function jrTelemetryDecode(v, off, version) {
+    const r = {};
+    r.timestamp_ms = v.getUint32(off + 0, true);
+    r.jump_count = v.getUint32(off + 4, true);
+    r.heart_rate_bpm = v.getUint8(off + 8);
+    r.spo2_pct = v.getUint16(off + 9, true);
+    r.flags = v.getUint8(off + 11);
+    if (version >= 2) {
+        r.seq = v.getUint32(off + 12, true);
+    }
+    if (version >= 3) {
+        r.event_us = Number(v.getBigUint64(off + 16, true));
+    }
+    return r;
+}
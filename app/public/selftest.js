@@ -0,0 +1,283 @@
+// ===== BLE link self-test (control 0x08; see components/ble/jr_ble.h) =====
+// The device sends synthetic frames at a fixed rate and size through its
+// normal notify path and reports what it could not send; this page measures
+// what arrived and puts the two side by side.
+const JR_SERVICE_UUID = "6e400001-b5a3-f393-e0a9-e50e24dcca9e";
+const JR_CTRL_UUID    = "6e400002-b5a3-f393-e0a9-e50e24dcca9e";
+const JR_DATA_UUID    = "6e400003-b5a3-f393-e0a9-e50e24dcca9e";
+
+const JR_SELFTEST_FRAME_TYPE = 0xa8;
+const JR_SELFTEST_REPORT_TYPE = 0xa9;
+const JR_SELFTEST_HEADER_SIZE = 12;   // jr_selftest_frame_t
+
+let device, ctrlChar, dataChar;
+
+const test = {
+    running: false,
+    rateHz: 0,
+    size: 0,
+    startUs: 0,          // host time of the first frame
+    lastUs: 0,           // host time of the newest frame
+    frames: 0,
+    bytes: 0,
+    lastSeq: null,
+    gaps: 0,             // frames missing between received seqs
+    reordered: 0,
+    corrupt: 0,          // payload pattern mismatches
+    lastTransitUs: null, // arrival minus device send time (offset included)
+    jitterUs: 0,         // RFC 3550 style interarrival jitter
+    minTransitUs: null,
+    maxDelayUs: 0,       // transit above the fastest frame seen
+    intervals: [],       // inter-arrival gaps (us)
+    report: null,
+};
+
+// Wall clock in us with sub-ms resolution
+function hostUs() {
+    return (performance.timeOrigin + performance.now()) * 1000;
+}
+
+function setStatus(msg) {
+    const el = document.getElementById("bleStatus");
+    if (el) el.textContent = msg;
+}
+
+function setText(id, text) {
+    const el = document.getElementById(id);
+    if (el) el.textContent = text;
+}
+
+function inputInt(id, fallback) {
+    const el = document.getElementById(id);
+    const n = el ? parseInt(el.value, 10) : NaN;
+    return Number.isFinite(n) ? n : fallback;
+}
+
+function enableControls(connected) {
+    document.getElementById("btnTest").disabled = !connected || test.running;
+    document.getElementById("btnStopTest").disabled = !connected || !test.running;
+}
+
+async function connectBLE() {
+    if (!navigator.bluetooth) {
+        setStatus("Web Bluetooth not supported in this browser.");
+        return;
+    }
+
+    setStatus("Requesting device...");
+    device = await navigator.bluetooth.requestDevice({
+        filters: [{ services: [JR_SERVICE_UUID] }],
+    });
+    device.addEventListener("gattserverdisconnected", () => {
+        test.running = false;
+        setStatus("Disconnected");
+        enableControls(false);
+    });
+
+    setStatus("Connecting...");
+    const server = await device.gatt.connect();
+    const service = await server.getPrimaryService(JR_SERVICE_UUID);
+    ctrlChar = await service.getCharacteristic(JR_CTRL_UUID);
+    dataChar = await service.getCharacteristic(JR_DATA_UUID);
+    await dataChar.startNotifications();
+    dataChar.addEventListener("characteristicvaluechanged", onData);
+
+    setStatus("Connected");
+    enableControls(true);
+}
+
+function resetTest(rateHz, size) {
+    Object.assign(test, {
+        running: true, rateHz, size, startUs: 0, lastUs: 0, frames: 0,
+        bytes: 0, lastSeq: null, gaps: 0, reordered: 0, corrupt: 0,
+        lastTransitUs: null, jitterUs: 0, minTransitUs: null, maxDelayUs: 0,
+        intervals: [], report: null,
+    });
+    setText("deviceReport", "");
+    setText("diagnosis", "");
+}
+
+async function startTest() {
+    const rateHz = inputInt("testRate", 100);
+    const size = inputInt("testSize", 244);
+    const seconds = inputInt("testSeconds", 10);
+
+    resetTest(rateHz, size);
+    enableControls(true);
+    const cmd = new Uint8Array(7);
+    const v = new DataView(cmd.buffer);
+    cmd[0] = 0x08;
+    v.setUint16(1, rateHz, true);
+    v.setUint16(3, size, true);
+    v.setUint16(5, seconds, true);
+    try {
+        await ctrlChar.writeValue(cmd);
+        setStatus(`Testing ${rateHz} Hz x ${size} B for ${seconds} s...`);
+    } catch (e) {
+        test.running = false;
+        enableControls(true);
+        setStatus(`Self-test rejected: ${e}`);
+    }
+}
+
+async function stopTest() {
+    await ctrlChar.writeValue(Uint8Array.from([0x08]));
+}
+
+function onData(event) {
+    const v = event.target.value;
+    const type = v.getUint8(0);
+    if (type === JR_SELFTEST_FRAME_TYPE && v.byteLength >= JR_SELFTEST_HEADER_SIZE) {
+        onFrame(v, hostUs());
+    } else if (type === JR_SELFTEST_REPORT_TYPE && v.byteLength >= 56) {
+        onReport(v);
+    }
+}
+
+function onFrame(v, rxUs) {
+    const seq = v.getUint16(2, true);
+    const sendUs = v.getUint32(8, true);
+
+    if (test.frames === 0) test.startUs = rxUs;
+    else test.intervals.push(rxUs - test.lastUs);
+    test.lastUs = rxUs;
+    test.frames++;
+    test.bytes += v.byteLength;
+
+    if (test.lastSeq !== null) {
+        const step = (seq - test.lastSeq) & 0xffff;
+        if (step === 0 || step > 0x8000) test.reordered++;
+        else test.gaps += step - 1;
+    }
+    test.lastSeq = seq;
+
+    for (let i = JR_SELFTEST_HEADER_SIZE; i < v.byteLength; i++) {
+        if (v.getUint8(i) !== ((seq + i) & 0xff)) {
+            test.corrupt++;
+            break;
+        }
+    }
+
+    // Transit carries the unknown clock offset, so only its variation counts
+    const transitUs = rxUs - sendUs;
+    if (test.lastTransitUs !== null) {
+        const d = Math.abs(transitUs - test.lastTransitUs);
+        test.jitterUs += (d - test.jitterUs) / 16;
+    }
+    test.lastTransitUs = transitUs;
+    if (test.minTransitUs === null || transitUs < test.minTransitUs) {
+        test.minTransitUs = transitUs;
+    }
+    test.maxDelayUs = Math.max(test.maxDelayUs, transitUs - test.minTransitUs);
+
+    if (test.frames % 16 === 0) showReceived();
+}
+
+function percentile(sorted, p) {
+    if (sorted.length === 0) return 0;
+    return sorted[Math.min(sorted.length - 1, Math.floor(p * sorted.length))];
+}
+
+function showReceived() {
+    const seconds = (test.lastUs - test.startUs) / 1e6;
+    const gaps = test.intervals.slice().sort((a, b) => a - b);
+    setText("receivedStats",
+        `${test.frames} frames, ` +
+        `${seconds > 0 ? ((test.frames - 1) / seconds).toFixed(1) : "-"} frames/s, ` +
+        `${seconds > 0 ? (test.bytes / seconds / 1024).toFixed(1) : "-"} KB/s, ` +
+        `${test.gaps} missing, ${test.reordered} out of order, ${test.corrupt} corrupt; ` +
+        `inter-arrival p50/p99/max ${(percentile(gaps, 0.5) / 1000).toFixed(1)}/` +
+        `${(percentile(gaps, 0.99) / 1000).toFixed(1)}/` +
+        `${(percentile(gaps, 1) / 1000).toFixed(1)} ms, ` +
+        `jitter ${(test.jitterUs / 1000).toFixed(2)} ms, ` +
+        `max extra delay ${(test.maxDelayUs / 1000).toFixed(1)} ms`);
+}
+
+function decodeReport(v) {
+    return {
+        reason: v.getUint8(1),
+        tickHz: v.getUint16(2, true),
+        rateHz: v.getUint16(4, true),
+        size: v.getUint16(6, true),
+        elapsedMs: v.getUint32(8, true),
+        due: v.getUint32(12, true),
+        sent: v.getUint32(16, true),
+        skipped: v.getUint32(20, true),
+        poolEmpty: v.getUint32(24, true),
+        hostNomem: v.getUint32(28, true),
+        hostOther: v.getUint32(32, true),
+        lastRc: v.getInt16(36, true),
+        poolMinFree: v.getUint16(38, true),
+        lateAvgUs: v.getUint32(40, true),
+        lateMaxUs: v.getUint32(44, true),
+        callAvgUs: v.getUint32(48, true),
+        callMaxUs: v.getUint32(52, true),
+    };
+}
+
+function onReport(v) {
+    const r = decodeReport(v);
+    test.report = r;
+    test.running = false;
+    enableControls(true);
+    showReceived();
+
+    setText("deviceReport",
+        `${r.reason ? "Stopped" : "Done"} after ${(r.elapsedMs / 1000).toFixed(1)} s ` +
+        `(${r.rateHz} Hz x ${r.size} B, tick ${r.tickHz} Hz): ` +
+        `${r.due} due, ${r.sent} sent, ${r.skipped} skipped, ` +
+        `${r.poolEmpty} pool empty (min free ${r.poolMinFree}), ` +
+        `${r.hostNomem} host ENOMEM, ${r.hostOther} other (last rc ${r.lastRc}); ` +
+        `late avg/max ${(r.lateAvgUs / 1000).toFixed(2)}/${(r.lateMaxUs / 1000).toFixed(1)} ms, ` +
+        `notify call avg/max ${r.callAvgUs}/${r.callMaxUs} us`);
+    setText("diagnosis", diagnose(r).join(" "));
+    setStatus("Connected");
+}
+
+// Names the stage that lost or delayed frames, from the device's counters
+// and what arrived here.
+function diagnose(r) {
+    const notes = [];
+    const periodUs = 1e6 / r.rateHz;
+    const tickUs = 1e6 / r.tickHz;
+    const arrivedRate = test.frames / (r.elapsedMs / 1000);
+
+    if (r.skipped > 0 || r.lateAvgUs > periodUs / 2) {
+        notes.push(`Scheduler: the notify task ran ${(r.lateAvgUs / 1000).toFixed(1)} ms late on ` +
+            `average and skipped ${r.skipped} frames` +
+            (periodUs < tickUs ? ` (period ${(periodUs / 1000).toFixed(1)} ms is below ` +
+                `the ${(tickUs / 1000).toFixed(0)} ms tick, so frames go out in bursts).` : "."));
+    }
+    if (r.poolEmpty > 0) {
+        notes.push(`Buffers: the notify pool was empty for ${r.poolEmpty} frames; ` +
+            "the host is not returning blocks as fast as they are used (NOTIFY_BLOCK_COUNT).");
+    }
+    if (r.hostNomem > 0) {
+        notes.push(`Host: NimBLE refused ${r.hostNomem} notifications for lack of ` +
+            "ACL/msys buffers (CONFIG_BT_NIMBLE_MSYS_* / ACL buffer count).");
+    }
+    if (r.hostOther > 0) {
+        notes.push(`Host: ${r.hostOther} notifications failed with rc ${r.lastRc}.`);
+    }
+    const lostAfterSend = r.sent - test.frames;
+    if (lostAfterSend > 0) {
+        notes.push(`Link: ${lostAfterSend} frames the host accepted never arrived here.`);
+    }
+    if (notes.length === 0) {
+        notes.push(`Every frame arrived (${arrivedRate.toFixed(1)} of ${r.rateHz} Hz requested); ` +
+            `jitter ${(test.jitterUs / 1000).toFixed(2)} ms is the link and the browser.`);
+    }
+    return notes;
+}
+
+function initSelfTest() {
+    document.getElementById("btnConnect").addEventListener("click",
+        () => connectBLE().catch(e => setStatus(String(e))));
+    document.getElementById("btnTest").addEventListener("click", () => startTest());
+    document.getElementById("btnStopTest").addEventListener("click",
+        () => stopTest().catch(e => setStatus(String(e))));
+    setStatus("Disconnected");
+    enableControls(false);
+}
+
+document.addEventListener("DOMContentLoaded", initSelfTest);
@@ -0,0 +1,57 @@
+#include "jr_adv_codec.h"
+
+/*
+ * components/ble/jr_adv_codec.cpp
+ *
+ * Manufacturer data encoder/decoder for broadcast mode.
+ */
+
+static inline void put_u16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v) {
+  put_u16(p, (uint16_t)v);
+  put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static inline uint16_t get_u16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get_u32(const uint8_t *p) {
+  return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+size_t jr_adv_encode(const jr_adv_state_t *s, uint8_t *buf, size_t cap) {
+  if (cap < JR_ADV_MFG_SIZE) {
+    return 0;
+  }
+
+  put_u16(buf, JR_ADV_COMPANY_ID);
+  buf[2] = JR_ADV_FRAME_TYPE;
+  buf[3] = s->seq;
+  put_u16(buf + 4, s->rope_id);
+  put_u32(buf + 6, s->jump_count);
+  put_u16(buf + 10, s->cadence_jpm);
+  buf[12] = s->heart_rate_bpm;
+  buf[13] = s->flags;
+  return JR_ADV_MFG_SIZE;
+}
+
+bool jr_adv_decode(const uint8_t *buf, size_t len, jr_adv_state_t *out) {
+  // Longer payloads are accepted so later versions can append fields
+  if (len < JR_ADV_MFG_SIZE || get_u16(buf) != JR_ADV_COMPANY_ID ||
+      buf[2] != JR_ADV_FRAME_TYPE) {
+    return false;
+  }
+
+  out->seq = buf[3];
+  out->rope_id = get_u16(buf + 4);
+  out->jump_count = get_u32(buf + 6);
+  out->cadence_jpm = get_u16(buf + 10);
+  out->heart_rate_bpm = buf[12];
+  out->flags = buf[13];
+  return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+/*
+ * components/ble/jr_adv_codec.h
+ *
+ * Broadcast (group mode) advertising payload codec (no ESP-IDF dependencies;
+ * also built into the host decoder in tools/jr_adv_decode.cpp and its test,
+ * tools/jr_adv_test.cpp).
+ *
+ * In broadcast mode every rope puts its live state into the manufacturer
+ * specific data of its advertisements, so one passive scanner can follow any
+ * number of ropes without connecting:
+ *
+ *   u16 company_id   JR_ADV_COMPANY_ID
+ *   u8  type         JR_ADV_FRAME_TYPE
+ *   u8  seq          increments on every payload change; wraps
+ *   u16 rope_id      low bytes of the rope's BT address
+ *   u32 jump_count   session-relative
+ *   u16 cadence_jpm  jumps per minute, 0 when idle
+ *   u8  heart_rate   bpm, 0 when invalid
+ *   u8  flags        JR_ADV_F_*
+ *
+ * All fields are little-endian.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 0xFFFF is the Bluetooth SIG id reserved for testing; an assigned company id
+// goes here for production.
+#define JR_ADV_COMPANY_ID 0xFFFF
+#define JR_ADV_FRAME_TYPE 0x4A
+#define JR_ADV_MFG_SIZE 14
+
+#define JR_ADV_F_SESSION 0x01 // a workout session is active
+#define JR_ADV_F_HR_VALID 0x02
+
+typedef struct {
+  uint8_t seq;
+  uint16_t rope_id;
+  uint32_t jump_count;
+  uint16_t cadence_jpm;
+  uint8_t heart_rate_bpm;
+  uint8_t flags;
+} jr_adv_state_t;
+
+// Writes the manufacturer data (company id included) into buf. Returns
+// JR_ADV_MFG_SIZE, or 0 when cap is too small.
+size_t jr_adv_encode(const jr_adv_state_t *s, uint8_t *buf, size_t cap);
+
+// Parses manufacturer data (company id included). Returns false when it is
+// not a jump rope broadcast.
+bool jr_adv_decode(const uint8_t *buf, size_t len, jr_adv_state_t *out);
+
+// Payload updates a scanner missed between two received sequence numbers.
+static inline uint8_t jr_adv_missed(uint8_t prev_seq, uint8_t seq) {
+  return (uint8_t)(seq - prev_seq - 1);
+}
+
+#ifdef __cplusplus
+}
+#endif
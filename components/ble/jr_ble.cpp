@@ -8,9 +8,104 @@
  * Goal: stream workout data to the browser via Web Bluetooth notifications.
  *
  * Characteristics:
- * - Control (UUID ...0002): write 0x01 => Start streaming; write 0x00 => Stop
- * streaming
- * - Data    (UUID ...0003): notify/read => jr_packet_v1_t (12 bytes)
+ * - Control (UUID ...0002): write 0x01 [u8 version] => Start streaming; write
+ * 0x00 => Stop streaming; write 0x02 [u16 rate_hz] => Start raw streaming;
+ * write 0x03 [u8 version] => Resume streaming in the current session; write
+ * 0x06 [u32 seq, u16 count] => Resend v2 records; write 0x07 [u32 token] then
+ * read => clock sync timestamps (jr_clock_sync_v1_t)
+ * - Data    (UUID ...0003): notify => telemetry records (jr_telemetry.h),
+ * version 1 (12 bytes), 2 (16 bytes, with seq) or 3 (24 bytes, with the
+ * event time in us); read => one version 1 record
+ * - HRV     (UUID ...0004): notify/read => jr_hrv_v1_t (12 bytes), one
+ * notification per detected beat
+ * - Sync    (UUID ...0005): write/notify/read => bulk transfer of stored
+ * records from a client cursor (jr_sync_source_t)
+ * - Summary (UUID ...0006): read => session aggregates (jr_session.h),
+ * final after STOP
+ * - Params  (UUID ...0007): notify/read => response to the last control 0x09
+ * [u8 token, TLV items] (jr_params.h)
+ *
+ * Batching:
+ * - notify_task sleeps until the firmware reports a state change (new jump
+ * count, HR update, HRV beat). Each change appends one record; records are
+ * packed back-to-back into one notification, as many as fit the negotiated
+ * ATT MTU. A batch is flushed when full or JR_BLE_COALESCE_MS after its first
+ * record. Without changes a heartbeat record goes out every
+ * JR_BLE_HEARTBEAT_MS so the client can tell the link is alive.
+ * - Records are staged once and encoded once per flush (once per distinct
+ * baseline, normally one) into a flat buffer; every subscribed client gets a
+ * copy of it in an mbuf from a dedicated, statically allocated pool, so there
+ * is no per-notification heap use. The host consumes each mbuf it is given,
+ * so that copy is the only per-client work.
+ * - Every record gets a sequence number when it is staged, and staging
+ * happens in a ring that keeps the last JR_BLE_RETX_RECORDS records. Clients
+ * on packet version 2 see the seq, so a notification the pool or the host
+ * dropped shows up as a gap; control 0x06 resends the range from the ring.
+ *
+ * Raw streaming:
+ * - The data characteristic carries jr_raw_codec frames instead of
+ * telemetry records. Samples are pushed by the firmware through
+ * jr_ble_push_raw() and encoded once by notify_task, then fanned out to the
+ * raw clients through the same pool. The frame rate is the highest rate any
+ * raw client asked for.
+ *
+ * Self-test:
+ * - Control 0x08 turns one client's stream into synthetic frames at a fixed
+ * rate and size, sent by notify_task through notify_copy() like live data.
+ * Per frame it records how late the task ran against the schedule, how long
+ * the notify call took and what it returned, telling an empty notify pool
+ * apart from a host that is out of buffers. The totals are logged and
+ * notified as a jr_selftest_report_t when the test ends.
+ *
+ * Connections:
+ * - Up to JR_BLE_MAX_CONN centrals (e.g. the athlete's phone and a coach's
+ * laptop) stay connected at once. Each has its own slot in the connection
+ * table: subscriptions, stream mode, raw rate, jump baseline and link state.
+ * Advertising continues while a slot is free.
+ * - Sync and the bulk channel serve one client at a time.
+ *
+ * Link policy:
+ * - With JR_LINK_AUTO the peripheral asks for the throughput profile (short
+ * interval, 2M PHY, 251-byte LL payloads) on connections that raw stream or
+ * sync, and for the eco profile (long interval + peripheral latency)
+ * otherwise. The parameters each central actually grants are logged from
+ * gap_event_cb.
+ *
+ * Sessions and sync:
+ * - 0x01 starts a session (new id, new baseline); 0x00 ends it. A disconnect
+ * only stops that client's stream, so the firmware keeps recording the
+ * session. After reconnecting, the client pulls what it missed through the
+ * sync characteristic, then sends 0x03 to continue live streaming with the
+ * same baseline. A second client follows a running session the same way:
+ * 0x03 joins it with the session baseline.
+ * - notify_task pumps sync records into pooled mbufs as fast as the host
+ * accepts them; a rejected notification rewinds the cursor, so nothing is
+ * skipped.
+ *
+ * Broadcast (group) mode:
+ * - With jr_ble_set_broadcast(true) the advertisements carry the live count,
+ * cadence and HR as manufacturer data (jr_adv_codec.h), refreshed at most
+ * every JR_BLE_BROADCAST_MS while advertising. The service UUID and name move
+ * to the scan response to make room.
+ *
+ * Bulk transfer (L2CAP CoC):
+ * - When NimBLE is built with CoC support, an L2CAP server listens on
+ * JR_BLE_COC_PSM (also returned by a sync characteristic read). A client that
+ * opened the channel writes control 0x04 [u32 cursor] and receives the same
+ * records as jr_bulk SDUs, paced by L2CAP credits instead of per-notification
+ * ATT overhead. Framing and flow control live in jr_bulk.cpp.
+ *
+ * Bonding and reconnect:
+ * - Just Works bonding with keys in the NVS store. Every connection gets a
+ * Security Request (JR_BLE_REQUEST_BOND); a bonded central re-encrypts with
+ * the stored LTK without user interaction. Streaming never waits for it.
+ * - After a disconnect the central usually reconnects right away: a bonded
+ * central with a fixed address gets a 1.28 s high duty cycle directed burst,
+ * then everyone gets 20-30 ms advertising for JR_BLE_FAST_ADV_MS before the
+ * interval drops to ~0.5 s. Disconnect-to-resume time is logged.
+ * - gatt_layout_check() fingerprints the attribute table and only indicates
+ * Service Changed when it differs from the stored one, so bonded centrals
+ * can keep their discovery cache across reconnects and reboots.
  *
  * Notes:
  * - Packet is little-endian (frontend uses DataView.getUint32(..., true)).
@@ -22,20 +117,30 @@
 #include <cstring>
 #include <inttypes.h>
 
+#include "jr_adv_codec.h"
+#include "jr_bulk.h"
+#include "jr_raw_codec.h"
+#include "jr_session.h"
+
 #include "esp_err.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "nvs.h"
 #include "nvs_flash.h"
 
 #include "host/ble_hs.h"
+#include "host/ble_l2cap.h"
 #include "host/ble_uuid.h"
 #include "nimble/nimble_port.h"
 #include "nimble/nimble_port_freertos.h"
 #include "services/gap/ble_svc_gap.h"
 #include "services/gatt/ble_svc_gatt.h"
 
+// NVS-backed bond store (NimBLE store/config; not in a public header)
+extern "C" void ble_store_config_init(void);
+
 static const char *TAG = "JR_BLE";
 
 /*
@@ -43,6 +148,9 @@ static const char *TAG = "JR_BLE";
  Service: 6e400001-b5a3-f393-e0a9-e50e24dcca9e
  Control: 6e400002-b5a3-f393-e0a9-e50e24dcca9e
  Data:    6e400003-b5a3-f393-e0a9-e50e24dcca9e
+ HRV:     6e400004-b5a3-f393-e0a9-e50e24dcca9e
+ Sync:    6e400005-b5a3-f393-e0a9-e50e24dcca9e
+ Summary: 6e400006-b5a3-f393-e0a9-e50e24dcca9e
 
  Important: BLE_UUID128_INIT uses the little-endian byte order of the UUID.
 */
@@ -58,48 +166,436 @@ static const ble_uuid128_t JR_DATA_UUID =
     BLE_UUID128_INIT(0x9e, 0xca, 0xdc, 0x24, 0x0e, 0xe5, 0xa9, 0xe0, 0x93, 0xf3,
                      0xa3, 0xb5, 0x03, 0x00, 0x40, 0x6e);
 
+static const ble_uuid128_t JR_HRV_UUID =
+    BLE_UUID128_INIT(0x9e, 0xca, 0xdc, 0x24, 0x0e, 0xe5, 0xa9, 0xe0, 0x93, 0xf3,
+                     0xa3, 0xb5, 0x04, 0x00, 0x40, 0x6e);
+
+static const ble_uuid128_t JR_SYNC_UUID =
+    BLE_UUID128_INIT(0x9e, 0xca, 0xdc, 0x24, 0x0e, 0xe5, 0xa9, 0xe0, 0x93, 0xf3,
+                     0xa3, 0xb5, 0x05, 0x00, 0x40, 0x6e);
+
+static const ble_uuid128_t JR_SUMMARY_UUID =
+    BLE_UUID128_INIT(0x9e, 0xca, 0xdc, 0x24, 0x0e, 0xe5, 0xa9, 0xe0, 0x93, 0xf3,
+                     0xa3, 0xb5, 0x06, 0x00, 0x40, 0x6e);
+
+static const ble_uuid128_t JR_PARAMS_UUID =
+    BLE_UUID128_INIT(0x9e, 0xca, 0xdc, 0x24, 0x0e, 0xe5, 0xa9, 0xe0, 0x93, 0xf3,
+                     0xa3, 0xb5, 0x07, 0x00, 0x40, 0x6e);
+
 /* =========================
    CONFIG (demo-friendly)
    ========================= */
 
-// Default notify frequency (Hz). Override with JR_BLE_NOTIFY_HZ at build time.
-#ifndef JR_BLE_NOTIFY_HZ
-#define JR_BLE_NOTIFY_HZ 10
-#endif
-
+// JR_BLE_NOTIFY_HZ, JR_BLE_COALESCE_MS and JR_BLE_HEARTBEAT_MS are the
+// defaults of runtime parameters (jr_params.h); override them at build time.
 #if (JR_BLE_NOTIFY_HZ <= 0)
 #error "JR_BLE_NOTIFY_HZ must be > 0"
 #endif
 
-static inline TickType_t notify_period_ticks(void) {
-  const uint32_t period_ms = (uint32_t)(1000 / JR_BLE_NOTIFY_HZ);
+// Rate at which notify_task drains the raw sample queue (Hz).
+#ifndef JR_BLE_SAMPLE_HZ
+#define JR_BLE_SAMPLE_HZ 50
+#endif
+
+#if (JR_BLE_SAMPLE_HZ < JR_BLE_NOTIFY_HZ)
+#error "JR_BLE_SAMPLE_HZ must be >= JR_BLE_NOTIFY_HZ"
+#endif
+
+#if (JR_BLE_HEARTBEAT_MS <= JR_BLE_COALESCE_MS)
+#error "JR_BLE_HEARTBEAT_MS must be > JR_BLE_COALESCE_MS"
+#endif
+
+// ATT MTU requested from the central; 247 fills one 251-byte LL packet.
+#ifndef JR_BLE_PREFERRED_MTU
+#define JR_BLE_PREFERRED_MTU 247
+#endif
+
+// Centrals served at once; each slot costs one connection in the controller.
+#ifndef JR_BLE_MAX_CONN
+#define JR_BLE_MAX_CONN 2
+#endif
+
+#if (JR_BLE_MAX_CONN < 1)
+#error "JR_BLE_MAX_CONN must be >= 1"
+#endif
+
+#if defined(CONFIG_BT_NIMBLE_MAX_CONNECTIONS) &&                              \
+    (JR_BLE_MAX_CONN > CONFIG_BT_NIMBLE_MAX_CONNECTIONS)
+#error "JR_BLE_MAX_CONN exceeds CONFIG_BT_NIMBLE_MAX_CONNECTIONS"
+#endif
+
+static inline TickType_t sample_period_ticks(void) {
+  const uint32_t period_ms = (uint32_t)(1000 / JR_BLE_SAMPLE_HZ);
   const uint32_t safe_ms = (period_ms == 0) ? 1 : period_ms;
   return pdMS_TO_TICKS(safe_ms);
 }
 
+// Raw streaming rate limits (Hz) and default when the command has no rate.
+static constexpr uint16_t RAW_MIN_RATE_HZ = 100;
+static constexpr uint16_t RAW_MAX_RATE_HZ = 400;
+static constexpr uint16_t RAW_DEFAULT_RATE_HZ = 200;
+
+// Raw frames need room for the header plus a useful number of samples.
+static constexpr uint16_t RAW_MIN_MTU = 64;
+
+// Self-test limits (control 0x08).
+static constexpr uint16_t SELFTEST_MAX_RATE_HZ = 1000;
+static constexpr uint16_t SELFTEST_MAX_SECONDS = 600;
+
+// Frames sent in one wakeup when notify_task fell behind the schedule; any
+// older ones are skipped rather than sent as a burst.
+static constexpr uint32_t SELFTEST_MAX_BURST = 8;
+
+// Attempts at notifying the self-test report, SYNC_RETRY_TICKS apart.
+static constexpr uint8_t SELFTEST_REPORT_TRIES = 50;
+
+// Samples buffered between jr_ble_push_raw() and notify_task; covers
+// 320 ms at 400 Hz.
+static constexpr uint16_t RAW_QUEUE_LEN = 128;
+
+// Oldest sample age that forces a flush of a partial raw frame.
+static inline uint32_t batch_max_age_ms(void) {
+  return 1000 / jr_param_get(JR_PARAM_NOTIFY_HZ);
+}
+
+static inline int64_t coalesce_us(void) {
+  return (int64_t)jr_param_get(JR_PARAM_COALESCE_MS) * 1000;
+}
+
+static inline int64_t heartbeat_us(void) {
+  return (int64_t)jr_param_get(JR_PARAM_HEARTBEAT_MS) * 1000;
+}
+
+// How often batching throughput is logged.
+static constexpr int64_t BATCH_STATS_PERIOD_US = 5000000;
+
+// Largest LL payload / airtime (us) requested by the throughput profile.
+static constexpr uint16_t LINK_MAX_TX_OCTETS = 251;
+static constexpr uint16_t LINK_MAX_TX_TIME_US = 2120;
+
+// Records kept for gap fills (control 0x06); a power of two so the ring
+// index survives seq wrap-around.
+#ifndef JR_BLE_RETX_RECORDS
+#define JR_BLE_RETX_RECORDS 128
+#endif
+
+#if (JR_BLE_RETX_RECORDS & (JR_BLE_RETX_RECORDS - 1)) != 0
+#error "JR_BLE_RETX_RECORDS must be a power of two"
+#endif
+
+// Gap-fill ranges queued per client.
+static constexpr uint8_t FILL_QUEUE_LEN = 4;
+
+// A sync notification must hold at least one whole record.
+static constexpr uint16_t SYNC_MIN_MTU = 64;
+// Same for a bulk SDU, after its header.
+static constexpr uint16_t BULK_MIN_SDU = JR_BULK_HEADER_SIZE + SYNC_MIN_MTU - 3;
+
+// Shortest time between broadcast payload updates (ms); each update is one
+// HCI command, so changes in between are merged.
+#ifndef JR_BLE_BROADCAST_MS
+#define JR_BLE_BROADCAST_MS 250
+#endif
+
+static constexpr int64_t BROADCAST_US = (int64_t)JR_BLE_BROADCAST_MS * 1000;
+
+// Advertising interval in broadcast mode (0.625 ms units, 100 ms) so
+// scanners see every update.
+static constexpr uint16_t BROADCAST_ADV_ITVL = 160;
+
+// Back-off while the host has no room for another sync notification.
+static constexpr TickType_t SYNC_RETRY_TICKS = pdMS_TO_TICKS(10) + 1;
+
+// Send a Security Request on every connection: a bonded central re-encrypts
+// with its stored key (no prompt), a new one pairs once (Just Works). 0 leaves
+// pairing to the central.
+#ifndef JR_BLE_REQUEST_BOND
+#define JR_BLE_REQUEST_BOND 1
+#endif
+
+// Fast advertising after boot or a disconnect (ms); slow after that.
+#ifndef JR_BLE_FAST_ADV_MS
+#define JR_BLE_FAST_ADV_MS 30000
+#endif
+
+static constexpr int64_t FAST_ADV_US = (int64_t)JR_BLE_FAST_ADV_MS * 1000;
+
+// Advertising intervals (0.625 ms units): 20-30 ms while a central is likely
+// trying to reconnect, 417.5-546.25 ms otherwise.
+static constexpr uint16_t FAST_ADV_ITVL_MIN = 32;
+static constexpr uint16_t FAST_ADV_ITVL_MAX = 48;
+static constexpr uint16_t SLOW_ADV_ITVL_MIN = 668;
+static constexpr uint16_t SLOW_ADV_ITVL_MAX = 874;
+
+// High duty cycle directed advertising to a dropped bonded central; the
+// controller caps it at 1.28 s.
+static constexpr int32_t DIRECTED_ADV_MS = 1280;
+
+// A session whose last streaming client disconnected ends when no client
+// resumes it within this time (ms).
+#ifndef JR_BLE_SESSION_ORPHAN_MS
+#define JR_BLE_SESSION_ORPHAN_MS 300000
+#endif
+
+// NVS namespace of the BLE layer.
+static const char *NVS_NAMESPACE = "jr_ble";
+
+// L2CAP CoC bulk channel (needs CONFIG_BT_NIMBLE_L2CAP_COC_MAX_NUM >= 1).
+#if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM) > 0
+#define JR_BLE_HAS_COC 1
+#else
+#define JR_BLE_HAS_COC 0
+#endif
+
+// LE PSM in the dynamic range (0x80-0xFF).
+#ifndef JR_BLE_COC_PSM
+#define JR_BLE_COC_PSM 0x0081
+#endif
+
+// Largest SDU we send; the peer's MTU may lower it.
+#ifndef JR_BLE_COC_MTU
+#define JR_BLE_COC_MTU 1024
+#endif
+
+/* =========================
+   NOTIFY MBUF POOL
+   ========================= */
+
+// ATT notify header (opcode + handle) + L2CAP header + HCI ACL header that
+// the host prepends; reserving it keeps each notification in one mbuf.
+static constexpr uint16_t NOTIFY_LEADING_SPACE = 3 + 4 + 4;
+static constexpr uint16_t NOTIFY_MAX_PAYLOAD = JR_BLE_PREFERRED_MTU - 3;
+
+// Enough for every client to have a notification in flight, plus sync
+static constexpr uint16_t NOTIFY_BLOCK_COUNT = 2 + 2 * JR_BLE_MAX_CONN;
+static constexpr uint16_t NOTIFY_BLOCK_SIZE =
+    sizeof(struct os_mbuf) + sizeof(struct os_mbuf_pkthdr) +
+    NOTIFY_LEADING_SPACE + NOTIFY_MAX_PAYLOAD;
+
+static os_membuf_t
+    g_notify_mem[OS_MEMPOOL_SIZE(NOTIFY_BLOCK_COUNT, NOTIFY_BLOCK_SIZE)];
+static struct os_mempool g_notify_mempool;
+static struct os_mbuf_pool g_notify_mbuf_pool;
+
+// Notifications refused because the pool had no free block (notify_task)
+static uint32_t g_notify_pool_empty = 0;
+
 /* =========================
    STATE (transport-only)
    ========================= */
 
 static uint8_t g_own_addr_type = 0;
-static uint16_t g_conn_handle = BLE_HS_CONN_HANDLE_NONE;
 static uint16_t g_data_val_handle = 0;
+static uint16_t g_hrv_val_handle = 0;
+static uint16_t g_sync_val_handle = 0;
+static uint16_t g_params_val_handle = 0;
+static TaskHandle_t g_notify_task = NULL;
+
+// Range of records asked for with control 0x06
+struct jr_fill_t {
+  uint32_t seq;
+  uint16_t count;
+};
+
+// One slot per connected central (written by the host task, read by
+// notify_task; each field is a single word)
+struct jr_conn_t {
+  uint16_t handle; // BLE_HS_CONN_HANDLE_NONE = free slot
+  uint16_t mtu;
+  bool streaming;
+  jr_stream_mode_t mode;
+  uint16_t raw_rate_hz;   // rate this client asked for
+  uint32_t jump_baseline; // sent jump_count = total - baseline
+  uint8_t packet_version; // telemetry record version (1..3)
+  bool data_notify;       // CCCD state per characteristic
+  bool hrv_notify;
+  bool sync_notify;
+  bool params_notify;
+  uint32_t user_id; // control 0x0A, handed to the next session it starts
+  // Profile last asked of this central (JR_LINK_AUTO = nothing requested yet)
+  // and the parameters it granted
+  jr_link_params_t link;
+  // Gap fills not yet sent, oldest first (guarded by g_lock)
+  jr_fill_t fills[FILL_QUEUE_LEN];
+  uint8_t fill_count;
+  // Last clock sync request (control 0x07), answered by a control read
+  uint32_t clock_token;
+  int64_t clock_rx_us; // 0 = none yet
+};
+
+static jr_conn_t g_conns[JR_BLE_MAX_CONN];
+
+// Requested link profile (all connections)
+static jr_link_profile_t g_link_request = JR_LINK_AUTO;
+
+// Workout session (survives disconnects; see header); g_session holds its
+// aggregates (guarded by g_lock)
+static bool g_session_active = false;
+// Host task: ends a session no client resumed after the last one dropped
+static struct ble_npl_callout g_session_orphan;
+static uint32_t g_session_id = 0;
+static uint32_t g_session_user = 0; // 0 = anonymous
+static jr_session_t g_session = {};
+static uint32_t g_session_baseline = 0; // jump total when the session started
+
+// Bulk sync, one client at a time (cursor/stats owned by notify_task once
+// g_sync_active is set). g_sync_from is the source being sent: the journal
+// or the jump event ring.
+static const jr_sync_source_t *g_sync_source = NULL;
+static const jr_sync_source_t *g_event_source = NULL;
+static const jr_sync_source_t *g_sync_from = NULL;
+static bool g_sync_active = false;
+static uint16_t g_sync_conn = BLE_HS_CONN_HANDLE_NONE;
+static uint32_t g_sync_cursor = 0;
+
+// Broadcast mode; g_adv is the payload on air (notify_task and host task)
+static bool g_broadcast = false;
+static uint16_t g_cadence_jpm = 0;
+static jr_adv_state_t g_adv = {};
+static int64_t g_adv_update_us = 0;
+
+// Reconnect (host task): advertising stays fast until g_fast_adv_until_us;
+// g_directed_pending starts with a directed burst to g_reconnect_peer.
+static int64_t g_fast_adv_until_us = 0;
+static bool g_directed_pending = false;
+static ble_addr_t g_reconnect_peer = {};
+static int64_t g_disconnect_us = 0; // last disconnect, for resume timing
+
+#if JR_BLE_HAS_COC
+// Bulk channel (channel events from the host task; g_bulk is notify_task only)
+static struct ble_l2cap_chan *g_coc_chan = NULL;
+static uint16_t g_coc_conn = BLE_HS_CONN_HANDLE_NONE;
+static uint16_t g_coc_peer_mtu = 0;
+static bool g_coc_unstalled = false;
+static bool g_bulk_requested = false; // control 0x04 seen
+static uint32_t g_bulk_cursor = 0;
+static jr_bulk_tx_t g_bulk;
+static uint8_t g_bulk_buf[JR_BLE_COC_MTU];
+static int64_t g_bulk_start_us = 0;
+#endif
 
-static bool g_streaming = false;
+// Raw sample queue (producer: jr_ble_push_raw, consumer: notify_task)
+static jr_raw_sample_t g_raw_queue[RAW_QUEUE_LEN];
+static uint16_t g_raw_head = 0; // next slot to write
+static uint16_t g_raw_tail = 0; // next slot to read
+static uint8_t g_raw_channels = 0;
+static uint32_t g_raw_overflows = 0;
 
-// "Reset-on-start" implemented via baseline
+// "Reset-on-start" implemented via per-connection baselines
 static bool g_reset_on_start = true;
-static uint32_t g_jump_baseline = 0;
 
 // Sensor snapshot (updated by the rest of firmware)
 static uint32_t g_jump_total = 0;
 static uint8_t g_hr_bpm = 0;
-static uint16_t g_accel_mag = 0;
+static uint16_t g_spo2_pct = 0;
 static uint8_t g_flags = 0;
 
+// Set when the snapshot changed since the last captured record;
+// g_change_us is when the oldest uncaptured change happened and
+// g_snapshot_us when the newest did (the time the snapshot describes).
+static bool g_snapshot_dirty = false;
+static int64_t g_change_us = 0;
+static int64_t g_snapshot_us = 0;
+
+// Latest HRV record; g_hrv_pending is set per beat and cleared once notified
+static jr_hrv_v1_t g_hrv = {};
+static bool g_hrv_pending = false;
+
 // Simple critical section to make snapshot reads/writes consistent
 static portMUX_TYPE g_lock = portMUX_INITIALIZER_UNLOCKED;
 
+/* =========================
+   CONNECTION TABLE
+   ========================= */
+
+static jr_conn_t *conn_find(uint16_t handle) {
+  if (handle == BLE_HS_CONN_HANDLE_NONE) {
+    return NULL;
+  }
+  for (jr_conn_t &c : g_conns) {
+    if (c.handle == handle) {
+      return &c;
+    }
+  }
+  return NULL;
+}
+
+// Claims a free slot for a new connection; NULL when the table is full.
+static jr_conn_t *conn_alloc(uint16_t handle) {
+  jr_conn_t *c = NULL;
+  for (jr_conn_t &slot : g_conns) {
+    if (slot.handle == BLE_HS_CONN_HANDLE_NONE) {
+      c = &slot;
+      break;
+    }
+  }
+  if (!c) {
+    return NULL;
+  }
+  memset(c, 0, sizeof(*c));
+  c->handle = handle;
+  c->mtu = BLE_ATT_MTU_DFLT;
+  c->mode = JR_STREAM_SUMMARY;
+  c->packet_version = 1;
+  c->raw_rate_hz = RAW_DEFAULT_RATE_HZ;
+  return c;
+}
+
+static uint8_t conn_count(void) {
+  uint8_t n = 0;
+  for (const jr_conn_t &c : g_conns) {
+    n += c.handle != BLE_HS_CONN_HANDLE_NONE;
+  }
+  return n;
+}
+
+// Connected and streaming in the given mode.
+static inline bool conn_streams(const jr_conn_t &c, jr_stream_mode_t mode) {
+  return c.handle != BLE_HS_CONN_HANDLE_NONE && c.streaming && c.mode == mode;
+}
+
+// Streaming in the given mode with data notifications enabled.
+static inline bool conn_wants(const jr_conn_t &c, jr_stream_mode_t mode) {
+  return conn_streams(c, mode) && c.data_notify;
+}
+
+static bool stream_any(jr_stream_mode_t mode) {
+  for (const jr_conn_t &c : g_conns) {
+    if (conn_streams(c, mode)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Raw frame rate: the highest rate any raw client asked for (0 = none).
+static uint16_t raw_rate(void) {
+  uint16_t rate = 0;
+  for (const jr_conn_t &c : g_conns) {
+    if (conn_streams(c, JR_STREAM_RAW) && c.raw_rate_hz > rate) {
+      rate = c.raw_rate_hz;
+    }
+  }
+  return rate;
+}
+
+// Notification payload that fits this client's MTU and a pool block.
+static inline uint16_t conn_payload(const jr_conn_t &c) {
+  const uint16_t payload = (uint16_t)(c.mtu - 3);
+  return (payload < NOTIFY_MAX_PAYLOAD) ? payload : NOTIFY_MAX_PAYLOAD;
+}
+
+// Smallest notification payload among clients streaming in mode.
+static uint16_t notify_payload(jr_stream_mode_t mode) {
+  uint16_t payload = NOTIFY_MAX_PAYLOAD;
+  for (const jr_conn_t &c : g_conns) {
+    if (conn_wants(c, mode) && conn_payload(c) < payload) {
+      payload = conn_payload(c);
+    }
+  }
+  return payload;
+}
+
 /* =========================
    PACKET BUILDER
    ========================= */
@@ -109,83 +605,1537 @@ static inline uint32_t uptime_ms(void) {
   return (uint32_t)(esp_timer_get_time() / 1000ULL);
 }
 
-static void build_packet(jr_packet_v1_t *out) {
+// Wakes notify_task to look at new state (safe from any task).
+static inline void notify_wake(void) {
+  if (g_notify_task) {
+    xTaskNotifyGive(g_notify_task);
+  }
+}
+
+// Jump count as sent to a client with the given baseline.
+static inline uint32_t jump_relative(uint32_t jump_total, uint32_t baseline) {
+  if (!g_reset_on_start) {
+    return jump_total;
+  }
+  // Avoid underflow if total counter changes unexpectedly
+  return (jump_total >= baseline) ? (jump_total - baseline) : jump_total;
+}
+
+// Snapshots the shared state into a record carrying the device jump total
+// (see jump_relative). When change_us is given, also consumes the pending
+// change and returns its time (0 if none was pending).
+static void build_packet(jr_telemetry_t *out, int64_t *change_us = NULL) {
   uint32_t jump_total;
   uint8_t hr;
-  uint16_t accel;
+  uint16_t spo2;
   uint8_t flags;
-  uint32_t baseline;
-  bool reset_on_start;
+  int64_t event_us;
 
   portENTER_CRITICAL(&g_lock);
   jump_total = g_jump_total;
   hr = g_hr_bpm;
-  accel = g_accel_mag;
+  spo2 = g_spo2_pct;
   flags = g_flags;
-  baseline = g_jump_baseline;
-  reset_on_start = g_reset_on_start;
-  portEXIT_CRITICAL(&g_lock);
-
-  uint32_t jump_to_send = jump_total;
-
-  if (reset_on_start) {
-    // Avoid underflow if total counter changes unexpectedly
-    jump_to_send =
-        (jump_total >= baseline) ? (jump_total - baseline) : jump_total;
+  event_us = g_snapshot_us;
+  if (change_us) {
+    *change_us = g_snapshot_dirty ? g_change_us : 0;
+    g_snapshot_dirty = false;
   }
+  portEXIT_CRITICAL(&g_lock);
 
   out->timestamp_ms = uptime_ms();
-  out->jump_count = jump_to_send;
+  out->jump_count = jump_total;
   out->heart_rate_bpm = hr;
-  out->accel_mag = accel;
+  out->spo2_pct = spo2;
   out->flags = flags;
+  out->seq = 0;
+  out->event_us = (uint64_t)event_us;
 }
 
 /* =========================
-   GATT CALLBACKS
+   BATCH FRAMER (notify_task only)
    ========================= */
 
-static int ctrl_access_cb(uint16_t conn_handle, uint16_t attr_handle,
-                          struct ble_gatt_access_ctxt *ctxt, void *arg) {
-  (void)conn_handle;
-  (void)attr_handle;
-  (void)arg;
+struct batch_stats_t {
+  uint32_t records;    // records delivered to at least one client
+  uint32_t notifies;   // notifications accepted by the host
+  uint32_t encodes;    // times a batch was encoded for a baseline
+  uint32_t heartbeats; // batches sent without a state change
+  uint32_t failed;     // notifications rejected by the host or pool
+  uint32_t wakes;      // notify_task wakeups
+  uint32_t latency_n;  // change-to-notify samples
+  int64_t latency_sum_us;
+  int64_t latency_max_us;
+};
 
-  if (ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR) {
-    return BLE_ATT_ERR_UNLIKELY;
+static constexpr uint16_t BATCH_MAX_RECORDS =
+    NOTIFY_MAX_PAYLOAD / JR_TELEMETRY_V1_SIZE;
+
+static_assert(JR_BLE_RETX_RECORDS >= BATCH_MAX_RECORDS,
+              "JR_BLE_RETX_RECORDS must hold a full batch");
+
+// Every record stays in this ring for gap fills; the open batch is its
+// newest g_batch_count entries. Records carry the device jump total;
+// baselines apply per client.
+static jr_telemetry_t g_retx[JR_BLE_RETX_RECORDS];
+static uint32_t g_retx_next = 0; // seq of the next record
+static uint16_t g_batch_count = 0;
+static int64_t g_batch_open_us = 0;   // when the first record was added
+static int64_t g_batch_change_us = 0; // oldest change carried (0 = none)
+static int64_t g_last_notify_us = 0;
+static batch_stats_t g_batch_stats = {};
+// Written by notify_task, except fill_requests (host task, under g_lock)
+static jr_delivery_stats_t g_delivery = {};
+
+// Writes count ring records from seq on, as sent to a client with the given
+// baseline and packet version. Returns bytes written.
+static uint16_t encode_records(uint8_t *out, uint32_t seq, uint16_t count,
+                               uint32_t baseline, uint8_t version) {
+  const size_t size = jr_telemetry_size(version);
+  uint8_t *p = out;
+  for (uint16_t i = 0; i < count; i++, seq++) {
+    jr_telemetry_t rec = g_retx[seq % JR_BLE_RETX_RECORDS];
+    rec.jump_count = jump_relative(rec.jump_count, baseline);
+    rec.seq = seq;
+    p += jr_telemetry_pack(&rec, version, p, size);
   }
+  return (uint16_t)(p - out);
+}
 
-  uint8_t cmd = 0;
-  if (OS_MBUF_PKTLEN(ctxt->om) < 1) {
-    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+// Records per notification for the smallest MTU among summary clients (at
+// least one).
+static inline uint16_t batch_capacity(void) {
+  uint16_t n = BATCH_MAX_RECORDS;
+  for (const jr_conn_t &c : g_conns) {
+    if (conn_wants(c, JR_STREAM_SUMMARY)) {
+      const uint16_t fit =
+          (uint16_t)(conn_payload(c) / jr_telemetry_size(c.packet_version));
+      if (fit < n) {
+        n = fit;
+      }
+    }
   }
+  return (n == 0) ? 1 : n;
+}
 
-  if (ble_hs_mbuf_to_flat(ctxt->om, &cmd, sizeof(cmd), NULL) != 0) {
-    return BLE_ATT_ERR_UNLIKELY;
+static void batch_discard(void) {
+  g_batch_count = 0;
+  g_batch_change_us = 0;
+}
+
+// Sends one copy of an encoded payload from the notify pool. The host takes
+// ownership of the mbuf whether or not the send succeeds.
+static int notify_copy(uint16_t conn, uint16_t attr, const uint8_t *data,
+                       uint16_t len) {
+  struct os_mbuf *om = os_mbuf_get_pkthdr(&g_notify_mbuf_pool, 0);
+  if (!om) {
+    g_notify_pool_empty++;
+    return BLE_HS_ENOMEM;
+  }
+  om->om_data += NOTIFY_LEADING_SPACE;
+  if (os_mbuf_append(om, data, len) != 0) {
+    os_mbuf_free_chain(om);
+    return BLE_HS_ENOMEM;
   }
+  return ble_gatts_notify_custom(conn, attr, om);
+}
 
-  if (cmd == 0x01) {
-    g_streaming = true;
+static void batch_flush(void) {
+  if (g_batch_count == 0) {
+    return;
+  }
 
-    // Capture baseline at START (transmitted jumps will begin at 0)
+  // Encode once per distinct baseline and packet version; clients following
+  // the session share one, so normally this is a single pass
+  const uint32_t first = g_retx_next - g_batch_count;
+  uint8_t buf[NOTIFY_MAX_PAYLOAD];
+  uint16_t len = 0;
+  bool encoded = false;
+  uint32_t encoded_baseline = 0;
+  uint8_t encoded_version = 0;
+  uint32_t delivered = 0;
+
+  for (const jr_conn_t &c : g_conns) {
+    if (!conn_wants(c, JR_STREAM_SUMMARY)) {
+      continue;
+    }
+    if (!encoded || c.jump_baseline != encoded_baseline ||
+        c.packet_version != encoded_version) {
+      len = encode_records(buf, first, g_batch_count, c.jump_baseline,
+                           c.packet_version);
+      encoded = true;
+      encoded_baseline = c.jump_baseline;
+      encoded_version = c.packet_version;
+      g_batch_stats.encodes++;
+    }
+
+    const int rc = notify_copy(c.handle, g_data_val_handle, buf, len);
+    if (rc == 0) {
+      g_batch_stats.notifies++;
+      delivered++;
+    } else {
+      // v2 clients see the gap and ask for the records again
+      g_batch_stats.failed++;
+      g_delivery.notify_failed++;
+      g_delivery.records_lost += g_batch_count;
+      ESP_LOGD(TAG, "notify conn=%d rc=%d", (int)c.handle, rc);
+    }
+  }
+
+  const int64_t now_us = esp_timer_get_time();
+  if (delivered > 0) {
+    g_batch_stats.records += g_batch_count;
+    if (g_batch_change_us != 0) {
+      const int64_t latency = now_us - g_batch_change_us;
+      g_batch_stats.latency_n++;
+      g_batch_stats.latency_sum_us += latency;
+      if (latency > g_batch_stats.latency_max_us) {
+        g_batch_stats.latency_max_us = latency;
+      }
+    } else {
+      g_batch_stats.heartbeats++;
+    }
+  }
+
+  g_last_notify_us = now_us;
+  g_batch_count = 0;
+  g_batch_change_us = 0;
+}
+
+// Stages one record with the current snapshot. Flushes when the batch fills
+// the smallest MTU.
+static void batch_capture(void) {
+  if (g_batch_count == 0) {
+    g_batch_open_us = esp_timer_get_time();
+  }
+
+  int64_t change_us;
+  build_packet(&g_retx[g_retx_next % JR_BLE_RETX_RECORDS], &change_us);
+  g_retx_next++;
+  g_batch_count++;
+  g_delivery.records++;
+  if (change_us != 0 &&
+      (g_batch_change_us == 0 || change_us < g_batch_change_us)) {
+    g_batch_change_us = change_us;
+  }
+
+  if (g_batch_count >= batch_capacity()) {
+    batch_flush();
+  }
+}
+
+// Captures pending changes and flushes on the coalescing / heartbeat
+// deadlines. Returns how long notify_task may sleep before the next deadline.
+static TickType_t batch_service(void) {
+  bool dirty;
+  portENTER_CRITICAL(&g_lock);
+  dirty = g_snapshot_dirty;
+  portEXIT_CRITICAL(&g_lock);
+
+  const int64_t coalesce = coalesce_us();
+  const int64_t heartbeat = heartbeat_us();
+  int64_t now_us = esp_timer_get_time();
+  if (dirty) {
+    batch_capture();
+  } else if (g_batch_count == 0 && now_us - g_last_notify_us >= heartbeat) {
+    batch_capture();
+    batch_flush();
+  }
+
+  now_us = esp_timer_get_time();
+  if (g_batch_count > 0 && now_us - g_batch_open_us >= coalesce) {
+    batch_flush();
+  }
+
+  const int64_t deadline_us = (g_batch_count > 0)
+                                  ? g_batch_open_us + coalesce
+                                  : g_last_notify_us + heartbeat;
+  const int64_t wait_us = deadline_us - esp_timer_get_time();
+  if (wait_us <= 0) {
+    return 0;
+  }
+  // Round up so we never wake just before the deadline
+  return pdMS_TO_TICKS((uint32_t)((wait_us + 999) / 1000)) + 1;
+}
+
+static void batch_log_stats(int64_t elapsed_us) {
+  const uint32_t samples_per_s =
+      (uint32_t)((uint64_t)g_batch_stats.records * 1000000 / elapsed_us);
+  const uint32_t notifies_per_s =
+      (uint32_t)((uint64_t)g_batch_stats.notifies * 1000000 / elapsed_us);
+  const uint32_t wakes_per_s =
+      (uint32_t)((uint64_t)g_batch_stats.wakes * 1000000 / elapsed_us);
+  const uint32_t latency_avg_us =
+      g_batch_stats.latency_n
+          ? (uint32_t)(g_batch_stats.latency_sum_us / g_batch_stats.latency_n)
+          : 0;
+
+  ESP_LOGI(TAG,
+           "batch: %" PRIu32 " records/s in %" PRIu32
+           " notifies/s (%u/notify, encodes=%" PRIu32 ", heartbeats=%" PRIu32
+           "), task wakes/s=%" PRIu32 ", failed=%" PRIu32,
+           samples_per_s, notifies_per_s, (unsigned)batch_capacity(),
+           g_batch_stats.encodes, g_batch_stats.heartbeats, wakes_per_s,
+           g_batch_stats.failed);
+  ESP_LOGI(TAG,
+           "change-to-notify latency: avg=%" PRIu32 " us max=%" PRId64
+           " us (n=%" PRIu32 ")",
+           latency_avg_us, g_batch_stats.latency_max_us,
+           g_batch_stats.latency_n);
+  ESP_LOGI(TAG,
+           "delivery since boot: records=%" PRIu32 " lost=%" PRIu32
+           " (failed notifies=%" PRIu32 "), fills=%" PRIu32 " resent=%" PRIu32
+           " missed=%" PRIu32,
+           g_delivery.records, g_delivery.records_lost,
+           g_delivery.notify_failed, g_delivery.fill_requests,
+           g_delivery.records_resent, g_delivery.fill_missed);
+  g_batch_stats = {};
+}
+
+/* =========================
+   GAP FILL (notify_task only)
+   ========================= */
+
+// Resends the queued ranges to one client from the ring. Returns false when
+// the host pushed back; the rest of the range is kept for the next pass.
+static bool fill_serve(jr_conn_t &c) {
+  while (true) {
+    jr_fill_t f;
+    bool have;
     portENTER_CRITICAL(&g_lock);
-    g_jump_baseline = g_jump_total;
+    have = c.fill_count > 0;
+    if (have) {
+      f = c.fills[0];
+    }
     portEXIT_CRITICAL(&g_lock);
+    if (!have) {
+      return true;
+    }
 
-    ESP_LOGI(TAG, "Streaming START (reset_on_start=%d, baseline=%" PRIu32 ")",
-             (int)g_reset_on_start, (uint32_t)g_jump_baseline);
-  } else if (cmd == 0x00) {
-    g_streaming = false;
-    ESP_LOGI(TAG, "Streaming STOP");
-  } else {
-    ESP_LOGW(TAG, "Unknown control cmd: 0x%02X", cmd);
+    // Only records that were flushed and are still in the ring qualify
+    const uint32_t oldest = g_retx_next - JR_BLE_RETX_RECORDS;
+    const uint32_t sent_end = g_retx_next - g_batch_count;
+    uint32_t seq = f.seq;
+    uint32_t end = f.seq + f.count;
+    if (g_retx_next >= JR_BLE_RETX_RECORDS && (int32_t)(oldest - seq) > 0) {
+      const uint32_t gone =
+          ((int32_t)(end - oldest) > 0) ? oldest - seq : f.count;
+      g_delivery.fill_missed += gone;
+      seq += gone;
+    }
+    if ((int32_t)(end - sent_end) > 0) {
+      end = sent_end;
+    }
+
+    const uint16_t cap =
+        (uint16_t)(conn_payload(c) / jr_telemetry_size(c.packet_version));
+    bool ok = true;
+    while ((int32_t)(end - seq) > 0) {
+      const uint32_t left = end - seq;
+      const uint16_t n = (left < cap) ? (uint16_t)left : cap;
+      uint8_t buf[NOTIFY_MAX_PAYLOAD];
+      const uint16_t len =
+          encode_records(buf, seq, n, c.jump_baseline, c.packet_version);
+      const int rc = notify_copy(c.handle, g_data_val_handle, buf, len);
+      if (rc != 0) {
+        ESP_LOGD(TAG, "fill notify conn=%d rc=%d", (int)c.handle, rc);
+        ok = false;
+        break;
+      }
+      seq += n;
+      g_delivery.records_resent += n;
+    }
+
+    // The host task may have cleared the queue meanwhile (new start)
+    portENTER_CRITICAL(&g_lock);
+    if (c.fill_count > 0 && c.fills[0].seq == f.seq &&
+        c.fills[0].count == f.count) {
+      if (ok) {
+        c.fill_count--;
+        memmove(&c.fills[0], &c.fills[1], c.fill_count * sizeof(jr_fill_t));
+      } else {
+        c.fills[0].seq = seq;
+        c.fills[0].count = (uint16_t)(end - seq);
+      }
+    }
+    portEXIT_CRITICAL(&g_lock);
+    if (!ok) {
+      return false;
+    }
+  }
+}
+
+/* =========================
+   RAW FRAMER (notify_task only)
+   ========================= */
+
+struct raw_stats_t {
+  uint32_t samples;  // samples delivered in notifications
+  uint32_t bytes;    // notification payload bytes
+  uint32_t frames;   // notifications accepted by the host
+  uint32_t failed;   // notifications rejected by the host
+};
+
+// Frame being encoded; sent to every raw client when flushed
+static uint8_t g_raw_buf[NOTIFY_MAX_PAYLOAD];
+static bool g_raw_open = false;
+static jr_raw_encoder_t g_raw_enc;
+static uint16_t g_raw_seq = 0;
+static uint32_t g_raw_first_ms = 0;
+static raw_stats_t g_raw_stats = {};
+
+static void raw_discard(void) { g_raw_open = false; }
+
+static void raw_flush(void) {
+  if (!g_raw_open) {
+    return;
+  }
+
+  const uint16_t len = (uint16_t)jr_raw_encoder_finish(&g_raw_enc);
+  bool delivered = false;
+  for (const jr_conn_t &c : g_conns) {
+    if (!conn_wants(c, JR_STREAM_RAW)) {
+      continue;
+    }
+    const int rc = notify_copy(c.handle, g_data_val_handle, g_raw_buf, len);
+    if (rc == 0) {
+      g_raw_stats.frames++;
+      g_raw_stats.bytes += len;
+      delivered = true;
+    } else {
+      g_raw_stats.failed++;
+      ESP_LOGD(TAG, "raw notify conn=%d rc=%d", (int)c.handle, rc);
+    }
+  }
+  if (delivered) {
+    g_raw_stats.samples += g_raw_enc.count;
+  }
+
+  // Sequence advances even on failure so the client sees the loss
+  g_raw_seq++;
+  g_raw_open = false;
+}
+
+// Frames are sized for the smallest MTU among raw clients and paced at the
+// fastest requested rate.
+static void raw_open_frame(uint8_t channels) {
+  const uint16_t rate = raw_rate();
+  const uint16_t period_us =
+      (uint16_t)(1000000 / (rate ? rate : RAW_DEFAULT_RATE_HZ));
+  jr_raw_encoder_begin(&g_raw_enc, g_raw_buf, notify_payload(JR_STREAM_RAW),
+                       g_raw_seq, channels, period_us);
+  g_raw_first_ms = uptime_ms();
+  g_raw_open = true;
+}
+
+// Moves queued samples into frames, flushing full or aged frames.
+static void raw_pump(void) {
+  while (true) {
+    jr_raw_sample_t s;
+    uint8_t channels;
+    bool have;
+
+    portENTER_CRITICAL(&g_lock);
+    have = g_raw_tail != g_raw_head;
+    if (have) {
+      s = g_raw_queue[g_raw_tail];
+    }
+    channels = g_raw_channels;
+    portEXIT_CRITICAL(&g_lock);
+
+    if (!have) {
+      break;
+    }
+    if (!g_raw_open) {
+      raw_open_frame(channels);
+    }
+    if (!jr_raw_encoder_add(&g_raw_enc, &s)) {
+      if (g_raw_enc.count > 0) {
+        raw_flush();
+        continue; // retry the same sample in a fresh frame
+      }
+      // Cannot fit even an empty frame; skip it rather than spin
+    }
+
+    portENTER_CRITICAL(&g_lock);
+    g_raw_tail = (uint16_t)((g_raw_tail + 1) % RAW_QUEUE_LEN);
+    portEXIT_CRITICAL(&g_lock);
+  }
+
+  if (g_raw_open && uptime_ms() - g_raw_first_ms >= batch_max_age_ms()) {
+    raw_flush();
+  }
+}
+
+static void raw_log_stats(int64_t elapsed_us) {
+  uint32_t overflows;
+  portENTER_CRITICAL(&g_lock);
+  overflows = g_raw_overflows;
+  g_raw_overflows = 0;
+  portEXIT_CRITICAL(&g_lock);
+
+  const uint32_t offered = g_raw_stats.samples + overflows;
+  const uint32_t bytes_per_s =
+      (uint32_t)((uint64_t)g_raw_stats.bytes * 1000000 / elapsed_us);
+  const uint32_t samples_per_s =
+      (uint32_t)((uint64_t)g_raw_stats.samples * 1000000 / elapsed_us);
+
+  ESP_LOGI(TAG,
+           "raw: %" PRIu32 " samples/s, %" PRIu32 " B/s (%.2f B/sample), "
+           "frames=%" PRIu32 " failed=%" PRIu32 " overflow=%" PRIu32
+           " (%.2f%% loss)",
+           samples_per_s, bytes_per_s,
+           g_raw_stats.samples ? (float)g_raw_stats.bytes / g_raw_stats.samples
+                               : 0.0f,
+           g_raw_stats.frames, g_raw_stats.failed, overflows,
+           offered ? 100.0f * overflows / offered : 0.0f);
+  g_raw_stats = {};
+}
+
+/* =========================
+   SELF-TEST (control 0x08; notify_task once started)
+   ========================= */
+
+struct selftest_t {
+  uint16_t conn;
+  uint16_t rate_hz;
+  uint16_t size;
+  uint32_t duration_ms;
+  int64_t start_us;
+  uint32_t next;        // index of the next scheduled frame
+  bool finished;        // report pending
+  uint8_t report_tries; // failed report notifications
+  uint64_t late_sum_us;
+  uint64_t call_sum_us;
+  jr_selftest_report_t report; // counters are kept in place
+};
+
+// One test at a time; the host task fills g_test, then sets g_test_active
+static selftest_t g_test = {};
+static bool g_test_active = false;
+
+static inline uint32_t selftest_due_us(uint32_t index) {
+  return (uint32_t)((uint64_t)index * 1000000 / g_test.rate_hz);
+}
+
+static void selftest_send(const jr_conn_t &c) {
+  jr_selftest_report_t &r = g_test.report;
+  uint8_t buf[NOTIFY_MAX_PAYLOAD];
+
+  jr_selftest_frame_t f;
+  f.type = JR_SELFTEST_FRAME_TYPE;
+  f.reserved = 0;
+  f.seq = (uint16_t)g_test.next;
+  f.due_us = selftest_due_us(g_test.next);
+  for (uint16_t i = sizeof(f); i < g_test.size; i++) {
+    buf[i] = (uint8_t)(f.seq + i);
+  }
+  if (g_notify_mempool.mp_num_free < r.pool_min_free) {
+    r.pool_min_free = g_notify_mempool.mp_num_free;
+  }
+
+  const uint32_t pool_empty = g_notify_pool_empty;
+  const int64_t t0 = esp_timer_get_time();
+  f.send_us = (uint32_t)(t0 - g_test.start_us);
+  memcpy(buf, &f, sizeof(f));
+  const int rc = notify_copy(c.handle, g_data_val_handle, buf, g_test.size);
+  const int64_t t1 = esp_timer_get_time();
+
+  const uint32_t late_us = (f.send_us > f.due_us) ? f.send_us - f.due_us : 0;
+  const uint32_t call_us = (uint32_t)(t1 - t0);
+  g_test.late_sum_us += late_us;
+  g_test.call_sum_us += call_us;
+  if (late_us > r.late_max_us) {
+    r.late_max_us = late_us;
+  }
+  if (call_us > r.call_max_us) {
+    r.call_max_us = call_us;
+  }
+
+  if (rc == 0) {
+    r.sent++;
+    return;
+  }
+  r.last_rc = (int16_t)rc;
+  if (g_notify_pool_empty != pool_empty) {
+    r.pool_empty++;
+  } else if (rc == BLE_HS_ENOMEM) {
+    r.host_nomem++;
+  } else {
+    r.host_other++;
+  }
+}
+
+static void selftest_finish(uint8_t reason) {
+  jr_selftest_report_t &r = g_test.report;
+  const uint32_t attempts = r.due - r.skipped;
+  r.reason = reason;
+  r.elapsed_ms = (uint32_t)((esp_timer_get_time() - g_test.start_us) / 1000);
+  r.late_avg_us = attempts ? (uint32_t)(g_test.late_sum_us / attempts) : 0;
+  r.call_avg_us = attempts ? (uint32_t)(g_test.call_sum_us / attempts) : 0;
+  if (r.pool_min_free == UINT16_MAX) {
+    r.pool_min_free = g_notify_mempool.mp_num_free;
+  }
+  g_test.finished = true;
+
+  ESP_LOGI(TAG,
+           "Self-test %s (conn=%d): %u Hz x %u B for %" PRIu32
+           " ms, tick %u Hz",
+           reason ? "stopped" : "done", (int)g_test.conn,
+           (unsigned)r.rate_hz, (unsigned)r.size, r.elapsed_ms,
+           (unsigned)r.tick_hz);
+  ESP_LOGI(TAG,
+           "Self-test: due=%" PRIu32 " sent=%" PRIu32 " skipped=%" PRIu32
+           " pool_empty=%" PRIu32 " host_nomem=%" PRIu32
+           " host_other=%" PRIu32 " (last rc=%d), pool min free=%u",
+           r.due, r.sent, r.skipped, r.pool_empty, r.host_nomem,
+           r.host_other, (int)r.last_rc, (unsigned)r.pool_min_free);
+  ESP_LOGI(TAG,
+           "Self-test: late avg/max %" PRIu32 "/%" PRIu32
+           " us, notify call avg/max %" PRIu32 "/%" PRIu32 " us",
+           r.late_avg_us, r.late_max_us, r.call_avg_us, r.call_max_us);
+}
+
+static void link_apply(jr_conn_t *c);
+
+// Notifies the report to the client that ran the test, if it still listens
+// on the self-test stream.
+static TickType_t selftest_report(jr_conn_t *c) {
+  if (c && c->mode == JR_STREAM_SELFTEST && c->data_notify) {
+    const int rc =
+        notify_copy(c->handle, g_data_val_handle,
+                    (const uint8_t *)&g_test.report, sizeof(g_test.report));
+    if (rc != 0 && ++g_test.report_tries < SELFTEST_REPORT_TRIES) {
+      return SYNC_RETRY_TICKS;
+    }
+    if (rc != 0) {
+      ESP_LOGW(TAG, "Self-test report not sent; rc=%d", rc);
+    }
+    portENTER_CRITICAL(&g_lock);
+    c->streaming = false;
+    portEXIT_CRITICAL(&g_lock);
+  }
+  g_test_active = false;
+  link_apply(c);
+  return portMAX_DELAY;
+}
+
+// Sends the frames due by now and returns the ticks until the next one.
+static TickType_t selftest_pump(void) {
+  jr_conn_t *c = conn_find(g_test.conn);
+  if (!g_test.finished) {
+    const int64_t elapsed_us = esp_timer_get_time() - g_test.start_us;
+    if (!c || !conn_wants(*c, JR_STREAM_SELFTEST)) {
+      selftest_finish(1);
+    } else if (elapsed_us >= (int64_t)g_test.duration_ms * 1000) {
+      selftest_finish(0);
+    }
+  }
+  if (g_test.finished) {
+    return selftest_report(c);
+  }
+
+  // Frames due by now, frame 0 at the start; when more than a burst is
+  // waiting, the task ran late and the oldest are skipped
+  jr_selftest_report_t &r = g_test.report;
+  const int64_t elapsed_us = esp_timer_get_time() - g_test.start_us;
+  const uint32_t due =
+      (uint32_t)((uint64_t)elapsed_us * g_test.rate_hz / 1000000) + 1;
+  if (due - g_test.next > SELFTEST_MAX_BURST) {
+    r.skipped += due - g_test.next - SELFTEST_MAX_BURST;
+    g_test.next = due - SELFTEST_MAX_BURST;
+  }
+  while (g_test.next < due) {
+    selftest_send(*c);
+    g_test.next++;
+  }
+  r.due = g_test.next;
+
+  // Sleep until the next frame is due, at least one tick
+  const int64_t wait_us = g_test.start_us + selftest_due_us(g_test.next) -
+                          esp_timer_get_time();
+  const int64_t ticks = (wait_us * configTICK_RATE_HZ + 999999) / 1000000;
+  return (ticks > 1) ? (TickType_t)ticks : 1;
+}
+
+/* =========================
+   SYNC PUMP (notify_task only)
+   ========================= */
+
+struct sync_stats_t {
+  uint32_t bytes;    // record bytes delivered
+  uint32_t notifies; // notifications accepted by the host
+  uint32_t retries;  // notifications rejected and resent
+  int64_t start_us;
+};
+
+static sync_stats_t g_sync_stats = {};
+
+static void link_apply_all(void);
+
+static void sync_finish(uint32_t cursor) {
+  const int64_t elapsed_us = esp_timer_get_time() - g_sync_stats.start_us;
+  const uint32_t bytes_per_s =
+      elapsed_us > 0
+          ? (uint32_t)((uint64_t)g_sync_stats.bytes * 1000000 / elapsed_us)
+          : 0;
+  ESP_LOGI(TAG,
+           "Sync done: %" PRIu32 " bytes in %" PRId64 " ms (%" PRIu32
+           ".%02" PRIu32 " KB/s), notifies=%" PRIu32 " retries=%" PRIu32
+           ", next=%" PRIu32,
+           g_sync_stats.bytes, elapsed_us / 1000, bytes_per_s / 1024,
+           (bytes_per_s % 1024) * 100 / 1024, g_sync_stats.notifies,
+           g_sync_stats.retries, cursor);
+  g_sync_active = false;
+  link_apply_all();
+}
+
+// Sends notifications until the source is drained, the pool is empty or the
+// host pushes back. Returns how long notify_task may sleep.
+static TickType_t sync_pump(void) {
+  const jr_conn_t *c = conn_find(g_sync_conn);
+  if (!c) {
+    g_sync_active = false; // client went away
+    return portMAX_DELAY;
+  }
+
+  while (g_sync_active) {
+    struct os_mbuf *om = os_mbuf_get_pkthdr(&g_notify_mbuf_pool, 0);
+    if (!om) {
+      return SYNC_RETRY_TICKS; // blocks still queued in the host
+    }
+    om->om_data += NOTIFY_LEADING_SPACE;
+
+    uint16_t cap = (uint16_t)(c->mtu - 3);
+    const uint16_t room = (uint16_t)OS_MBUF_TRAILINGSPACE(om);
+    if (cap > room) {
+      cap = room;
+    }
+
+    const uint32_t start = g_sync_cursor;
+    uint32_t cursor = start;
+    size_t len = g_sync_from->read(&cursor, om->om_data, cap);
+    const bool done = len == 0;
+    if (done) {
+      // End marker carries the cursor to resume from next time
+      uint8_t *p = om->om_data;
+      memcpy(p, &cursor, sizeof(cursor));
+      p[4] = JR_SYNC_END_TYPE;
+      p[5] = 0;
+      len = JR_SYNC_RECORD_HEADER_SIZE;
+    }
+    os_mbuf_extend(om, (uint16_t)len); // records were read in place
+
+    const int rc = ble_gatts_notify_custom(c->handle, g_sync_val_handle, om);
+    if (rc != 0) {
+      // The host dropped it; send the same records again later
+      g_sync_stats.retries++;
+      ESP_LOGD(TAG, "sync notify rc=%d", rc);
+      return SYNC_RETRY_TICKS;
+    }
+
+    g_sync_cursor = cursor;
+    g_sync_stats.notifies++;
+    g_sync_stats.bytes += (uint32_t)len;
+    if (done) {
+      sync_finish(cursor);
+    }
+  }
+  return portMAX_DELAY;
+}
+
+/* =========================
+   BULK CHANNEL (L2CAP CoC)
+   ========================= */
+
+#if JR_BLE_HAS_COC
+
+static bool bulk_active(void) {
+  return g_bulk_requested || g_bulk.state == JR_BULK_RUNNING ||
+         g_bulk.state == JR_BULK_STALLED;
+}
+
+static jr_bulk_send_rc_t coc_send(void *ctx, const uint8_t *sdu, size_t len) {
+  (void)ctx;
+  struct ble_l2cap_chan *chan = g_coc_chan;
+  if (!chan) {
+    return JR_BULK_SEND_ERROR;
+  }
+
+  // SDUs span several msys blocks; L2CAP segments them per credit
+  struct os_mbuf *om = os_msys_get_pkthdr((uint16_t)len, 0);
+  if (!om) {
+    return JR_BULK_SEND_BUSY;
+  }
+  if (os_mbuf_append(om, sdu, (uint16_t)len) != 0) {
+    os_mbuf_free_chain(om);
+    return JR_BULK_SEND_BUSY;
+  }
+
+  const int rc = ble_l2cap_send(chan, om);
+  if (rc == 0) {
+    return JR_BULK_SEND_OK;
+  }
+  if (rc == BLE_HS_ESTALLED) {
+    return JR_BULK_SEND_STALLED; // queued; TX_UNSTALLED follows
+  }
+  os_mbuf_free_chain(om); // not consumed on other errors
+  if (rc == BLE_HS_EBUSY || rc == BLE_HS_ENOMEM) {
+    return JR_BULK_SEND_BUSY;
+  }
+  ESP_LOGW(TAG, "l2cap send rc=%d", rc);
+  return JR_BULK_SEND_ERROR;
+}
+
+static size_t coc_read(void *ctx, uint32_t *cursor, uint8_t *buf, size_t cap) {
+  (void)ctx;
+  return g_sync_source->read(cursor, buf, cap);
+}
+
+static void bulk_log(const char *why) {
+  const int64_t elapsed_us = esp_timer_get_time() - g_bulk_start_us;
+  const uint32_t bytes_per_s =
+      elapsed_us > 0 ? (uint32_t)((uint64_t)g_bulk.bytes * 1000000 / elapsed_us)
+                     : 0;
+  ESP_LOGI(TAG,
+           "Bulk %s: %" PRIu32 " bytes in %" PRId64 " ms (%" PRIu32
+           ".%02" PRIu32 " KB/s), sdus=%" PRIu32 " stalls=%" PRIu32
+           " busy=%" PRIu32 ", next=%" PRIu32,
+           why, g_bulk.bytes, elapsed_us / 1000, bytes_per_s / 1024,
+           (bytes_per_s % 1024) * 100 / 1024, g_bulk.sdus, g_bulk.stalls,
+           g_bulk.busy, g_bulk.cursor);
+}
+
+// Starts a requested transfer once the channel is up and pumps it. Returns
+// how long notify_task may sleep.
+static TickType_t bulk_service(void) {
+  const bool was_active = bulk_active();
+
+  if (!g_coc_chan) {
+    if (g_bulk.state == JR_BULK_RUNNING || g_bulk.state == JR_BULK_STALLED) {
+      bulk_log("aborted");
+      jr_bulk_tx_abort(&g_bulk);
+    }
+    return portMAX_DELAY; // a requested transfer waits for the channel
+  }
+
+  if (g_bulk_requested) {
+    g_bulk_requested = false;
+    const jr_bulk_io_t io = {coc_send, coc_read, NULL};
+    size_t cap = sizeof(g_bulk_buf);
+    if (g_coc_peer_mtu != 0 && g_coc_peer_mtu < cap) {
+      cap = g_coc_peer_mtu;
+    }
+    if (cap < BULK_MIN_SDU) {
+      // No record would fit, and an empty transfer would look complete
+      ESP_LOGW(TAG, "Bulk refused: peer MTU %u < %u", (unsigned)cap,
+               (unsigned)BULK_MIN_SDU);
+    } else {
+      jr_bulk_tx_init(&g_bulk, &io, g_bulk_buf, cap);
+      jr_bulk_tx_start(&g_bulk, g_bulk_cursor);
+      g_bulk_start_us = esp_timer_get_time();
+      ESP_LOGI(TAG, "Bulk START from %" PRIu32 " (sdu=%u)", g_bulk_cursor,
+               (unsigned)cap);
+    }
+  }
+
+  if (g_coc_unstalled) {
+    g_coc_unstalled = false;
+    jr_bulk_tx_unstalled(&g_bulk);
+  }
+
+  const jr_bulk_state_t state = jr_bulk_tx_pump(&g_bulk);
+  if (was_active && !bulk_active()) {
+    bulk_log(state == JR_BULK_DONE ? "done" : "failed");
+    link_apply_all();
+  }
+
+  // BUSY leaves the SDU pending without a wake-up event; poll for it
+  return (state == JR_BULK_RUNNING) ? SYNC_RETRY_TICKS : portMAX_DELAY;
+}
+
+// Hands NimBLE a buffer for the next SDU from the client.
+static void coc_recv_ready(struct ble_l2cap_chan *chan) {
+  struct os_mbuf *om = os_msys_get_pkthdr(0, 0);
+  if (!om || ble_l2cap_recv_ready(chan, om) != 0) {
+    ESP_LOGW(TAG, "No L2CAP receive buffer");
+    if (om) {
+      os_mbuf_free_chain(om);
+    }
+  }
+}
+
+static int coc_event_cb(struct ble_l2cap_event *event, void *arg) {
+  (void)arg;
+
+  switch (event->type) {
+  case BLE_L2CAP_EVENT_COC_CONNECTED:
+    if (event->connect.status == 0) {
+      struct ble_l2cap_chan_info info;
+      g_coc_peer_mtu = 0;
+      if (ble_l2cap_get_chan_info(event->connect.chan, &info) == 0) {
+        g_coc_peer_mtu = info.peer_coc_mtu;
+      }
+      g_coc_chan = event->connect.chan;
+      g_coc_conn = event->connect.conn_handle;
+      ESP_LOGI(TAG, "L2CAP channel open (conn=%d psm=0x%04x peer_mtu=%u)",
+               (int)g_coc_conn, (unsigned)JR_BLE_COC_PSM,
+               (unsigned)g_coc_peer_mtu);
+      notify_wake();
+    } else {
+      ESP_LOGW(TAG, "L2CAP connect failed; status=%d", event->connect.status);
+    }
+    return 0;
+
+  case BLE_L2CAP_EVENT_COC_DISCONNECTED:
+    ESP_LOGI(TAG, "L2CAP channel closed");
+    g_coc_chan = NULL;
+    g_coc_conn = BLE_HS_CONN_HANDLE_NONE;
+    notify_wake();
+    return 0;
+
+  case BLE_L2CAP_EVENT_COC_ACCEPT:
+    coc_recv_ready(event->accept.chan);
+    return 0;
+
+  case BLE_L2CAP_EVENT_COC_DATA_RECEIVED:
+    // Nothing is expected from the client on this channel
+    if (event->receive.sdu_rx) {
+      os_mbuf_free_chain(event->receive.sdu_rx);
+    }
+    coc_recv_ready(event->receive.chan);
+    return 0;
+
+  case BLE_L2CAP_EVENT_COC_TX_UNSTALLED:
+    g_coc_unstalled = true;
+    notify_wake();
+    return 0;
+
+  default:
+    return 0;
+  }
+}
+
+#endif // JR_BLE_HAS_COC
+
+/* =========================
+   LINK POLICY
+   ========================= */
+
+struct link_profile_def_t {
+  uint16_t itvl_min; // 1.25 ms units
+  uint16_t itvl_max;
+  uint16_t latency;  // connection events the peripheral may skip
+  uint16_t timeout;  // 10 ms units
+  bool fast_phy;     // also request 2M PHY and maximum data length
+};
+
+// Throughput: 7.5-15 ms interval so a full batch leaves every event.
+static constexpr link_profile_def_t LINK_THROUGHPUT = {6, 12, 0, 400, true};
+// Eco: 60-120 ms interval; with latency 4 an idle link wakes the radio
+// roughly every 0.5 s. Timeout leaves room for (1 + latency) * 2 intervals.
+static constexpr link_profile_def_t LINK_ECO = {48, 96, 4, 600, false};
+
+static const char *link_profile_name(jr_link_profile_t p) {
+  switch (p) {
+  case JR_LINK_THROUGHPUT:
+    return "throughput";
+  case JR_LINK_ECO:
+    return "eco";
+  default:
+    return "auto";
+  }
+}
+
+static void link_log(const jr_conn_t *c, const char *why) {
+  const jr_link_params_t &l = c->link;
+  ESP_LOGI(TAG,
+           "Link conn=%d (%s): interval=%u.%02u ms latency=%u timeout=%u ms "
+           "phy=%u/%u tx_octets=%u [%s]",
+           (int)c->handle, why, (unsigned)(l.interval * 125 / 100),
+           (unsigned)(l.interval * 125 % 100), (unsigned)l.latency,
+           (unsigned)l.timeout * 10, (unsigned)l.tx_phy, (unsigned)l.rx_phy,
+           (unsigned)l.tx_octets, link_profile_name(l.profile));
+}
+
+static void link_refresh_conn_params(jr_conn_t *c) {
+  struct ble_gap_conn_desc desc;
+  if (ble_gap_conn_find(c->handle, &desc) == 0) {
+    c->link.interval = desc.conn_itvl;
+    c->link.latency = desc.conn_latency;
+    c->link.timeout = desc.supervision_timeout;
+  }
+}
+
+// Asks one central for the parameters of the wanted profile, if it changed.
+// Called from the host task and notify_task; the profile is claimed under
+// g_lock so only one of them sends the requests.
+static void link_apply(jr_conn_t *c) {
+  if (!c || c->handle == BLE_HS_CONN_HANDLE_NONE) {
+    return;
+  }
+  const uint16_t conn = c->handle;
+
+  jr_link_profile_t want = g_link_request;
+  if (want == JR_LINK_AUTO) {
+    bool bulk = conn_streams(*c, JR_STREAM_RAW) ||
+                conn_streams(*c, JR_STREAM_SELFTEST) ||
+                (g_sync_active && g_sync_conn == conn);
+#if JR_BLE_HAS_COC
+    bulk = bulk || (bulk_active() && g_coc_conn == conn);
+#endif
+    want = bulk ? JR_LINK_THROUGHPUT : JR_LINK_ECO;
+  }
+  portENTER_CRITICAL(&g_lock);
+  const bool changed = want != c->link.profile;
+  c->link.profile = want;
+  portEXIT_CRITICAL(&g_lock);
+  if (!changed) {
+    return;
+  }
+
+  const link_profile_def_t &def =
+      (want == JR_LINK_THROUGHPUT) ? LINK_THROUGHPUT : LINK_ECO;
+
+  struct ble_gap_upd_params params;
+  memset(&params, 0, sizeof(params));
+  params.itvl_min = def.itvl_min;
+  params.itvl_max = def.itvl_max;
+  params.latency = def.latency;
+  params.supervision_timeout = def.timeout;
+
+  int rc = ble_gap_update_params(conn, &params);
+  if (rc != 0) {
+    ESP_LOGW(TAG, "Conn param update failed; rc=%d", rc);
+  }
+
+  if (def.fast_phy) {
+    rc = ble_gap_set_prefered_le_phy(conn, BLE_GAP_LE_PHY_2M_MASK,
+                                     BLE_GAP_LE_PHY_2M_MASK,
+                                     BLE_GAP_LE_PHY_CODED_ANY);
+    if (rc != 0) {
+      ESP_LOGW(TAG, "2M PHY request failed; rc=%d", rc);
+    }
+    rc = ble_gap_set_data_len(conn, LINK_MAX_TX_OCTETS, LINK_MAX_TX_TIME_US);
+    if (rc != 0) {
+      ESP_LOGW(TAG, "Data length update failed; rc=%d", rc);
+    }
+  }
+
+  ESP_LOGI(TAG, "Link profile conn=%d -> %s", (int)conn,
+           link_profile_name(want));
+}
+
+static void link_apply_all(void) {
+  for (jr_conn_t &c : g_conns) {
+    link_apply(&c);
+  }
+}
+
+/* =========================
+   GATT CALLBACKS
+   ========================= */
+
+// Switches a client to summary records in the given packet version.
+static void stream_summary(jr_conn_t *c, uint8_t version) {
+  portENTER_CRITICAL(&g_lock);
+  c->fill_count = 0; // seqs from an earlier stream mean nothing now
+  portEXIT_CRITICAL(&g_lock);
+  c->packet_version = version;
+  c->mode = JR_STREAM_SUMMARY;
+  c->streaming = true;
+  ble_npl_callout_stop(&g_session_orphan);
+}
+
+/* =========================
+   SESSION SUMMARY
+   ========================= */
+
+// Freezes the aggregates at STOP and logs them.
+static void session_finish(void) {
+  jr_session_summary_t sum;
+  const uint32_t now_ms = uptime_ms();
+  portENTER_CRITICAL(&g_lock);
+  jr_session_stop(&g_session, now_ms);
+  jr_session_summary(&g_session, now_ms, &sum);
+  portEXIT_CRITICAL(&g_lock);
+
+  ESP_LOGI(TAG,
+           "Session %" PRIu32 ": %" PRIu32 " jumps in %" PRIu32
+           " s (active %" PRIu32 " s), cadence %u/%u jpm, streak %" PRIu32
+           ", HR %u/%u/%u",
+           sum.session_id, sum.jumps, sum.duration_ms / 1000,
+           sum.active_ms / 1000, (unsigned)sum.cadence_avg_jpm,
+           (unsigned)sum.cadence_max_jpm, sum.longest_streak,
+           (unsigned)sum.hr_min_bpm, (unsigned)sum.hr_avg_bpm,
+           (unsigned)sum.hr_max_bpm);
+}
+
+static void session_end(void) {
+  ble_npl_callout_stop(&g_session_orphan);
+  g_session_active = false;
+  session_finish();
+}
+
+static void session_orphan_cb(struct ble_npl_event *ev) {
+  (void)ev;
+  if (g_session_active && !stream_any(JR_STREAM_SUMMARY)) {
+    ESP_LOGI(TAG, "No client resumed the session in %u s; ending it",
+             (unsigned)(JR_BLE_SESSION_ORPHAN_MS / 1000));
+    session_end();
+  }
+}
+
+/* =========================
+   CLOCK SYNC
+   ========================= */
+
+// Answers a control read with the last 0x07 request's token, when it arrived
+// and now. The client brackets the write and the read with its own clock and
+// estimates offset and drift from several exchanges (NTP style); the
+// exchange with the shortest round trip bounds the error best.
+static int clock_sync_read(const jr_conn_t &c,
+                           struct ble_gatt_access_ctxt *ctxt) {
+  if (c.clock_rx_us == 0) {
+    return BLE_ATT_ERR_READ_NOT_PERMITTED; // no 0x07 written yet
+  }
+  jr_clock_sync_v1_t reply;
+  reply.token = c.clock_token;
+  reply.rx_us = (uint64_t)c.clock_rx_us;
+  reply.tx_us = (uint64_t)esp_timer_get_time();
+  return (os_mbuf_append(ctxt->om, &reply, sizeof(reply)) == 0)
+             ? 0
+             : BLE_ATT_ERR_INSUFFICIENT_RES;
+}
+
+/* =========================
+   RUNTIME PARAMETERS (host task)
+   ========================= */
+
+// Response to the last control 0x09, served by params reads
+static uint8_t g_params_resp[NOTIFY_MAX_PAYLOAD];
+static uint16_t g_params_resp_len = 0;
+
+// Restores tuned values; called once before the tasks start.
+static void params_load(void) {
+  nvs_handle_t nvs;
+  if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+    return; // nothing stored yet
+  }
+  uint8_t blob[JR_PARAMS_SAVE_MAX];
+  size_t len = sizeof(blob);
+  if (nvs_get_blob(nvs, "params", blob, &len) == ESP_OK) {
+    const size_t applied = jr_params_load(blob, len);
+    ESP_LOGI(TAG, "Loaded %u tuned parameters", (unsigned)applied);
+  }
+  nvs_close(nvs);
+}
+
+// Stores the values that differ from their defaults.
+static void params_save(void) {
+  uint8_t blob[JR_PARAMS_SAVE_MAX];
+  const size_t len = jr_params_save(blob, sizeof(blob));
+  nvs_handle_t nvs;
+  if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+    ESP_LOGW(TAG, "Parameters not saved (NVS unavailable)");
+    return;
+  }
+  const esp_err_t err = (len > 0) ? nvs_set_blob(nvs, "params", blob, len)
+                                  : nvs_erase_key(nvs, "params");
+  if (err == ESP_OK || err == ESP_ERR_NVS_NOT_FOUND) {
+    nvs_commit(nvs);
+  } else {
+    ESP_LOGW(TAG, "Parameters not saved; err=%d", (int)err);
+  }
+  nvs_close(nvs);
+}
+
+// Control 0x09 [u8 token, TLV items]: runs the request, persists changes
+// and acknowledges on the params characteristic.
+static int params_request(jr_conn_t *c, struct ble_gatt_access_ctxt *ctxt) {
+  uint8_t buf[NOTIFY_MAX_PAYLOAD];
+  uint16_t len = 0;
+  if (ble_hs_mbuf_to_flat(ctxt->om, buf, sizeof(buf), &len) != 0 ||
+      len < 2) {
+    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+  }
+
+  bool changed = false;
+  g_params_resp_len = (uint16_t)jr_params_handle(
+      buf[1], buf + 2, len - 2, g_params_resp, conn_payload(*c), &changed);
+  if (g_params_resp[1] != JR_PARAM_OK) {
+    ESP_LOGW(TAG, "Parameter request (conn=%d) failed; status=%u",
+             (int)c->handle, (unsigned)g_params_resp[1]);
+  }
+  if (changed) {
+    params_save();
+    for (size_t i = 0; i < jr_param_count; i++) {
+      const jr_param_def_t &d = jr_param_defs[i];
+      ESP_LOGI(TAG, "param %s = %" PRIu32, d.name,
+               jr_param_get((jr_param_id_t)d.id));
+    }
+    notify_wake(); // batching deadlines may have moved
+  }
+
+  if (c->params_notify && g_params_val_handle != 0) {
+    struct os_mbuf *om =
+        ble_hs_mbuf_from_flat(g_params_resp, g_params_resp_len);
+    if (!om ||
+        ble_gatts_notify_custom(c->handle, g_params_val_handle, om) != 0) {
+      ESP_LOGD(TAG, "params notify conn=%d failed", (int)c->handle);
+    }
+  }
+  return 0;
+}
+
+static int ctrl_access_cb(uint16_t conn_handle, uint16_t attr_handle,
+                          struct ble_gatt_access_ctxt *ctxt, void *arg) {
+  (void)attr_handle;
+  (void)arg;
+
+  // Stamped first so the clock sync reply leaves out our own processing
+  const int64_t rx_us = esp_timer_get_time();
+
+  jr_conn_t *c = conn_find(conn_handle);
+  if (!c) {
+    return BLE_ATT_ERR_UNLIKELY;
+  }
+  if (ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR) {
+    return clock_sync_read(*c, ctxt);
+  }
+  if (ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR) {
+    return BLE_ATT_ERR_UNLIKELY;
+  }
+
+  uint8_t cmd = 0;
+  if (OS_MBUF_PKTLEN(ctxt->om) < 1) {
+    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+  }
+
+  // Only the opcode here; commands with arguments read the rest themselves
+  if (os_mbuf_copydata(ctxt->om, 0, sizeof(cmd), &cmd) != 0) {
+    return BLE_ATT_ERR_UNLIKELY;
+  }
+
+  // Start and resume take an optional packet version
+  uint8_t version = 1;
+  if (cmd == 0x01 || cmd == 0x03) {
+    uint8_t buf[2] = {0};
+    const uint16_t len = OS_MBUF_PKTLEN(ctxt->om);
+    if (len > sizeof(buf)) {
+      return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
+    if (ble_hs_mbuf_to_flat(ctxt->om, buf, sizeof(buf), NULL) != 0) {
+      return BLE_ATT_ERR_UNLIKELY;
+    }
+    if (len == sizeof(buf)) {
+      version = buf[1];
+    }
+    if (version < 1 || version > JR_TELEMETRY_VERSION) {
+      ESP_LOGW(TAG, "Unsupported packet version %u", (unsigned)version);
+      return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+    }
+  }
+
+  if (cmd == 0x03 && !g_session_active) {
+    ESP_LOGW(TAG, "Resume without a session; starting a new one");
+    cmd = 0x01;
+  }
+
+  if (cmd == 0x01) {
+    // Capture baseline at START (transmitted jumps will begin at 0)
+    portENTER_CRITICAL(&g_lock);
+    g_session_baseline = g_jump_total;
+    g_session_id++;
+    g_session_user = c->user_id;
+    g_session_active = true;
+    jr_session_start(&g_session, g_session_id, uptime_ms(), g_jump_total,
+                     g_hr_bpm);
+    portEXIT_CRITICAL(&g_lock);
+
+    c->jump_baseline = g_session_baseline;
+    stream_summary(c, version);
+    ESP_LOGI(TAG,
+             "Streaming START (conn=%d, v%u, session=%" PRIu32
+             ", user=%" PRIu32 ", reset_on_start=%d, baseline=%" PRIu32 ")",
+             (int)conn_handle, (unsigned)version, g_session_id,
+             g_session_user, (int)g_reset_on_start, c->jump_baseline);
+    link_apply(c);
+    notify_wake();
+  } else if (cmd == 0x03) {
+    // Join the session with its baseline; a reconnecting client synced the
+    // gap already, a second client just follows from here
+    c->jump_baseline = g_session_baseline;
+    stream_summary(c, version);
+    ESP_LOGI(TAG, "Streaming RESUME (conn=%d, v%u, session=%" PRIu32 ")",
+             (int)conn_handle, (unsigned)version, g_session_id);
+    if (g_disconnect_us != 0) {
+      ESP_LOGI(TAG, "Resumed %" PRId64 " ms after the disconnect",
+               (rx_us - g_disconnect_us) / 1000);
+      g_disconnect_us = 0;
+    }
+    link_apply(c);
+    notify_wake();
+  } else if (cmd == 0x02) {
+    uint8_t buf[3] = {0};
+    const uint16_t len = OS_MBUF_PKTLEN(ctxt->om);
+    if (len != 1 && len != 3) {
+      return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
+    if (ble_hs_mbuf_to_flat(ctxt->om, buf, sizeof(buf), NULL) != 0) {
+      return BLE_ATT_ERR_UNLIKELY;
+    }
+
+    const uint16_t rate =
+        (len == 3) ? (uint16_t)(buf[1] | (buf[2] << 8)) : RAW_DEFAULT_RATE_HZ;
+    if (rate < RAW_MIN_RATE_HZ || rate > RAW_MAX_RATE_HZ) {
+      ESP_LOGW(TAG, "Raw rate %u Hz out of range", (unsigned)rate);
+      return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+    }
+    if (c->mtu < RAW_MIN_MTU) {
+      ESP_LOGW(TAG, "Raw streaming needs MTU >= %u (have %u)",
+               (unsigned)RAW_MIN_MTU, (unsigned)c->mtu);
+      return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+
+    if (!stream_any(JR_STREAM_RAW)) {
+      portENTER_CRITICAL(&g_lock);
+      g_raw_head = g_raw_tail = 0;
+      g_raw_overflows = 0;
+      portEXIT_CRITICAL(&g_lock);
+    }
+
+    c->raw_rate_hz = rate;
+    c->mode = JR_STREAM_RAW;
+    c->streaming = true;
+    ESP_LOGI(TAG, "Raw streaming START (conn=%d, %u Hz, frames at %u Hz)",
+             (int)conn_handle, (unsigned)rate, (unsigned)raw_rate());
+    link_apply(c);
+    notify_wake();
+  } else if (cmd == 0x04) {
+#if JR_BLE_HAS_COC
+    uint8_t buf[5] = {0};
+    if (OS_MBUF_PKTLEN(ctxt->om) != sizeof(buf)) {
+      return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
+    if (!g_sync_source) {
+      return BLE_ATT_ERR_REQ_NOT_SUPPORTED;
+    }
+    if (g_coc_chan && g_coc_conn != conn_handle) {
+      ESP_LOGW(TAG, "Bulk channel belongs to conn=%d", (int)g_coc_conn);
+      return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    if (g_coc_chan && g_coc_peer_mtu < BULK_MIN_SDU) {
+      ESP_LOGW(TAG, "Bulk needs peer MTU >= %u (have %u)",
+               (unsigned)BULK_MIN_SDU, (unsigned)g_coc_peer_mtu);
+      return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    if (ble_hs_mbuf_to_flat(ctxt->om, buf, sizeof(buf), NULL) != 0) {
+      return BLE_ATT_ERR_UNLIKELY;
+    }
+    memcpy(&g_bulk_cursor, buf + 1, sizeof(g_bulk_cursor));
+    g_bulk_requested = true;
+    ESP_LOGI(TAG, "Bulk requested from %" PRIu32 "%s", g_bulk_cursor,
+             g_coc_chan ? "" : " (waiting for L2CAP channel)");
+    link_apply(c);
+    notify_wake();
+#else
+    return BLE_ATT_ERR_REQ_NOT_SUPPORTED;
+#endif
+  } else if (cmd == 0x05) {
+    uint8_t buf[2] = {0};
+    if (OS_MBUF_PKTLEN(ctxt->om) != sizeof(buf) ||
+        ble_hs_mbuf_to_flat(ctxt->om, buf, sizeof(buf), NULL) != 0) {
+      return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
+    jr_ble_set_broadcast(buf[1] != 0);
+  } else if (cmd == 0x06) {
+    uint8_t buf[7] = {0};
+    if (OS_MBUF_PKTLEN(ctxt->om) != sizeof(buf) ||
+        ble_hs_mbuf_to_flat(ctxt->om, buf, sizeof(buf), NULL) != 0) {
+      return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
+    if (!conn_streams(*c, JR_STREAM_SUMMARY) || c->packet_version < 2) {
+      return BLE_ATT_ERR_REQ_NOT_SUPPORTED; // seqs are only sent in v2
+    }
+
+    jr_fill_t f;
+    memcpy(&f.seq, buf + 1, sizeof(f.seq));
+    memcpy(&f.count, buf + 5, sizeof(f.count));
+    if (f.count == 0) {
+      return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+    }
+
+    bool queued;
+    portENTER_CRITICAL(&g_lock);
+    queued = c->fill_count < FILL_QUEUE_LEN;
+    if (queued) {
+      c->fills[c->fill_count++] = f;
+      g_delivery.fill_requests++;
+    }
+    portEXIT_CRITICAL(&g_lock);
+    if (!queued) {
+      ESP_LOGW(TAG, "Gap fill queue full (conn=%d)", (int)conn_handle);
+      return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    ESP_LOGD(TAG, "Gap fill conn=%d seq=%" PRIu32 " count=%u",
+             (int)conn_handle, f.seq, (unsigned)f.count);
+    notify_wake();
+  } else if (cmd == 0x07) {
+    uint8_t buf[5] = {0};
+    if (OS_MBUF_PKTLEN(ctxt->om) != sizeof(buf) ||
+        ble_hs_mbuf_to_flat(ctxt->om, buf, sizeof(buf), NULL) != 0) {
+      return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
+    memcpy(&c->clock_token, buf + 1, sizeof(c->clock_token));
+    c->clock_rx_us = rx_us;
+  } else if (cmd == 0x08 && OS_MBUF_PKTLEN(ctxt->om) == 1) {
+    if (conn_streams(*c, JR_STREAM_SELFTEST)) {
+      c->streaming = false; // notify_task sends the report
+      ESP_LOGI(TAG, "Self-test STOP (conn=%d)", (int)conn_handle);
+      notify_wake();
+    }
+  } else if (cmd == 0x08) {
+    uint8_t buf[7] = {0};
+    if (OS_MBUF_PKTLEN(ctxt->om) != sizeof(buf) ||
+        ble_hs_mbuf_to_flat(ctxt->om, buf, sizeof(buf), NULL) != 0) {
+      return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
+    const uint16_t rate = (uint16_t)(buf[1] | (buf[2] << 8));
+    uint16_t size = (uint16_t)(buf[3] | (buf[4] << 8));
+    const uint16_t seconds = (uint16_t)(buf[5] | (buf[6] << 8));
+    if (rate < 1 || rate > SELFTEST_MAX_RATE_HZ || seconds < 1 ||
+        seconds > SELFTEST_MAX_SECONDS) {
+      ESP_LOGW(TAG, "Self-test %u Hz for %u s out of range", (unsigned)rate,
+               (unsigned)seconds);
+      return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+    }
+    if (c->mtu < RAW_MIN_MTU) {
+      ESP_LOGW(TAG, "Self-test needs MTU >= %u (have %u)",
+               (unsigned)RAW_MIN_MTU, (unsigned)c->mtu);
+      return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    if (!c->data_notify) {
+      return BLE_ATT_ERR_REQ_NOT_SUPPORTED; // nowhere to send the frames
+    }
+    if (g_test_active) {
+      ESP_LOGW(TAG, "Self-test already running on conn=%d", (int)g_test.conn);
+      return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+
+    if (size < sizeof(jr_selftest_frame_t)) {
+      size = sizeof(jr_selftest_frame_t);
+    } else if (size > conn_payload(*c)) {
+      size = conn_payload(*c);
+    }
+
+    memset(&g_test, 0, sizeof(g_test));
+    g_test.conn = conn_handle;
+    g_test.rate_hz = rate;
+    g_test.size = size;
+    g_test.duration_ms = (uint32_t)seconds * 1000;
+    g_test.start_us = rx_us;
+    g_test.report.type = JR_SELFTEST_REPORT_TYPE;
+    g_test.report.tick_hz = (uint16_t)configTICK_RATE_HZ;
+    g_test.report.rate_hz = rate;
+    g_test.report.size = size;
+    g_test.report.pool_min_free = UINT16_MAX;
+    g_test_active = true;
+
+    c->mode = JR_STREAM_SELFTEST;
+    c->streaming = true;
+    ESP_LOGI(TAG, "Self-test START (conn=%d, %u Hz, %u B, %u s)",
+             (int)conn_handle, (unsigned)rate, (unsigned)size,
+             (unsigned)seconds);
+    link_apply(c);
+    notify_wake();
+  } else if (cmd == 0x09) {
+    return params_request(c, ctxt);
+  } else if (cmd == 0x0A) {
+    uint8_t buf[5] = {0};
+    if (OS_MBUF_PKTLEN(ctxt->om) != sizeof(buf) ||
+        ble_hs_mbuf_to_flat(ctxt->om, buf, sizeof(buf), NULL) != 0) {
+      return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
+    memcpy(&c->user_id, buf + 1, sizeof(c->user_id));
+    ESP_LOGI(TAG, "User %" PRIu32 " (conn=%d)", c->user_id, (int)conn_handle);
+  } else if (cmd == 0x00) {
+    // Stops this client's stream. The session ends unless another client
+    // is still streaming it, so a client that reconnected without resuming
+    // can still end it; a follower stopping leaves the others' session alone.
+    c->streaming = false;
+    const bool ends = g_session_active && !stream_any(JR_STREAM_SUMMARY);
+    ESP_LOGI(TAG, "Streaming STOP (conn=%d)%s", (int)conn_handle,
+             ends ? ", session ended" : "");
+    if (ends) {
+      session_end();
+    }
+    link_apply(c);
+    notify_wake();
+  } else {
+    ESP_LOGW(TAG, "Unknown control cmd: 0x%02X", cmd);
+  }
+
+  return 0;
+}
+
+static int data_access_cb(uint16_t conn_handle, uint16_t attr_handle,
+                          struct ble_gatt_access_ctxt *ctxt, void *arg) {
+  (void)attr_handle;
+  (void)arg;
+
+  if (ctxt->op != BLE_GATT_ACCESS_OP_READ_CHR) {
+    return BLE_ATT_ERR_UNLIKELY;
+  }
+
+  const jr_conn_t *c = conn_find(conn_handle);
+  jr_telemetry_t pkt;
+  build_packet(&pkt);
+  pkt.jump_count = jump_relative(pkt.jump_count,
+                                 c ? c->jump_baseline : g_session_baseline);
+
+  uint8_t rec[JR_TELEMETRY_V1_SIZE];
+  jr_telemetry_pack(&pkt, 1, rec, sizeof(rec));
+  return (os_mbuf_append(ctxt->om, rec, sizeof(rec)) == 0)
+             ? 0
+             : BLE_ATT_ERR_INSUFFICIENT_RES;
+}
+
+static int summary_access_cb(uint16_t conn_handle, uint16_t attr_handle,
+                             struct ble_gatt_access_ctxt *ctxt, void *arg) {
+  (void)conn_handle;
+  (void)attr_handle;
+  (void)arg;
+
+  if (ctxt->op != BLE_GATT_ACCESS_OP_READ_CHR) {
+    return BLE_ATT_ERR_UNLIKELY;
+  }
+
+  jr_session_summary_t sum;
+  jr_ble_get_session_summary(&sum);
+  uint8_t buf[JR_SESSION_SUMMARY_SIZE];
+  jr_session_encode(&sum, buf, sizeof(buf));
+  return (os_mbuf_append(ctxt->om, buf, sizeof(buf)) == 0)
+             ? 0
+             : BLE_ATT_ERR_INSUFFICIENT_RES;
+}
+
+static int params_access_cb(uint16_t conn_handle, uint16_t attr_handle,
+                            struct ble_gatt_access_ctxt *ctxt, void *arg) {
+  (void)conn_handle;
+  (void)attr_handle;
+  (void)arg;
+
+  if (ctxt->op != BLE_GATT_ACCESS_OP_READ_CHR) {
+    return BLE_ATT_ERR_UNLIKELY;
   }
-
-  return 0;
+  return (os_mbuf_append(ctxt->om, g_params_resp, g_params_resp_len) == 0)
+             ? 0
+             : BLE_ATT_ERR_INSUFFICIENT_RES;
 }
 
-static int data_access_cb(uint16_t conn_handle, uint16_t attr_handle,
-                          struct ble_gatt_access_ctxt *ctxt, void *arg) {
+static int hrv_access_cb(uint16_t conn_handle, uint16_t attr_handle,
+                         struct ble_gatt_access_ctxt *ctxt, void *arg) {
   (void)conn_handle;
   (void)attr_handle;
   (void)arg;
@@ -194,14 +2144,96 @@ static int data_access_cb(uint16_t conn_handle, uint16_t attr_handle,
     return BLE_ATT_ERR_UNLIKELY;
   }
 
-  jr_packet_v1_t pkt;
-  build_packet(&pkt);
+  jr_hrv_v1_t hrv;
+  portENTER_CRITICAL(&g_lock);
+  hrv = g_hrv;
+  portEXIT_CRITICAL(&g_lock);
 
-  return (os_mbuf_append(ctxt->om, &pkt, sizeof(pkt)) == 0)
+  return (os_mbuf_append(ctxt->om, &hrv, sizeof(hrv)) == 0)
              ? 0
              : BLE_ATT_ERR_INSUFFICIENT_RES;
 }
 
+static int sync_access_cb(uint16_t conn_handle, uint16_t attr_handle,
+                          struct ble_gatt_access_ctxt *ctxt, void *arg) {
+  (void)attr_handle;
+  (void)arg;
+
+  if (!g_sync_source && !g_event_source) {
+    return BLE_ATT_ERR_REQ_NOT_SUPPORTED;
+  }
+
+  if (ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR) {
+    // u32 oldest, u32 next, u16 bulk PSM (0 = no L2CAP channel), then the
+    // event range; a missing source reads as an empty range
+    uint8_t out[18];
+    uint32_t range[4] = {0, 0, 0, 0};
+    if (g_sync_source) {
+      g_sync_source->range(&range[0], &range[1]);
+    }
+    if (g_event_source) {
+      g_event_source->range(&range[2], &range[3]);
+    }
+    const uint16_t psm = (JR_BLE_HAS_COC && g_sync_source) ? JR_BLE_COC_PSM : 0;
+    memcpy(out, &range[0], 8);
+    memcpy(out + 8, &psm, sizeof(psm));
+    memcpy(out + 10, &range[2], 8);
+    return (os_mbuf_append(ctxt->om, out, sizeof(out)) == 0)
+               ? 0
+               : BLE_ATT_ERR_INSUFFICIENT_RES;
+  }
+  const jr_conn_t *c = conn_find(conn_handle);
+  if (ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR || !c) {
+    return BLE_ATT_ERR_UNLIKELY;
+  }
+
+  uint8_t buf[5] = {0};
+  const uint16_t len = OS_MBUF_PKTLEN(ctxt->om);
+  if (len != 1 && len != sizeof(buf)) {
+    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+  }
+  if (ble_hs_mbuf_to_flat(ctxt->om, buf, sizeof(buf), NULL) != 0) {
+    return BLE_ATT_ERR_UNLIKELY;
+  }
+
+  if ((buf[0] == 0x01 || buf[0] == 0x02) && len == sizeof(buf)) {
+    const jr_sync_source_t *from =
+        (buf[0] == 0x01) ? g_sync_source : g_event_source;
+    if (!from) {
+      return BLE_ATT_ERR_REQ_NOT_SUPPORTED;
+    }
+    if (c->mtu < SYNC_MIN_MTU) {
+      ESP_LOGW(TAG, "Sync needs MTU >= %u (have %u)", (unsigned)SYNC_MIN_MTU,
+               (unsigned)c->mtu);
+      return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    if (g_sync_active && g_sync_conn != conn_handle) {
+      ESP_LOGW(TAG, "Sync busy with conn=%d", (int)g_sync_conn);
+      return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    memcpy(&g_sync_cursor, buf + 1, sizeof(g_sync_cursor));
+    g_sync_stats = {};
+    g_sync_stats.start_us = esp_timer_get_time();
+    g_sync_from = from;
+    g_sync_conn = conn_handle;
+    g_sync_active = true;
+    ESP_LOGI(TAG, "Sync START %s (conn=%d) from %" PRIu32,
+             (buf[0] == 0x01) ? "journal" : "events", (int)conn_handle,
+             g_sync_cursor);
+    link_apply_all();
+    notify_wake();
+  } else if (buf[0] == 0x00) {
+    if (g_sync_active && g_sync_conn == conn_handle) {
+      g_sync_active = false;
+      ESP_LOGI(TAG, "Sync CANCEL at %" PRIu32, g_sync_cursor);
+      link_apply_all();
+    }
+  } else {
+    return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+  }
+  return 0;
+}
+
 /* =========================
    GATT TABLE
    ========================= */
@@ -212,7 +2244,8 @@ static struct ble_gatt_chr_def gatt_chars[] = {
         ctrl_access_cb,
         NULL,
         NULL,
-        (uint16_t)(BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_NO_RSP),
+        (uint16_t)(BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_NO_RSP |
+                   BLE_GATT_CHR_F_READ),
         0,
         NULL,
         NULL,
@@ -227,6 +2260,47 @@ static struct ble_gatt_chr_def gatt_chars[] = {
         &g_data_val_handle,
         NULL,
     },
+    {
+        (ble_uuid_t *)&JR_HRV_UUID,
+        hrv_access_cb,
+        NULL,
+        NULL,
+        (uint16_t)(BLE_GATT_CHR_F_NOTIFY | BLE_GATT_CHR_F_READ),
+        0,
+        &g_hrv_val_handle,
+        NULL,
+    },
+    {
+        (ble_uuid_t *)&JR_SYNC_UUID,
+        sync_access_cb,
+        NULL,
+        NULL,
+        (uint16_t)(BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_NOTIFY |
+                   BLE_GATT_CHR_F_READ),
+        0,
+        &g_sync_val_handle,
+        NULL,
+    },
+    {
+        (ble_uuid_t *)&JR_SUMMARY_UUID,
+        summary_access_cb,
+        NULL,
+        NULL,
+        BLE_GATT_CHR_F_READ,
+        0,
+        NULL,
+        NULL,
+    },
+    {
+        (ble_uuid_t *)&JR_PARAMS_UUID,
+        params_access_cb,
+        NULL,
+        NULL,
+        (uint16_t)(BLE_GATT_CHR_F_NOTIFY | BLE_GATT_CHR_F_READ),
+        0,
+        &g_params_val_handle,
+        NULL,
+    },
     {0} // terminator
 };
 
@@ -240,6 +2314,61 @@ static const struct ble_gatt_svc_def gatt_svcs[] = {
     {0} // terminator
 };
 
+/* =========================
+   GATT LAYOUT
+   ========================= */
+
+static uint32_t fnv1a(uint32_t h, const void *data, size_t len) {
+  const uint8_t *p = (const uint8_t *)data;
+  for (size_t i = 0; i < len; i++) {
+    h = (h ^ p[i]) * 16777619u;
+  }
+  return h;
+}
+
+// Fingerprint of the attribute table: service and characteristic UUIDs and
+// properties in registration order, which fix the handles NimBLE assigns.
+static uint32_t gatt_layout_hash(void) {
+  uint32_t h = 2166136261u;
+  for (const ble_gatt_svc_def *svc = gatt_svcs; svc->type != 0; svc++) {
+    h = fnv1a(h, &svc->type, sizeof(svc->type));
+    h = fnv1a(h, ((const ble_uuid128_t *)svc->uuid)->value, 16);
+    for (const ble_gatt_chr_def *chr = svc->characteristics; chr->uuid;
+         chr++) {
+      h = fnv1a(h, ((const ble_uuid128_t *)chr->uuid)->value, 16);
+      h = fnv1a(h, &chr->flags, sizeof(chr->flags));
+    }
+  }
+  return h;
+}
+
+// Bonded centrals cache our handles. Service Changed tells them to discover
+// again, so it is sent only when the layout differs from the one stored
+// with the bonds (i.e. after a firmware update that changed it); otherwise
+// a reconnect can skip discovery.
+static void gatt_layout_check(void) {
+  const uint32_t hash = gatt_layout_hash();
+  nvs_handle_t nvs;
+  if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+    ESP_LOGW(TAG, "GATT layout %08" PRIx32 " (NVS unavailable)", hash);
+    return;
+  }
+  uint32_t stored = 0;
+  const esp_err_t err = nvs_get_u32(nvs, "gatt_hash", &stored);
+  if (err == ESP_OK && stored == hash) {
+    ESP_LOGI(TAG, "GATT layout %08" PRIx32 " unchanged", hash);
+  } else {
+    if (err == ESP_OK) {
+      ESP_LOGW(TAG, "GATT layout changed %08" PRIx32 " -> %08" PRIx32
+               "; bonded clients rediscover", stored, hash);
+      ble_svc_gatt_changed(0x0001, 0xFFFF);
+    }
+    nvs_set_u32(nvs, "gatt_hash", hash);
+    nvs_commit(nvs);
+  }
+  nvs_close(nvs);
+}
+
 /* =========================
    GAP / Advertising
    ========================= */
@@ -250,85 +2379,358 @@ static int gap_event_cb(struct ble_gap_event *event, void *arg) {
   (void)arg;
 
   switch (event->type) {
-  case BLE_GAP_EVENT_CONNECT:
-    if (event->connect.status == 0) {
-      g_conn_handle = event->connect.conn_handle;
-      ESP_LOGI(TAG, "Connected (handle=%d)", (int)g_conn_handle);
-    } else {
+  case BLE_GAP_EVENT_CONNECT: {
+    if (event->connect.status != 0) {
       ESP_LOGW(TAG, "Connect failed; status=%d", event->connect.status);
       start_advertising();
+      return 0;
+    }
+
+    const uint16_t conn = event->connect.conn_handle;
+    jr_conn_t *c = conn_alloc(conn);
+    if (!c) {
+      ESP_LOGW(TAG, "Connection table full; dropping handle=%d", (int)conn);
+      ble_gap_terminate(conn, BLE_ERR_REM_USER_CONN_TERM);
+      return 0;
+    }
+    ESP_LOGI(TAG, "Connected (handle=%d, %u/%u)", (int)conn,
+             (unsigned)conn_count(), (unsigned)JR_BLE_MAX_CONN);
+    if (g_disconnect_us != 0) {
+      ESP_LOGI(TAG, "Reconnect after %" PRId64 " ms",
+               (esp_timer_get_time() - g_disconnect_us) / 1000);
+    }
+
+#if JR_BLE_REQUEST_BOND
+    // Bonded peers just restore encryption; the stream does not wait for it
+    int sec_rc = ble_gap_security_initiate(conn);
+    if (sec_rc != 0) {
+      ESP_LOGW(TAG, "Security request failed; rc=%d", sec_rc);
+    }
+#endif
+
+    // Ask for a larger MTU so several records fit one notification
+    int rc = ble_gattc_exchange_mtu(conn, NULL, NULL);
+    if (rc != 0) {
+      ESP_LOGW(TAG, "MTU exchange failed; rc=%d", rc);
+    }
+
+    c->link.profile = JR_LINK_AUTO;
+    c->link.tx_phy = BLE_GAP_LE_PHY_1M;
+    c->link.rx_phy = BLE_GAP_LE_PHY_1M;
+    c->link.tx_octets = 27;
+    link_refresh_conn_params(c);
+    link_log(c, "connect");
+    link_apply(c);
+
+    // Advertising stopped with the connection; keep room for another central
+    if (conn_count() < JR_BLE_MAX_CONN) {
+      start_advertising();
     }
     return 0;
+  }
 
-  case BLE_GAP_EVENT_DISCONNECT:
-    ESP_LOGI(TAG, "Disconnected; reason=%d", event->disconnect.reason);
-    g_conn_handle = BLE_HS_CONN_HANDLE_NONE;
-    g_streaming = false;
+  case BLE_GAP_EVENT_DISCONNECT: {
+    const uint16_t conn = event->disconnect.conn.conn_handle;
+    ESP_LOGI(TAG, "Disconnected (handle=%d); reason=%d", (int)conn,
+             event->disconnect.reason);
+    jr_conn_t *c = conn_find(conn);
+    if (c) {
+      c->handle = BLE_HS_CONN_HANDLE_NONE;
+      c->streaming = false;
+    }
+    if (g_session_active && !stream_any(JR_STREAM_SUMMARY)) {
+      // The session stays active for a resume, but not forever
+      ble_npl_callout_reset(&g_session_orphan,
+                            ble_npl_time_ms_to_ticks32(
+                                JR_BLE_SESSION_ORPHAN_MS));
+    }
+    if (g_sync_conn == conn) {
+      g_sync_active = false;
+      g_sync_conn = BLE_HS_CONN_HANDLE_NONE;
+    }
+    notify_wake(); // drop an open batch nobody wants
+
+    // The central will most likely try to reconnect: advertise fast, and
+    // first directed at it when it is bonded under a fixed address (an RPA
+    // would not match; those get the fast undirected burst)
+    g_disconnect_us = esp_timer_get_time();
+    g_fast_adv_until_us = g_disconnect_us + FAST_ADV_US;
+    const ble_gap_conn_desc &peer = event->disconnect.conn;
+    g_directed_pending =
+        peer.sec_state.bonded &&
+        memcmp(&peer.peer_id_addr, &peer.peer_ota_addr, sizeof(ble_addr_t)) ==
+            0;
+    if (g_directed_pending) {
+      g_reconnect_peer = peer.peer_id_addr;
+    }
+    if (ble_gap_adv_active()) {
+      ble_gap_adv_stop();
+    }
     start_advertising();
     return 0;
+  }
+
+  case BLE_GAP_EVENT_ENC_CHANGE: {
+    struct ble_gap_conn_desc desc;
+    if (event->enc_change.status != 0) {
+      ESP_LOGW(TAG, "Encryption failed: conn=%d status=%d",
+               (int)event->enc_change.conn_handle, event->enc_change.status);
+    } else if (ble_gap_conn_find(event->enc_change.conn_handle, &desc) == 0) {
+      ESP_LOGI(TAG, "Encrypted: conn=%d bonded=%d",
+               (int)event->enc_change.conn_handle,
+               (int)desc.sec_state.bonded);
+    }
+    return 0;
+  }
+
+  case BLE_GAP_EVENT_REPEAT_PAIRING: {
+    // The central lost its keys; drop ours and let it pair again
+    struct ble_gap_conn_desc desc;
+    if (ble_gap_conn_find(event->repeat_pairing.conn_handle, &desc) == 0) {
+      ble_store_util_delete_peer(&desc.peer_id_addr);
+    }
+    return BLE_GAP_REPEAT_PAIRING_RETRY;
+  }
+
+  case BLE_GAP_EVENT_CONN_UPDATE: {
+    jr_conn_t *c = conn_find(event->conn_update.conn_handle);
+    if (event->conn_update.status == 0 && c) {
+      link_refresh_conn_params(c);
+      link_log(c, "update");
+    } else if (event->conn_update.status != 0) {
+      ESP_LOGW(TAG, "Conn update failed; status=%d",
+               event->conn_update.status);
+    }
+    return 0;
+  }
+
+  case BLE_GAP_EVENT_CONN_UPDATE_REQ:
+    // Central-initiated; accept whatever it proposes
+    ESP_LOGI(TAG, "Central requests interval %u-%u latency %u",
+             (unsigned)event->conn_update_req.peer_params->itvl_min,
+             (unsigned)event->conn_update_req.peer_params->itvl_max,
+             (unsigned)event->conn_update_req.peer_params->latency);
+    return 0;
+
+  case BLE_GAP_EVENT_PHY_UPDATE_COMPLETE: {
+    jr_conn_t *c = conn_find(event->phy_updated.conn_handle);
+    if (event->phy_updated.status == 0 && c) {
+      c->link.tx_phy = event->phy_updated.tx_phy;
+      c->link.rx_phy = event->phy_updated.rx_phy;
+      link_log(c, "phy");
+    }
+    return 0;
+  }
+
+#ifdef BLE_GAP_EVENT_DATA_LEN_CHG
+  case BLE_GAP_EVENT_DATA_LEN_CHG: {
+    jr_conn_t *c = conn_find(event->data_len_chg.conn_handle);
+    if (c) {
+      c->link.tx_octets = event->data_len_chg.max_tx_octets;
+      link_log(c, "data length");
+    }
+    return 0;
+  }
+#endif
+
+  case BLE_GAP_EVENT_MTU: {
+    jr_conn_t *c = conn_find(event->mtu.conn_handle);
+    if (c) {
+      c->mtu = event->mtu.value;
+      ESP_LOGI(TAG, "MTU updated: conn=%d %u (%u records/notify)",
+               (int)c->handle, (unsigned)c->mtu,
+               (unsigned)((c->mtu - 3) / JR_TELEMETRY_V1_SIZE));
+    }
+    return 0;
+  }
 
   case BLE_GAP_EVENT_ADV_COMPLETE:
-    // Advertising ended; restart (demo).
-    start_advertising();
+    // Directed burst or fast phase over (or a timeout); start the next phase
+    if (conn_count() < JR_BLE_MAX_CONN) {
+      start_advertising();
+    }
     return 0;
 
-  case BLE_GAP_EVENT_SUBSCRIBE:
+  case BLE_GAP_EVENT_SUBSCRIBE: {
     ESP_LOGI(
         TAG, "Subscribe: conn=%d attr=%d notify=%d indicate=%d",
         (int)event->subscribe.conn_handle, (int)event->subscribe.attr_handle,
         (int)event->subscribe.cur_notify, (int)event->subscribe.cur_indicate);
+    jr_conn_t *c = conn_find(event->subscribe.conn_handle);
+    if (!c) {
+      return 0;
+    }
+    const bool on = event->subscribe.cur_notify != 0;
+    if (event->subscribe.attr_handle == g_data_val_handle) {
+      c->data_notify = on;
+    } else if (event->subscribe.attr_handle == g_hrv_val_handle) {
+      c->hrv_notify = on;
+    } else if (event->subscribe.attr_handle == g_sync_val_handle) {
+      c->sync_notify = on;
+    } else if (event->subscribe.attr_handle == g_params_val_handle) {
+      c->params_notify = on;
+    }
+    notify_wake();
     return 0;
+  }
 
   default:
     return 0;
   }
 }
 
-static void start_advertising(void) {
-  struct ble_gap_adv_params adv;
-  struct ble_hs_adv_fields fields;
+// Fills the live broadcast state (seq and rope_id are left to the caller).
+static void adv_capture(jr_adv_state_t *out) {
+  jr_telemetry_t pkt;
+  build_packet(&pkt);
 
-  memset(&adv, 0, sizeof(adv));
+  out->jump_count = jump_relative(pkt.jump_count, g_session_baseline);
+  out->cadence_jpm = g_cadence_jpm;
+  out->heart_rate_bpm = pkt.heart_rate_bpm;
+  out->flags = (uint8_t)((g_session_active ? JR_ADV_F_SESSION : 0) |
+                         (pkt.heart_rate_bpm ? JR_ADV_F_HR_VALID : 0));
+}
+
+static void adv_set_data(void) {
+  struct ble_hs_adv_fields fields;
+  struct ble_hs_adv_fields rsp;
   memset(&fields, 0, sizeof(fields));
+  memset(&rsp, 0, sizeof(rsp));
 
   fields.flags = BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP;
 
+  // Broadcast payload takes the room of the name and UUID, which go to the
+  // scan response (browsers scan actively, so the service filter still works)
+  uint8_t mfg[JR_ADV_MFG_SIZE];
+  struct ble_hs_adv_fields *id = g_broadcast ? &rsp : &fields;
+  if (g_broadcast) {
+    fields.mfg_data = mfg;
+    fields.mfg_data_len = (uint8_t)jr_adv_encode(&g_adv, mfg, sizeof(mfg));
+  }
+
   // Device name in advertising
   const char *name = ble_svc_gap_device_name();
-  fields.name = (uint8_t *)name;
-  fields.name_len = (uint8_t)strlen(name);
-  fields.name_is_complete = 1;
+  id->name = (uint8_t *)name;
+  id->name_len = (uint8_t)strlen(name);
+  id->name_is_complete = 1;
 
   // IMPORTANT for Web Bluetooth service filter:
   // requestDevice({filters:[{services:[JR_SERVICE_UUID]}]}) needs the service
   // UUID in advertising.
-  fields.uuids128 = (ble_uuid128_t *)&JR_SVC_UUID;
-  fields.num_uuids128 = 1;
-  fields.uuids128_is_complete = 1;
+  id->uuids128 = (ble_uuid128_t *)&JR_SVC_UUID;
+  id->num_uuids128 = 1;
+  id->uuids128_is_complete = 1;
 
   int rc = ble_gap_adv_set_fields(&fields);
   if (rc != 0) {
     ESP_LOGE(TAG, "ble_gap_adv_set_fields failed: rc=%d", rc);
   }
+  rc = ble_gap_adv_rsp_set_fields(&rsp);
+  if (rc != 0) {
+    ESP_LOGE(TAG, "ble_gap_adv_rsp_set_fields failed: rc=%d", rc);
+  }
+}
+
+// Puts a changed broadcast payload on air, at most every JR_BLE_BROADCAST_MS.
+// Returns how long notify_task may sleep.
+static TickType_t broadcast_service(void) {
+  jr_adv_state_t next = g_adv;
+  adv_capture(&next);
+  if (next.jump_count == g_adv.jump_count &&
+      next.cadence_jpm == g_adv.cadence_jpm &&
+      next.heart_rate_bpm == g_adv.heart_rate_bpm &&
+      next.flags == g_adv.flags) {
+    return portMAX_DELAY;
+  }
+
+  const int64_t wait_us = g_adv_update_us + BROADCAST_US - esp_timer_get_time();
+  if (wait_us > 0) {
+    return pdMS_TO_TICKS((uint32_t)((wait_us + 999) / 1000)) + 1;
+  }
+
+  next.seq = (uint8_t)(g_adv.seq + 1);
+  g_adv = next;
+  g_adv_update_us = esp_timer_get_time();
+  adv_set_data();
+  return portMAX_DELAY;
+}
+
+static void start_advertising(void) {
+  struct ble_gap_adv_params adv;
+  memset(&adv, 0, sizeof(adv));
+
+  if (g_broadcast) {
+    adv_capture(&g_adv);
+    g_adv.seq++;
+    g_adv_update_us = esp_timer_get_time();
+  }
+  adv_set_data();
+
+  int rc;
+  if (g_directed_pending) {
+    g_directed_pending = false;
+    adv.conn_mode = BLE_GAP_CONN_MODE_DIR;
+    adv.high_duty_cycle = 1;
+    rc = ble_gap_adv_start(g_own_addr_type, &g_reconnect_peer,
+                           DIRECTED_ADV_MS, &adv, gap_event_cb, NULL);
+    if (rc == 0) {
+      ESP_LOGI(TAG, "Advertising (directed to the last central)...");
+      return;
+    }
+    ESP_LOGW(TAG, "Directed advertising failed: rc=%d", rc);
+    adv.high_duty_cycle = 0;
+  }
 
+  // Fast until g_fast_adv_until_us, then ADV_COMPLETE restarts us slow
+  const int64_t fast_us = g_fast_adv_until_us - esp_timer_get_time();
+  int32_t duration_ms = BLE_HS_FOREVER;
   adv.conn_mode = BLE_GAP_CONN_MODE_UND;
   adv.disc_mode = BLE_GAP_DISC_MODE_GEN;
+  if (g_broadcast) {
+    adv.itvl_min = BROADCAST_ADV_ITVL;
+    adv.itvl_max = BROADCAST_ADV_ITVL;
+  } else if (fast_us > 0) {
+    adv.itvl_min = FAST_ADV_ITVL_MIN;
+    adv.itvl_max = FAST_ADV_ITVL_MAX;
+    duration_ms = (int32_t)((fast_us + 999) / 1000);
+  } else {
+    adv.itvl_min = SLOW_ADV_ITVL_MIN;
+    adv.itvl_max = SLOW_ADV_ITVL_MAX;
+  }
 
-  rc = ble_gap_adv_start(g_own_addr_type, NULL, BLE_HS_FOREVER, &adv,
+  rc = ble_gap_adv_start(g_own_addr_type, NULL, duration_ms, &adv,
                          gap_event_cb, NULL);
   if (rc != 0) {
     ESP_LOGE(TAG, "ble_gap_adv_start failed: rc=%d", rc);
   } else {
-    ESP_LOGI(TAG, "Advertising...");
+    ESP_LOGI(TAG, "Advertising%s...",
+             g_broadcast ? " (broadcast)" : (fast_us > 0 ? " (fast)" : ""));
   }
 }
 
 static void ble_on_sync(void) {
   ble_hs_id_infer_auto(0, &g_own_addr_type);
 
+  // Rope id in broadcasts: low bytes of our address
+  uint8_t addr[6] = {0};
+  ble_hs_id_copy_addr(g_own_addr_type, addr, NULL);
+  g_adv.rope_id = (uint16_t)(addr[0] | (addr[1] << 8));
+
   // This is what shows as device.name in the browser chooser (can be changed).
   ble_svc_gap_device_name_set("JRope-C6");
 
+#if JR_BLE_HAS_COC
+  int rc = ble_l2cap_create_server(JR_BLE_COC_PSM, JR_BLE_COC_MTU,
+                                   coc_event_cb, NULL);
+  if (rc != 0) {
+    ESP_LOGE(TAG, "L2CAP server failed; rc=%d", rc);
+  }
+#endif
+
+  gatt_layout_check();
+
+  // A central that was connected before a reset reconnects quickly
+  g_fast_adv_until_us = esp_timer_get_time() + FAST_ADV_US;
   start_advertising();
 }
 
@@ -343,24 +2745,116 @@ static void ble_on_reset(int reason) {
 static void notify_task(void *param) {
   (void)param;
 
-  const TickType_t period = notify_period_ticks();
-  jr_packet_v1_t pkt;
+  const TickType_t raw_period = sample_period_ticks();
+  int64_t stats_start_us = esp_timer_get_time();
+  TickType_t wait = portMAX_DELAY;
 
   while (true) {
-    if (g_streaming && g_conn_handle != BLE_HS_CONN_HANDLE_NONE &&
-        g_data_val_handle != 0) {
-      build_packet(&pkt);
-
-      // Send 12-byte binary payload
-      struct os_mbuf *om = ble_hs_mbuf_from_flat(&pkt, sizeof(pkt));
-      if (om) {
-        int rc = ble_gatts_notify_custom(g_conn_handle, g_data_val_handle, om);
-        if (rc != 0) {
-          ESP_LOGD(TAG, "notify rc=%d", rc);
+    // Woken by notify_wake() on every state change, or by the deadline
+    ulTaskNotifyTake(pdTRUE, wait);
+    g_batch_stats.wakes++;
+
+    bool summary = false;
+    bool raw = false;
+    bool hrv = false;
+    for (const jr_conn_t &c : g_conns) {
+      summary = summary || conn_wants(c, JR_STREAM_SUMMARY);
+      raw = raw || conn_wants(c, JR_STREAM_RAW);
+      hrv = hrv || (c.handle != BLE_HS_CONN_HANDLE_NONE && c.hrv_notify);
+    }
+    summary = summary && g_data_val_handle != 0;
+    raw = raw && g_data_val_handle != 0;
+
+    // Clients in different modes are served side by side
+    wait = portMAX_DELAY;
+    if (summary) {
+      wait = batch_service();
+    } else {
+      batch_discard();
+    }
+    for (jr_conn_t &c : g_conns) {
+      if (c.fill_count > 0 && conn_wants(c, JR_STREAM_SUMMARY) &&
+          !fill_serve(c) && SYNC_RETRY_TICKS < wait) {
+        wait = SYNC_RETRY_TICKS;
+      }
+    }
+    if (raw) {
+      raw_pump();
+      if (raw_period < wait) {
+        wait = raw_period;
+      }
+    } else {
+      raw_discard();
+    }
+
+    if (g_test_active && g_data_val_handle != 0) {
+      const TickType_t test_wait = selftest_pump();
+      if (test_wait < wait) {
+        wait = test_wait;
+      }
+    }
+    if (g_sync_active) {
+      const TickType_t sync_wait = sync_pump();
+      if (sync_wait < wait) {
+        wait = sync_wait;
+      }
+    }
+    if (g_broadcast && ble_gap_adv_active()) {
+      const TickType_t adv_wait = broadcast_service();
+      if (adv_wait < wait) {
+        wait = adv_wait;
+      }
+    }
+#if JR_BLE_HAS_COC
+    const TickType_t bulk_wait = bulk_service();
+    if (bulk_wait < wait) {
+      wait = bulk_wait;
+    }
+#endif
+
+    const int64_t now_us = esp_timer_get_time();
+    if (!summary) {
+      g_batch_stats = {};
+      g_last_notify_us = 0; // first record goes out as soon as streaming starts
+    }
+    if (!raw) {
+      g_raw_stats = {};
+    }
+    if (!summary && !raw) {
+      stats_start_us = now_us;
+    } else if (now_us - stats_start_us >= BATCH_STATS_PERIOD_US) {
+      if (raw) {
+        raw_log_stats(now_us - stats_start_us);
+      }
+      if (summary) {
+        batch_log_stats(now_us - stats_start_us);
+      }
+      stats_start_us = now_us;
+    }
+
+    // HRV is event-based: only notify when a new beat arrived
+    if (hrv && g_hrv_val_handle != 0) {
+      jr_hrv_v1_t rec;
+      bool pending;
+      portENTER_CRITICAL(&g_lock);
+      pending = g_hrv_pending;
+      rec = g_hrv;
+      g_hrv_pending = false;
+      portEXIT_CRITICAL(&g_lock);
+
+      for (const jr_conn_t &c : g_conns) {
+        if (!pending || c.handle == BLE_HS_CONN_HANDLE_NONE || !c.hrv_notify) {
+          continue;
+        }
+        struct os_mbuf *om = ble_hs_mbuf_from_flat(&rec, sizeof(rec));
+        if (om) {
+          int rc = ble_gatts_notify_custom(c.handle, g_hrv_val_handle, om);
+          if (rc != 0) {
+            ESP_LOGD(TAG, "hrv notify conn=%d rc=%d", (int)c.handle, rc);
+          }
         }
       }
     }
-    vTaskDelay(period);
   }
 }
 
@@ -384,8 +2878,29 @@ void jr_ble_init(void) {
   } else {
     ESP_ERROR_CHECK(ret);
   }
+  // Tuned values apply from boot, before any task reads them
+  params_load();
+
+  for (jr_conn_t &c : g_conns) {
+    c.handle = BLE_HS_CONN_HANDLE_NONE;
+  }
 
   nimble_port_init();
+  ble_npl_callout_init(&g_session_orphan, nimble_port_get_dflt_eventq(),
+                       session_orphan_cb, NULL);
+
+  // Dedicated notification buffers so batching never competes with the host
+  // for msys blocks
+  int rc = os_mempool_init(&g_notify_mempool, NOTIFY_BLOCK_COUNT,
+                           NOTIFY_BLOCK_SIZE, g_notify_mem, "jr_notify");
+  if (rc == 0) {
+    rc = os_mbuf_pool_init(&g_notify_mbuf_pool, &g_notify_mempool,
+                           NOTIFY_BLOCK_SIZE, NOTIFY_BLOCK_COUNT);
+  }
+  if (rc != 0) {
+    ESP_LOGE(TAG, "notify mbuf pool init failed; rc=%d", rc);
+  }
+  ESP_ERROR_CHECK(rc == 0 ? ESP_OK : ESP_FAIL);
 
   ble_svc_gap_init();
   ble_svc_gatt_init();
@@ -396,21 +2911,71 @@ void jr_ble_init(void) {
   ble_hs_cfg.sync_cb = ble_on_sync;
   ble_hs_cfg.reset_cb = ble_on_reset;
 
-  xTaskCreate(notify_task, "jr_notify", 4096, NULL, 5, NULL);
+  // Bonding: Just Works (no display/keys), LE Secure Connections; LTK and
+  // IRK are exchanged both ways and kept in NVS (CONFIG_BT_NIMBLE_NVS_PERSIST)
+  ble_hs_cfg.sm_io_cap = BLE_SM_IO_CAP_NO_IO;
+  ble_hs_cfg.sm_bonding = 1;
+  ble_hs_cfg.sm_mitm = 0;
+  ble_hs_cfg.sm_sc = 1;
+  ble_hs_cfg.sm_our_key_dist =
+      BLE_SM_PAIR_KEY_DIST_ENC | BLE_SM_PAIR_KEY_DIST_ID;
+  ble_hs_cfg.sm_their_key_dist =
+      BLE_SM_PAIR_KEY_DIST_ENC | BLE_SM_PAIR_KEY_DIST_ID;
+  ble_hs_cfg.store_status_cb = ble_store_util_status_rr;
+  ble_store_config_init();
+  ble_att_set_preferred_mtu(JR_BLE_PREFERRED_MTU);
+
+  xTaskCreate(notify_task, "jr_notify", 4096, NULL, 5, &g_notify_task);
   nimble_port_freertos_init(host_task);
 
-  ESP_LOGI(TAG, "jr_ble_init ok (notify_hz=%d)", (int)JR_BLE_NOTIFY_HZ);
+  ESP_LOGI(TAG,
+           "jr_ble_init ok (coalesce=%" PRIu32 " ms, heartbeat=%" PRIu32
+           " ms, max_conn=%d)",
+           jr_param_get(JR_PARAM_COALESCE_MS),
+           jr_param_get(JR_PARAM_HEARTBEAT_MS), (int)JR_BLE_MAX_CONN);
 }
 
 void jr_ble_set_sensor_snapshot(uint32_t jump_count_total,
-                                uint8_t heart_rate_bpm, uint16_t accel_mag,
+                                uint8_t heart_rate_bpm, uint16_t spo2_pct,
                                 uint8_t flags) {
+  const int64_t now_us = esp_timer_get_time();
+  bool changed;
+
   portENTER_CRITICAL(&g_lock);
+  changed = g_jump_total != jump_count_total || g_hr_bpm != heart_rate_bpm ||
+            g_spo2_pct != spo2_pct || g_flags != flags;
   g_jump_total = jump_count_total;
   g_hr_bpm = heart_rate_bpm;
-  g_accel_mag = accel_mag;
+  g_spo2_pct = spo2_pct;
   g_flags = flags;
+  if (changed) {
+    g_snapshot_us = now_us;
+    jr_session_update(&g_session, (uint32_t)(now_us / 1000), jump_count_total,
+                      heart_rate_bpm);
+  }
+  if (changed && !g_snapshot_dirty) {
+    g_snapshot_dirty = true;
+    g_change_us = now_us;
+  }
   portEXIT_CRITICAL(&g_lock);
+
+  if (changed) {
+    notify_wake();
+  }
+}
+
+void jr_ble_set_hrv(uint16_t rr_ms, uint16_t rmssd_x10, uint16_t sdnn_x10,
+                    uint16_t intervals) {
+  portENTER_CRITICAL(&g_lock);
+  g_hrv.timestamp_ms = uptime_ms();
+  g_hrv.rr_ms = rr_ms;
+  g_hrv.rmssd_x10 = rmssd_x10;
+  g_hrv.sdnn_x10 = sdnn_x10;
+  g_hrv.intervals = intervals;
+  g_hrv_pending = true;
+  portEXIT_CRITICAL(&g_lock);
+
+  notify_wake();
 }
 
 void jr_ble_set_reset_on_start(bool enable) {
@@ -419,8 +2984,119 @@ void jr_ble_set_reset_on_start(bool enable) {
   portEXIT_CRITICAL(&g_lock);
 }
 
-bool jr_ble_is_streaming(void) { return g_streaming; }
+bool jr_ble_push_raw(uint32_t ts_us, const int16_t *values,
+                     uint8_t channels) {
+  if (!stream_any(JR_STREAM_RAW)) {
+    return false;
+  }
+  if (channels > JR_RAW_MAX_CHANNELS) {
+    channels = JR_RAW_MAX_CHANNELS;
+  }
+
+  bool ok;
+  portENTER_CRITICAL(&g_lock);
+  const uint16_t next = (uint16_t)((g_raw_head + 1) % RAW_QUEUE_LEN);
+  ok = next != g_raw_tail;
+  if (ok) {
+    jr_raw_sample_t &s = g_raw_queue[g_raw_head];
+    s.ts_us = ts_us;
+    for (uint8_t c = 0; c < channels; c++) {
+      s.v[c] = values[c];
+    }
+    g_raw_channels = channels;
+    g_raw_head = next;
+  } else {
+    g_raw_overflows++;
+  }
+  portEXIT_CRITICAL(&g_lock);
+  return ok;
+}
+
+void jr_ble_set_broadcast(bool enable) {
+  g_broadcast = enable;
+  ESP_LOGI(TAG, "Broadcast mode %s (applies to the next advertising)",
+           enable ? "on" : "off");
+  if (ble_gap_adv_active()) {
+    ble_gap_adv_stop();
+    start_advertising();
+  }
+}
+
+void jr_ble_set_cadence(uint16_t jumps_per_min) {
+  if (jumps_per_min != g_cadence_jpm) {
+    g_cadence_jpm = jumps_per_min;
+    portENTER_CRITICAL(&g_lock);
+    jr_session_cadence(&g_session, jumps_per_min);
+    portEXIT_CRITICAL(&g_lock);
+    notify_wake();
+  }
+}
+
+void jr_ble_set_rhythm(uint32_t session_id, uint32_t longest_streak,
+                       uint16_t cadence_avg_jpm) {
+  portENTER_CRITICAL(&g_lock);
+  if (session_id == g_session_id) {
+    jr_session_rhythm(&g_session, longest_streak, cadence_avg_jpm);
+  }
+  portEXIT_CRITICAL(&g_lock);
+}
+
+void jr_ble_set_sync_source(const jr_sync_source_t *source) {
+  g_sync_source = source;
+}
+
+void jr_ble_set_event_source(const jr_sync_source_t *source) {
+  g_event_source = source;
+}
+
+void jr_ble_set_link_profile(jr_link_profile_t profile) {
+  g_link_request = profile;
+  link_apply_all();
+}
+
+bool jr_ble_get_link_params(jr_link_params_t *out) {
+  for (const jr_conn_t &c : g_conns) {
+    if (c.handle != BLE_HS_CONN_HANDLE_NONE) {
+      *out = c.link;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool jr_ble_is_streaming(void) {
+  for (const jr_conn_t &c : g_conns) {
+    if (c.handle != BLE_HS_CONN_HANDLE_NONE && c.streaming) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool jr_ble_session_active(void) { return g_session_active; }
+
+uint32_t jr_ble_session_id(void) { return g_session_id; }
+
+uint32_t jr_ble_session_user(void) { return g_session_user; }
+
+jr_stream_mode_t jr_ble_stream_mode(void) {
+  return stream_any(JR_STREAM_RAW) ? JR_STREAM_RAW : JR_STREAM_SUMMARY;
+}
+
+uint16_t jr_ble_raw_rate_hz(void) {
+  const uint16_t rate = raw_rate();
+  return rate ? rate : RAW_DEFAULT_RATE_HZ;
+}
+
+bool jr_ble_is_connected(void) { return conn_count() > 0; }
 
-bool jr_ble_is_connected(void) {
-  return g_conn_handle != BLE_HS_CONN_HANDLE_NONE;
+uint8_t jr_ble_conn_count(void) { return conn_count(); }
+
+void jr_ble_get_delivery_stats(jr_delivery_stats_t *out) { *out = g_delivery; }
+
+void jr_ble_get_session_summary(jr_session_summary_t *out) {
+  const uint32_t now_ms = uptime_ms();
+  portENTER_CRITICAL(&g_lock);
+  jr_session_summary(&g_session, now_ms, out);
+  portEXIT_CRITICAL(&g_lock);
 }
\ No newline at end of file
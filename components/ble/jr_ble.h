@@ -4,40 +4,244 @@
  *
  * Smart Jump Rope BLE (NimBLE) layer.
  * - Exposes a Nordic UART style service with two characteristics:
- *   - Control (write): 0x01 starts streaming, 0x00 stops streaming
- *   - Data (notify/read): sends 12-byte binary packets (jr_packet_v1_t)
+ *   - Control (write): 0x01 [u8 version] starts streaming, 0x00 stops
+ *     streaming, 0x02 [u16 rate_hz] starts raw sensor streaming (jr_raw_codec
+ *     frames), 0x03 [u8 version] resumes streaming into the current session
+ *     (after a reconnect), 0x04 [u32 cursor] sends stored records over the
+ *     L2CAP bulk channel, 0x05 [u8 enable] switches broadcast (group)
+ *     advertising on/off, 0x06 [u32 seq, u16 count] resends v2 records,
+ *     0x07 [u32 token] starts a clock sync exchange, 0x08 [u16 rate_hz,
+ *     u16 size, u16 seconds] runs the link self-test (0x08 alone stops it),
+ *     0x09 [u8 token, TLV items] gets/sets runtime parameters, 0x0A
+ *     [u32 user] names who the next 0x01 of this client is for
+ *   - Control (read): jr_clock_sync_v1_t for the last 0x07 of this client
+ *   - Data (notify/read): sends version 1 telemetry records (12 bytes), or
+ *     version 2 (16 bytes) / 3 (24 bytes) when 0x01/0x03 asked for it; a
+ *     notification carries as many back-to-back records as the MTU allows
+ *   - HRV (notify/read): 12-byte jr_hrv_v1_t, notified on every new beat
+ *   - Sync (write/notify/read): bulk transfer of stored records from a cursor
+ *     (see "Sync" below)
+ *   - Summary (read): aggregates of the current or last session
+ *     (jr_session.h); final once the session ended
+ *   - Params (notify/read): response to the last 0x09 (jr_params.h)
  *
  * IMPORTANT (contract with frontend):
- * Packet layout (12 bytes, little-endian):
- *   u32 timestamp_ms  (offset 0)
- *   u32 jump_count    (offset 4)
- *   u8  heart_rate    (offset 8)
- *   u16 accel_mag     (offset 9)
- *   u8  flags         (offset 11)
+ * The record layout is JR_TELEMETRY_FIELDS in jr_telemetry.h; the web
+ * client's decoder (app/public/jr_telemetry.js) is generated from it by
+ * tools/jr_schema_gen.cpp. Regenerate it after changing the schema.
+ *
+ * Gap fill (v2): every record gets a sequence number, shared by all clients
+ * and continuous while streaming. The device keeps the last
+ * JR_BLE_RETX_RECORDS records; a client that sees a gap writes control 0x06
+ * with the first missing seq and the count, and the records still held are
+ * notified again on the data characteristic (with a lower seq than the live
+ * ones). Records that already left the ring are not sent.
+ *
+ * Clock sync: version 3 records carry event_us, the device clock (us since
+ * boot, never wraps) when the reported state changed. To map it to its own
+ * clock a client writes control 0x07 with a token at host time t1, reads the
+ * control characteristic back at t4 and gets {token, rx_us, tx_us}:
+ *   offset ~ ((rx_us - t1) + (tx_us - t4)) / 2
+ *   round trip = (t4 - t1) - (tx_us - rx_us)
+ * Repeating the exchange and fitting offset over time gives the drift.
+ *
+ * Sync:
+ *   write [0x01, u32 cursor]  send every stored record with seq >= cursor
+ *   write [0x02, u32 cursor]  same from the event source (the detector's
+ *                             recent decisions; its own seq space)
+ *   write [0x00]              cancel
+ *   read                      u32 oldest, u32 next (stored seq range),
+ *                             u16 L2CAP bulk PSM (0 = not available),
+ *                             u32 oldest, u32 next (event seq range)
+ *   notify                    records packed back-to-back:
+ *                               u32 seq, u8 type, u8 len, payload[len]
+ *                             ending with a record of type JR_SYNC_END_TYPE,
+ *                             len 0, whose seq is the cursor to resume from
+ * The event source is a small RAM ring: records older than its oldest seq
+ * are gone, so a seq jump in the notifications marks lost events.
+ *
+ * Self-test: 0x08 replaces this client's stream with synthetic frames of
+ * the requested size at the requested rate (1-1000 Hz, 1-600 s), sent
+ * through the same notify pool and task as live data. Each frame carries
+ * its seq and schedule (jr_selftest_frame_t); the device counts what the
+ * pool and the host refused and how late the task ran, then notifies a
+ * jr_selftest_report_t. Comparing it with what arrived tells the scheduler,
+ * the buffers and the radio apart. Needs an MTU of at least 64; the size is
+ * clamped to what one notification holds.
+ *
+ * Parameters: notify and batching rates, task rates and jump detector
+ * tolerances are listed in JR_PARAMS (jr_params.h). Control 0x09 carries a
+ * token and GET/SET/RESET items; the device validates the whole request,
+ * applies it, stores the values that differ from the defaults in NVS and
+ * notifies {token, status, VALUE items} on the params characteristic.
+ * Firmware code reads the current values with jr_param_get().
+ *
+ * Users: a client that knows who is jumping writes control 0x0A with a
+ * non-zero user id before 0x01. The session keeps that id
+ * (jr_ble_session_user()) and the firmware stores the user's jump
+ * calibration under it, so the next session of the same user starts with
+ * settled thresholds. 0 (the default) is an anonymous session.
+ *
+ * Bulk channel: a client that opened an L2CAP CoC channel on the PSM above
+ * writes control 0x04 and receives the records as jr_bulk.h SDUs.
+ *
+ * Bonding: the device asks every central to pair (Just Works) and keeps the
+ * keys in NVS, so a returning central re-encrypts without a prompt. After a
+ * disconnect it advertises fast for JR_BLE_FAST_ADV_MS (directed at a bonded
+ * central first) so the client can reconnect and resume with 0x03 quickly.
+ * The attribute table is fixed; Service Changed is only indicated when a
+ * firmware update changes it, so bonded clients may reuse cached handles.
+ *
+ * Several clients (up to JR_BLE_MAX_CONN) can be connected at once. Control
+ * commands apply to the client that wrote them: each has its own stream mode,
+ * raw rate and jump baseline. 0x03 lets a second client join the running
+ * session with its baseline. 0x00 stops the writer's stream and ends the
+ * session unless another client is still streaming it. When the last client
+ * streaming it disconnects, the session ends after JR_BLE_SESSION_ORPHAN_MS
+ * unless a client resumes it with 0x03. Sync and the bulk channel serve one
+ * client at a time; the other gets an "insufficient resources" error.
  */
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+#include "jr_params.h"
+#include "jr_session.h"
+#include "jr_telemetry.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// ===== Packet v1 (12 bytes) =====
+// ===== HRV packet v1 (12 bytes) =====
+typedef struct __attribute__((packed)) {
+  uint32_t timestamp_ms; // ms since boot when the beat was detected
+  uint16_t rr_ms;        // last beat-to-beat interval
+  uint16_t rmssd_x10;    // running RMSSD, 0.1 ms units
+  uint16_t sdnn_x10;     // running SDNN, 0.1 ms units
+  uint16_t intervals;    // RR intervals accepted so far (saturates)
+} jr_hrv_v1_t;
+
+#ifdef __cplusplus
+static_assert(sizeof(jr_hrv_v1_t) == 12, "jr_hrv_v1_t must be 12 bytes");
+#else
+_Static_assert(sizeof(jr_hrv_v1_t) == 12, "jr_hrv_v1_t must be 12 bytes");
+#endif
+
+// ===== Clock sync reply (20 bytes, control read) =====
+typedef struct __attribute__((packed)) {
+  uint32_t token; // echoed from the last control 0x07
+  uint64_t rx_us; // device clock when that write arrived (us since boot)
+  uint64_t tx_us; // device clock when this read was served
+} jr_clock_sync_v1_t;
+
+#ifdef __cplusplus
+static_assert(sizeof(jr_clock_sync_v1_t) == 20,
+              "jr_clock_sync_v1_t must be 20 bytes");
+#else
+_Static_assert(sizeof(jr_clock_sync_v1_t) == 20,
+               "jr_clock_sync_v1_t must be 20 bytes");
+#endif
+
+// ===== Self-test frames (control 0x08) =====
+#define JR_SELFTEST_FRAME_TYPE 0xA8
+#define JR_SELFTEST_REPORT_TYPE 0xA9
+
+// Head of every synthetic frame; the rest of the requested size is filled
+// with (seq + i) & 0xFF so the client can check the payload.
+typedef struct __attribute__((packed)) {
+  uint8_t type;     // JR_SELFTEST_FRAME_TYPE
+  uint8_t reserved;
+  uint16_t seq;     // advances for frames the device failed or skipped too
+  uint32_t due_us;  // when the frame was scheduled, us since test start
+  uint32_t send_us; // when notify was called, us since test start
+} jr_selftest_frame_t;
+
+// Sent once when the test ends (duration elapsed or stopped).
 typedef struct __attribute__((packed)) {
-  uint32_t timestamp_ms; // ms since boot (or another firmware-defined base)
-  uint32_t jump_count;   // count that is transmitted (can be relative to START)
-  uint8_t heart_rate_bpm; // 0 => invalid / no reading
-  uint16_t accel_mag;     // magnitude (firmware-defined units)
-  uint8_t flags;          // status/validity bits (firmware-defined)
-} jr_packet_v1_t;
+  uint8_t type;           // JR_SELFTEST_REPORT_TYPE
+  uint8_t reason;         // 0 = duration elapsed, 1 = stopped
+  uint16_t tick_hz;       // FreeRTOS tick rate (scheduler resolution)
+  uint16_t rate_hz;       // as run (after limits)
+  uint16_t size;          // frame bytes as run
+  uint32_t elapsed_ms;
+  uint32_t due;           // frames scheduled
+  uint32_t sent;          // accepted by the host
+  uint32_t skipped;       // scheduled while notify_task ran too late
+  uint32_t pool_empty;    // no free block in the notify pool
+  uint32_t host_nomem;    // host rejected with BLE_HS_ENOMEM
+  uint32_t host_other;    // any other host error (see last_rc)
+  int16_t last_rc;        // last non-zero notify return code
+  uint16_t pool_min_free; // fewest free notify pool blocks seen
+  uint32_t late_avg_us;   // notify call time minus due time
+  uint32_t late_max_us;
+  uint32_t call_avg_us;   // time spent inside the notify call
+  uint32_t call_max_us;
+} jr_selftest_report_t;
 
 #ifdef __cplusplus
-static_assert(sizeof(jr_packet_v1_t) == 12, "jr_packet_v1_t must be 12 bytes");
+static_assert(sizeof(jr_selftest_frame_t) == 12,
+              "jr_selftest_frame_t must be 12 bytes");
+static_assert(sizeof(jr_selftest_report_t) == 56,
+              "jr_selftest_report_t must be 56 bytes");
 #else
-_Static_assert(sizeof(jr_packet_v1_t) == 12, "jr_packet_v1_t must be 12 bytes");
+_Static_assert(sizeof(jr_selftest_frame_t) == 12,
+               "jr_selftest_frame_t must be 12 bytes");
+_Static_assert(sizeof(jr_selftest_report_t) == 56,
+               "jr_selftest_report_t must be 56 bytes");
 #endif
 
+// ===== Streaming modes =====
+typedef enum {
+  JR_STREAM_SUMMARY = 0,  // jr_telemetry.h records (control 0x01)
+  JR_STREAM_RAW = 1,      // jr_raw_codec frames (control 0x02)
+  JR_STREAM_SELFTEST = 2, // synthetic jr_selftest_frame_t (control 0x08)
+} jr_stream_mode_t;
+
+// ===== Link profiles =====
+typedef enum {
+  JR_LINK_AUTO = 0,       // throughput while raw streaming or syncing, eco
+                          // otherwise
+  JR_LINK_THROUGHPUT = 1, // 7.5-15 ms interval, 2M PHY, 251-byte DLE
+  JR_LINK_ECO = 2,        // 60-120 ms interval, peripheral latency 4
+} jr_link_profile_t;
+
+// Connection parameters as last reported by the controller.
+typedef struct {
+  jr_link_profile_t profile; // profile last requested (AUTO = none yet)
+  uint16_t interval;         // 1.25 ms units
+  uint16_t latency;          // connection events
+  uint16_t timeout;          // 10 ms units
+  uint8_t tx_phy;            // BLE_GAP_LE_PHY_1M / _2M / _CODED
+  uint8_t rx_phy;
+  uint16_t tx_octets;        // LL payload size
+} jr_link_params_t;
+
+// ===== Delivery counters (since boot) =====
+typedef struct {
+  uint32_t records;        // records given a sequence number
+  uint32_t notify_failed;  // record notifications the host rejected
+  uint32_t records_lost;   // records in those notifications (per client)
+  uint32_t fill_requests;  // control 0x06 ranges accepted
+  uint32_t records_resent; // records notified again for a gap fill
+  uint32_t fill_missed;    // requested records no longer in the ring
+} jr_delivery_stats_t;
+
+// ===== Sync =====
+#define JR_SYNC_END_TYPE 0xFF
+#define JR_SYNC_RECORD_HEADER_SIZE 6
+
+// Storage behind the sync characteristic (e.g. the flash journal). Called
+// from the BLE notify task.
+typedef struct {
+  // Copies whole records with seq >= *cursor into buf (sync record format)
+  // and advances *cursor past them. Returns bytes written, 0 when caught up.
+  size_t (*read)(uint32_t *cursor, uint8_t *buf, size_t cap);
+  // Stored range: [*oldest, *next).
+  void (*range)(uint32_t *oldest, uint32_t *next);
+} jr_sync_source_t;
+
 // ===== Public API =====
 
 // Initializes NimBLE, registers services/characteristics, and starts
@@ -45,27 +249,91 @@ _Static_assert(sizeof(jr_packet_v1_t) == 12, "jr_packet_v1_t must be 12 bytes");
 void jr_ble_init(void);
 
 // Updates the latest sensor snapshot (thread-safe via a simple critical
-// section).
+// section). Call it when something changes (e.g. on every detected jump):
+// a change wakes the notify task, which sends it within JR_BLE_COALESCE_MS.
 // - jump_count_total: total count since boot (recommended) OR already relative
 // to workout.
 // - heart_rate_bpm: 0 when invalid
-// - accel_mag: pre-reduced to uint16_t
-// - flags: free bits; recommended: bit0=HR valid, bit1=accel valid
+// - spo2_pct: 0 when invalid
+// - flags: JR_TM_F_* bits (jr_telemetry.h)
 void jr_ble_set_sensor_snapshot(uint32_t jump_count_total,
-                                uint8_t heart_rate_bpm, uint16_t accel_mag,
+                                uint8_t heart_rate_bpm, uint16_t spo2_pct,
                                 uint8_t flags);
 
+// Publishes a new beat-to-beat interval with the current HRV statistics.
+// Notified to a subscribed client right away.
+void jr_ble_set_hrv(uint16_t rr_ms, uint16_t rmssd_x10, uint16_t sdnn_x10,
+                    uint16_t intervals);
+
 // Enables/disables "reset-on-start" for the TRANSMITTED jump counter.
 // Note: this does NOT reset sensors; it only resets what is transmitted (via
 // baseline).
 void jr_ble_set_reset_on_start(bool enable);
 
-// True when the browser enabled streaming (control=0x01)
+// Queues one raw sample (up to JR_RAW_MAX_CHANNELS values) for the raw
+// stream. Returns false when raw streaming is off or the queue is full.
+bool jr_ble_push_raw(uint32_t ts_us, const int16_t *values, uint8_t channels);
+
+// Selects the link profile. JR_LINK_AUTO (default) follows the stream mode
+// and sync activity; a fixed profile overrides it until set back to AUTO.
+void jr_ble_set_link_profile(jr_link_profile_t profile);
+
+// Copies the parameters of the first connection; false when not connected.
+bool jr_ble_get_link_params(jr_link_params_t *out);
+
+// Broadcast (group) mode: while advertising (a connection slot is free),
+// advertisements carry the live count, cadence and HR (jr_adv_codec.h) for
+// passive scanners.
+void jr_ble_set_broadcast(bool enable);
+
+// Cadence shown in broadcasts (jumps per minute, 0 when idle).
+void jr_ble_set_cadence(uint16_t jumps_per_min);
+
+// Best streak and mean in-rhythm cadence of session session_id, for the
+// summary; ignored once another session started.
+void jr_ble_set_rhythm(uint32_t session_id, uint32_t longest_streak,
+                       uint16_t cadence_avg_jpm);
+
+// Registers the storage served by the sync characteristic (NULL disables
+// it). Set once before clients connect.
+void jr_ble_set_sync_source(const jr_sync_source_t *source);
+
+// Registers the event source served by sync write 0x02 (NULL disables it).
+// Set once before clients connect.
+void jr_ble_set_event_source(const jr_sync_source_t *source);
+
+// True when any client enabled streaming (control=0x01 or 0x02)
 bool jr_ble_is_streaming(void);
 
+// A workout session runs from control=0x01 until the last client streaming
+// it writes 0x00. Unlike streaming, it survives disconnects so a
+// reconnecting client can resume it.
+bool jr_ble_session_active(void);
+
+// Increments on every new session (0 = none since boot).
+uint32_t jr_ble_session_id(void);
+
+// User the current session was started for (control 0x0A), 0 = anonymous.
+uint32_t jr_ble_session_user(void);
+
+// JR_STREAM_RAW while any client raw streams, else JR_STREAM_SUMMARY.
+jr_stream_mode_t jr_ble_stream_mode(void);
+
+// Raw sample rate to produce: the highest rate any raw client asked for (Hz).
+uint16_t jr_ble_raw_rate_hz(void);
+
 // True when a BLE client is connected (useful for debug).
 bool jr_ble_is_connected(void);
 
+// Number of connected clients.
+uint8_t jr_ble_conn_count(void);
+
+// Copies the loss and retransmission counters.
+void jr_ble_get_delivery_stats(jr_delivery_stats_t *out);
+
+// Aggregates of the current session (or of the last one after STOP).
+void jr_ble_get_session_summary(jr_session_summary_t *out);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
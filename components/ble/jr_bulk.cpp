@@ -0,0 +1,143 @@
+#include "jr_bulk.h"
+
+/*
+ * components/ble/jr_bulk.cpp
+ *
+ * Bulk transfer SDU framing and credit-based send state machine.
+ */
+
+#include <cstring>
+
+static inline void put_u16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v) {
+  put_u16(p, (uint16_t)v);
+  put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static inline uint16_t get_u16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get_u32(const uint8_t *p) {
+  return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+void jr_bulk_tx_init(jr_bulk_tx_t *tx, const jr_bulk_io_t *io, uint8_t *buf,
+                     size_t cap) {
+  memset(tx, 0, sizeof(*tx));
+  tx->io = *io;
+  tx->buf = buf;
+  tx->cap = cap;
+}
+
+void jr_bulk_tx_start(jr_bulk_tx_t *tx, uint32_t cursor) {
+  tx->pending = 0;
+  tx->cursor = cursor;
+  tx->seq = 0;
+  tx->bytes = 0;
+  tx->sdus = 0;
+  tx->stalls = 0;
+  tx->busy = 0;
+  // Too small for even the END SDU
+  tx->state = tx->cap >= JR_BULK_END_SIZE ? JR_BULK_RUNNING : JR_BULK_FAILED;
+}
+
+// Builds the next SDU into buf. Returns true for the END SDU.
+static bool tx_build(jr_bulk_tx_t *tx) {
+  uint32_t cursor = tx->cursor;
+  const size_t n = tx->io.read(tx->io.ctx, &cursor,
+                               tx->buf + JR_BULK_HEADER_SIZE,
+                               tx->cap - JR_BULK_HEADER_SIZE);
+  const bool end = n == 0;
+
+  tx->buf[0] = end ? JR_BULK_END : JR_BULK_DATA;
+  tx->buf[1] = 0;
+  put_u16(tx->buf + 2, tx->seq);
+  if (end) {
+    put_u32(tx->buf + JR_BULK_HEADER_SIZE, cursor);
+    tx->pending = JR_BULK_END_SIZE;
+  } else {
+    tx->pending = JR_BULK_HEADER_SIZE + n;
+  }
+  tx->pending_cursor = cursor;
+  return end;
+}
+
+jr_bulk_state_t jr_bulk_tx_pump(jr_bulk_tx_t *tx) {
+  while (tx->state == JR_BULK_RUNNING) {
+    bool end = tx->pending != 0 && tx->buf[0] == JR_BULK_END;
+    if (tx->pending == 0) {
+      end = tx_build(tx);
+    }
+
+    const jr_bulk_send_rc_t rc = tx->io.send(tx->io.ctx, tx->buf, tx->pending);
+    if (rc == JR_BULK_SEND_BUSY) {
+      tx->busy++;
+      break; // keep the SDU for the next pump
+    }
+    if (rc == JR_BULK_SEND_ERROR) {
+      tx->state = JR_BULK_FAILED;
+      break;
+    }
+
+    // Accepted
+    tx->bytes += (uint32_t)tx->pending;
+    tx->sdus++;
+    tx->seq++;
+    tx->cursor = tx->pending_cursor;
+    tx->pending = 0;
+
+    if (end) {
+      tx->state = JR_BULK_DONE;
+    } else if (rc == JR_BULK_SEND_STALLED) {
+      tx->stalls++;
+      tx->state = JR_BULK_STALLED;
+    }
+  }
+  return tx->state;
+}
+
+void jr_bulk_tx_unstalled(jr_bulk_tx_t *tx) {
+  if (tx->state == JR_BULK_STALLED) {
+    tx->state = JR_BULK_RUNNING;
+  }
+}
+
+void jr_bulk_tx_abort(jr_bulk_tx_t *tx) {
+  tx->pending = 0;
+  if (tx->state == JR_BULK_RUNNING || tx->state == JR_BULK_STALLED) {
+    tx->state = JR_BULK_IDLE;
+  }
+}
+
+void jr_bulk_rx_init(jr_bulk_rx_t *rx) { memset(rx, 0, sizeof(*rx)); }
+
+int jr_bulk_rx_sdu(jr_bulk_rx_t *rx, const uint8_t *sdu, size_t sdu_len,
+                   const uint8_t **records, size_t *len) {
+  if (sdu_len < JR_BULK_HEADER_SIZE ||
+      (sdu[0] != JR_BULK_DATA && sdu[0] != JR_BULK_END) ||
+      (sdu[0] == JR_BULK_END && sdu_len != JR_BULK_END_SIZE)) {
+    rx->malformed++;
+    return -1;
+  }
+
+  const uint16_t seq = get_u16(sdu + 2);
+  rx->lost += (uint16_t)(seq - rx->next_seq);
+  rx->next_seq = (uint16_t)(seq + 1);
+  rx->sdus++;
+
+  if (sdu[0] == JR_BULK_END) {
+    rx->done = true;
+    rx->next_cursor = get_u32(sdu + JR_BULK_HEADER_SIZE);
+    *records = NULL;
+    *len = 0;
+  } else {
+    *records = sdu + JR_BULK_HEADER_SIZE;
+    *len = sdu_len - JR_BULK_HEADER_SIZE;
+  }
+  return sdu[0];
+}
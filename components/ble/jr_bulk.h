@@ -0,0 +1,112 @@
+#pragma once
+/*
+ * components/ble/jr_bulk.h
+ *
+ * Bulk transfer framing and flow control for the L2CAP CoC channel (no
+ * ESP-IDF dependencies; the transport and the record source are callbacks,
+ * so it runs unchanged against a loopback on the host).
+ *
+ * Each SDU starts with
+ *
+ *   u8  type      JR_BULK_DATA or JR_BULK_END
+ *   u8  reserved  0
+ *   u16 seq       SDU counter from 0, wraps; a gap means a lost SDU
+ *
+ * JR_BULK_DATA carries whole sync records (u32 seq, u8 type, u8 len,
+ * payload[len]) back-to-back. JR_BULK_END carries the u32 cursor to resume
+ * from and ends the transfer.
+ *
+ * Flow control follows the L2CAP credit model: a send either consumes the SDU
+ * (OK), consumes it but leaves the channel without credits (STALLED, wait for
+ * jr_bulk_tx_unstalled), or refuses it (BUSY, the same SDU is offered again
+ * on the next pump).
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JR_BULK_DATA 0xB1
+#define JR_BULK_END 0xB2
+#define JR_BULK_HEADER_SIZE 4
+#define JR_BULK_END_SIZE (JR_BULK_HEADER_SIZE + 4)
+
+typedef enum {
+  JR_BULK_SEND_OK = 0,
+  JR_BULK_SEND_STALLED, // accepted; no credits left
+  JR_BULK_SEND_BUSY,    // not accepted; retry later
+  JR_BULK_SEND_ERROR,   // channel unusable
+} jr_bulk_send_rc_t;
+
+typedef enum {
+  JR_BULK_IDLE = 0,
+  JR_BULK_RUNNING,
+  JR_BULK_STALLED,
+  JR_BULK_DONE,
+  JR_BULK_FAILED,
+} jr_bulk_state_t;
+
+typedef struct {
+  jr_bulk_send_rc_t (*send)(void *ctx, const uint8_t *sdu, size_t len);
+  // Same contract as jr_sync_source_t::read.
+  size_t (*read)(void *ctx, uint32_t *cursor, uint8_t *buf, size_t cap);
+  void *ctx;
+} jr_bulk_io_t;
+
+typedef struct {
+  jr_bulk_io_t io;
+  uint8_t *buf;
+  size_t cap;              // SDU size limit (peer MTU)
+  size_t pending;          // length of an SDU not yet accepted (0 = none)
+  uint32_t cursor;         // first record not yet accepted by the transport
+  uint32_t pending_cursor; // cursor once the pending SDU is accepted
+  uint16_t seq;
+  jr_bulk_state_t state;
+
+  uint32_t bytes;  // SDU bytes accepted
+  uint32_t sdus;   // SDUs accepted
+  uint32_t stalls; // times the channel ran out of credits
+  uint32_t busy;   // sends refused
+} jr_bulk_tx_t;
+
+typedef struct {
+  uint16_t next_seq;
+  uint32_t sdus;
+  uint32_t lost;      // SDUs missing by sequence
+  uint32_t malformed;
+  bool done;
+  uint32_t next_cursor; // valid once done
+} jr_bulk_rx_t;
+
+// buf (cap bytes, at least JR_BULK_END_SIZE plus one record) holds the SDU
+// being built.
+void jr_bulk_tx_init(jr_bulk_tx_t *tx, const jr_bulk_io_t *io, uint8_t *buf,
+                     size_t cap);
+
+// Starts a transfer of records with seq >= cursor. Fails at once when cap
+// cannot hold the END SDU.
+void jr_bulk_tx_start(jr_bulk_tx_t *tx, uint32_t cursor);
+
+// Sends SDUs until the source is drained or the transport pushes back.
+// Returns the resulting state.
+jr_bulk_state_t jr_bulk_tx_pump(jr_bulk_tx_t *tx);
+
+// Credits are back; the next pump continues.
+void jr_bulk_tx_unstalled(jr_bulk_tx_t *tx);
+
+void jr_bulk_tx_abort(jr_bulk_tx_t *tx);
+
+void jr_bulk_rx_init(jr_bulk_rx_t *rx);
+
+// Parses one SDU. For JR_BULK_DATA returns the records in *records/*len.
+// Returns the SDU type, or -1 when it is malformed.
+int jr_bulk_rx_sdu(jr_bulk_rx_t *rx, const uint8_t *sdu, size_t sdu_len,
+                   const uint8_t **records, size_t *len);
+
+#ifdef __cplusplus
+}
+#endif
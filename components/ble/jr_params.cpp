@@ -0,0 +1,252 @@
+#include "jr_params.h"
+
+/*
+ * components/ble/jr_params.cpp
+ *
+ * Parameter table, values and the TLV request handler.
+ */
+
+#include <cstring>
+
+const jr_param_def_t jr_param_defs[] = {
+#define JR_PARAM_DEF(name, id, def, min, max, doc)                             \
+  {id, #name, def, min, max, doc},
+    JR_PARAMS(JR_PARAM_DEF)
+#undef JR_PARAM_DEF
+};
+
+static constexpr size_t PARAM_COUNT =
+    sizeof(jr_param_defs) / sizeof(jr_param_defs[0]);
+const size_t jr_param_count = PARAM_COUNT;
+
+#define JR_PARAM_CHECK(name, id, def, min, max, doc)                           \
+  static_assert((min) <= (def) && (def) <= (max),                              \
+                #name " default out of range");                                \
+  static_assert((id) != 0 && (id) != JR_PARAM_ALL, #name " id reserved");
+JR_PARAMS(JR_PARAM_CHECK)
+#undef JR_PARAM_CHECK
+
+static_assert(PARAM_COUNT * 7 <= JR_PARAMS_SAVE_MAX,
+              "JR_PARAMS_SAVE_MAX too small");
+
+static uint32_t g_values[PARAM_COUNT] = {
+#define JR_PARAM_VALUE(name, id, def, min, max, doc) def,
+    JR_PARAMS(JR_PARAM_VALUE)
+#undef JR_PARAM_VALUE
+};
+static uint32_t g_generation = 0;
+
+static inline void put_u32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint32_t get_u32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+static int param_index(uint8_t id) {
+  for (size_t i = 0; i < PARAM_COUNT; i++) {
+    if (jr_param_defs[i].id == id) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+uint32_t jr_param_get(jr_param_id_t id) {
+  const int i = param_index((uint8_t)id);
+  return (i >= 0) ? g_values[i] : 0;
+}
+
+const jr_param_def_t *jr_param_def(uint8_t id) {
+  const int i = param_index(id);
+  return (i >= 0) ? &jr_param_defs[i] : NULL;
+}
+
+uint32_t jr_params_generation(void) { return g_generation; }
+
+// Response writer; stops at the first item that does not fit.
+struct param_writer_t {
+  uint8_t *buf;
+  size_t cap;
+  size_t len;
+  bool truncated;
+};
+
+static void put_value(param_writer_t *w, size_t i) {
+  if (w->truncated || w->cap - w->len < JR_PARAM_VALUE_ITEM_SIZE) {
+    w->truncated = true;
+    return;
+  }
+  uint8_t *p = w->buf + w->len;
+  const jr_param_def_t &d = jr_param_defs[i];
+  p[0] = JR_PARAM_T_VALUE;
+  p[1] = JR_PARAM_VALUE_ITEM_SIZE - 2;
+  p[2] = d.id;
+  put_u32(p + 3, g_values[i]);
+  put_u32(p + 7, d.min);
+  put_u32(p + 11, d.max);
+  w->len += JR_PARAM_VALUE_ITEM_SIZE;
+}
+
+static void put_error(param_writer_t *w, uint8_t id, uint8_t error) {
+  if (w->buf[1] == JR_PARAM_OK) {
+    w->buf[1] = error;
+  }
+  if (w->truncated || w->cap - w->len < 4) {
+    w->truncated = true;
+    return;
+  }
+  uint8_t *p = w->buf + w->len;
+  p[0] = JR_PARAM_T_ERROR;
+  p[1] = 2;
+  p[2] = id;
+  p[3] = error;
+  w->len += 4;
+}
+
+// Checks one item and stages its SET/RESET into next[]. Returns the error.
+static uint8_t param_stage(uint8_t type, const uint8_t *v, uint8_t len,
+                           uint32_t *next) {
+  switch (type) {
+  case JR_PARAM_T_GET:
+    if (len != 1) {
+      return JR_PARAM_E_LENGTH;
+    }
+    return (v[0] == JR_PARAM_ALL || param_index(v[0]) >= 0)
+               ? JR_PARAM_OK
+               : JR_PARAM_E_UNKNOWN_ID;
+  case JR_PARAM_T_SET: {
+    if (len != 5) {
+      return JR_PARAM_E_LENGTH;
+    }
+    const int i = param_index(v[0]);
+    if (i < 0) {
+      return JR_PARAM_E_UNKNOWN_ID;
+    }
+    const uint32_t value = get_u32(v + 1);
+    if (value < jr_param_defs[i].min || value > jr_param_defs[i].max) {
+      return JR_PARAM_E_RANGE;
+    }
+    next[i] = value;
+    return JR_PARAM_OK;
+  }
+  case JR_PARAM_T_RESET:
+    if (len != 0) {
+      return JR_PARAM_E_LENGTH;
+    }
+    for (size_t i = 0; i < PARAM_COUNT; i++) {
+      next[i] = jr_param_defs[i].def;
+    }
+    return JR_PARAM_OK;
+  default:
+    return JR_PARAM_E_TYPE;
+  }
+}
+
+size_t jr_params_handle(uint8_t token, const uint8_t *req, size_t len,
+                        uint8_t *resp, size_t cap, bool *changed) {
+  *changed = false;
+  if (cap < JR_PARAM_RESPONSE_HEADER_SIZE) {
+    return 0;
+  }
+  resp[0] = token;
+  resp[1] = JR_PARAM_OK;
+  param_writer_t w = {resp, cap, JR_PARAM_RESPONSE_HEADER_SIZE, false};
+
+  // Validate everything first; nothing applies if any item is bad
+  uint32_t next[PARAM_COUNT];
+  memcpy(next, g_values, sizeof(next));
+  size_t off = 0;
+  while (off < len) {
+    if (len - off < 2 || len - off - 2 < req[off + 1]) {
+      put_error(&w, 0, JR_PARAM_E_LENGTH);
+      break;
+    }
+    const uint8_t type = req[off];
+    const uint8_t item_len = req[off + 1];
+    const uint8_t *v = req + off + 2;
+    const uint8_t error = param_stage(type, v, item_len, next);
+    if (error != JR_PARAM_OK) {
+      put_error(&w, item_len > 0 ? v[0] : 0, error);
+    }
+    off += 2 + (size_t)item_len;
+  }
+  if (resp[1] != JR_PARAM_OK) {
+    return w.len;
+  }
+
+  for (size_t i = 0; i < PARAM_COUNT; i++) {
+    if (next[i] != g_values[i]) {
+      g_values[i] = next[i];
+      *changed = true;
+    }
+  }
+  if (*changed) {
+    g_generation++;
+  }
+
+  // Answer every item with the values it read or wrote
+  for (off = 0; off < len; off += 2 + (size_t)req[off + 1]) {
+    const uint8_t type = req[off];
+    const uint8_t id = (req[off + 1] > 0) ? req[off + 2] : 0;
+    if (type == JR_PARAM_T_RESET ||
+        (type == JR_PARAM_T_GET && id == JR_PARAM_ALL)) {
+      for (size_t i = 0; i < PARAM_COUNT; i++) {
+        put_value(&w, i);
+      }
+    } else {
+      put_value(&w, (size_t)param_index(id));
+    }
+  }
+  if (w.truncated) {
+    resp[1] = JR_PARAM_E_TRUNCATED;
+  }
+  return w.len;
+}
+
+size_t jr_params_save(uint8_t *buf, size_t cap) {
+  size_t len = 0;
+  for (size_t i = 0; i < PARAM_COUNT; i++) {
+    if (g_values[i] == jr_param_defs[i].def) {
+      continue;
+    }
+    if (cap - len < 7) {
+      break;
+    }
+    buf[len] = JR_PARAM_T_SET;
+    buf[len + 1] = 5;
+    buf[len + 2] = jr_param_defs[i].id;
+    put_u32(buf + len + 3, g_values[i]);
+    len += 7;
+  }
+  return len;
+}
+
+size_t jr_params_load(const uint8_t *buf, size_t len) {
+  bool changed = false;
+  size_t applied = 0;
+  for (size_t off = 0; len - off >= 7; off += 7) {
+    const uint8_t *p = buf + off;
+    if (p[0] != JR_PARAM_T_SET || p[1] != 5) {
+      break; // not written by jr_params_save()
+    }
+    const int i = param_index(p[2]);
+    const uint32_t value = get_u32(p + 3);
+    if (i < 0 || value < jr_param_defs[i].min ||
+        value > jr_param_defs[i].max) {
+      continue;
+    }
+    changed = changed || g_values[i] != value;
+    g_values[i] = value;
+    applied++;
+  }
+  if (changed) {
+    g_generation++;
+  }
+  return applied;
+}
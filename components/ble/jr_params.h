@@ -0,0 +1,142 @@
+#pragma once
+/*
+ * components/ble/jr_params.h
+ *
+ * Runtime-tunable parameters and their TLV protocol (no ESP-IDF
+ * dependencies). JR_PARAMS is the only list of what can be tuned; each entry
+ * is X(NAME, id, default, min, max, doc) with an unsigned 32-bit value.
+ * Fractional settings are scaled (e.g. _X100).
+ *
+ * A request is a sequence of items, each u8 type, u8 len, value[len]:
+ *
+ *   JR_PARAM_T_GET    len 1   u8 id (JR_PARAM_ALL = every parameter)
+ *   JR_PARAM_T_SET    len 5   u8 id, u32 value
+ *   JR_PARAM_T_RESET  len 0   every parameter back to its default
+ *
+ * The response starts with u8 token (copied from the request) and u8 status
+ * (JR_PARAM_OK or the first error), followed by items:
+ *
+ *   JR_PARAM_T_VALUE  len 13  u8 id, u32 value, u32 min, u32 max
+ *   JR_PARAM_T_ERROR  len 2   u8 id (0 when the item had none), u8 error
+ *
+ * Every GET, SET and RESET is answered with VALUE items. A request is
+ * validated as a whole before anything changes, so either all of its SETs
+ * apply or none do. All integers are little-endian.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Build-time defaults of the BLE timing parameters.
+
+// Minimum notify frequency (Hz) for raw frames: a partial frame is flushed
+// after 1/JR_BLE_NOTIFY_HZ.
+#ifndef JR_BLE_NOTIFY_HZ
+#define JR_BLE_NOTIFY_HZ 10
+#endif
+
+// Window after a state change in which further changes join the same
+// notification (ms).
+#ifndef JR_BLE_COALESCE_MS
+#define JR_BLE_COALESCE_MS 20
+#endif
+
+// Longest silence on the data characteristic while streaming (ms).
+#ifndef JR_BLE_HEARTBEAT_MS
+#define JR_BLE_HEARTBEAT_MS 1000
+#endif
+
+// X(NAME, id, default, min, max, doc). Ranges keep HEARTBEAT_MS above
+// COALESCE_MS and the detector tolerance below the shortest rise time. The
+// detector defaults here are its only defaults. Its rise/fall windows need
+// a few polls each, so it is polled at 50 Hz or more and the tolerance is
+// at least one 50 Hz period.
+#define JR_PARAMS(X)                                                           \
+  X(NOTIFY_HZ, 0x01, JR_BLE_NOTIFY_HZ, 1, 50, "raw frame flush rate (Hz)")     \
+  X(COALESCE_MS, 0x02, JR_BLE_COALESCE_MS, 0, 200,                             \
+    "changes merged into one notification (ms)")                               \
+  X(HEARTBEAT_MS, 0x03, JR_BLE_HEARTBEAT_MS, 250, 10000,                       \
+    "longest silence while streaming (ms)")                                    \
+  X(JUMP_UPDATE_HZ, 0x10, 100, 50, 100, "jump detector poll rate (Hz)")        \
+  X(DISPLAY_UPDATE_HZ, 0x11, 4, 1, 20, "OLED refresh rate (Hz)")               \
+  X(JUMP_THRESHOLD_X100, 0x20, 130, 100, 300,                                  \
+    "median jump amplitude over the threshold, x100")                          \
+  X(MIN_JUMP_INTERVAL_MS, 0x21, 300, 100, 1000,                                \
+    "shortest time between jumps; slow cadences raise it (ms)")                \
+  X(TIMING_TOLERANCE_MS, 0x22, 40, 20, 150,                                    \
+    "allowed rise/fall time deviation (ms)")                                   \
+  X(MAX_PHASE_MS, 0x23, 800, 300, 2000, "rise/fall timeout (ms)")
+
+typedef enum {
+#define JR_PARAM_ID(name, id, def, min, max, doc) JR_PARAM_##name = id,
+  JR_PARAMS(JR_PARAM_ID)
+#undef JR_PARAM_ID
+} jr_param_id_t;
+
+#define JR_PARAM_ALL 0xFF
+
+// Item types
+#define JR_PARAM_T_GET 0x01
+#define JR_PARAM_T_SET 0x02
+#define JR_PARAM_T_RESET 0x03
+#define JR_PARAM_T_VALUE 0x81
+#define JR_PARAM_T_ERROR 0xFF
+
+#define JR_PARAM_VALUE_ITEM_SIZE 15 // type, len, id, value, min, max
+#define JR_PARAM_RESPONSE_HEADER_SIZE 2
+
+// Status / error codes
+#define JR_PARAM_OK 0
+#define JR_PARAM_E_UNKNOWN_ID 1
+#define JR_PARAM_E_RANGE 2
+#define JR_PARAM_E_LENGTH 3   // item length wrong or runs past the request
+#define JR_PARAM_E_TYPE 4     // unknown item type
+#define JR_PARAM_E_TRUNCATED 5 // response did not fit; read fewer at once
+
+typedef struct {
+  uint8_t id;
+  const char *name;
+  uint32_t def;
+  uint32_t min;
+  uint32_t max;
+  const char *doc;
+} jr_param_def_t;
+
+extern const jr_param_def_t jr_param_defs[];
+extern const size_t jr_param_count;
+
+// Current value; the default for an unknown id. Safe from any task (one
+// aligned word per parameter).
+uint32_t jr_param_get(jr_param_id_t id);
+
+// Definition of id, NULL when unknown.
+const jr_param_def_t *jr_param_def(uint8_t id);
+
+// Increments whenever a value changes, so users can re-read lazily.
+uint32_t jr_params_generation(void);
+
+// Runs one request and writes the response (at most cap bytes). Returns the
+// response length; *changed is set when any value changed.
+size_t jr_params_handle(uint8_t token, const uint8_t *req, size_t len,
+                        uint8_t *resp, size_t cap, bool *changed);
+
+// Values that differ from their defaults as SET items, for persisting.
+// Returns the bytes written (0 when everything is default).
+size_t jr_params_save(uint8_t *buf, size_t cap);
+
+// Applies SET items written by jr_params_save(). Unknown ids and values out
+// of today's range are skipped, so a blob from older firmware still loads.
+// Returns how many items were applied.
+size_t jr_params_load(const uint8_t *buf, size_t len);
+
+// Worst-case jr_params_save() size.
+#define JR_PARAMS_SAVE_MAX (16 * 7)
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,175 @@
+#include "jr_raw_codec.h"
+
+/*
+ * components/ble/jr_raw_codec.cpp
+ *
+ * Delta + zigzag varint encoder/decoder for raw sensor frames.
+ */
+
+#include <cstring>
+
+static inline uint32_t zigzag(int32_t v) {
+  return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t v) {
+  return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static size_t put_varint(uint8_t *p, uint32_t v) {
+  size_t n = 0;
+  while (v >= 0x80) {
+    p[n++] = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+  p[n++] = (uint8_t)v;
+  return n;
+}
+
+// Returns bytes consumed, 0 on truncation or overlong input.
+static size_t get_varint(const uint8_t *p, size_t avail, uint32_t *v) {
+  uint32_t out = 0;
+  for (size_t n = 0; n < avail && n < 5; n++) {
+    out |= (uint32_t)(p[n] & 0x7F) << (7 * n);
+    if ((p[n] & 0x80) == 0) {
+      *v = out;
+      return n + 1;
+    }
+  }
+  return 0;
+}
+
+static inline void put_u16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v) {
+  put_u16(p, (uint16_t)v);
+  put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static inline uint16_t get_u16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get_u32(const uint8_t *p) {
+  return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+void jr_raw_encoder_begin(jr_raw_encoder_t *enc, uint8_t *buf, size_t cap,
+                          uint16_t seq, uint8_t channels, uint16_t period_us) {
+  if (channels > JR_RAW_MAX_CHANNELS) {
+    channels = JR_RAW_MAX_CHANNELS;
+  }
+
+  memset(enc, 0, sizeof(*enc));
+  enc->buf = buf;
+  enc->cap = cap;
+  enc->len = JR_RAW_HEADER_SIZE;
+  enc->channels = channels;
+  enc->period_us = period_us;
+
+  buf[0] = JR_RAW_FRAME_TYPE;
+  buf[1] = channels;
+  put_u16(buf + 2, seq);
+  put_u32(buf + 4, 0);
+  put_u16(buf + 8, period_us);
+  buf[10] = 0;
+  buf[11] = 0;
+}
+
+bool jr_raw_encoder_add(jr_raw_encoder_t *enc, const jr_raw_sample_t *s) {
+  if (enc->count == UINT8_MAX) {
+    return false;
+  }
+
+  // Encode into scratch first so a sample that does not fit leaves the
+  // frame untouched
+  uint8_t tmp[JR_RAW_MAX_SAMPLE_SIZE];
+  size_t n = 0;
+
+  if (enc->count == 0) {
+    for (uint8_t c = 0; c < enc->channels; c++) {
+      n += put_varint(tmp + n, zigzag(s->v[c]));
+    }
+  } else {
+    const int32_t jitter =
+        (int32_t)(s->ts_us - enc->prev.ts_us) - (int32_t)enc->period_us;
+    n += put_varint(tmp + n, zigzag(jitter));
+    for (uint8_t c = 0; c < enc->channels; c++) {
+      n += put_varint(tmp + n, zigzag((int32_t)s->v[c] - enc->prev.v[c]));
+    }
+  }
+
+  if (enc->len + n > enc->cap) {
+    return false;
+  }
+
+  if (enc->count == 0) {
+    put_u32(enc->buf + 4, s->ts_us);
+  }
+  memcpy(enc->buf + enc->len, tmp, n);
+  enc->len += n;
+  enc->count++;
+  enc->prev = *s;
+  return true;
+}
+
+size_t jr_raw_encoder_finish(jr_raw_encoder_t *enc) {
+  enc->buf[10] = enc->count;
+  return enc->len;
+}
+
+int jr_raw_decode(const uint8_t *buf, size_t len, jr_raw_frame_info_t *info,
+                  jr_raw_sample_t *out, size_t max_samples) {
+  if (len < JR_RAW_HEADER_SIZE || buf[0] != JR_RAW_FRAME_TYPE) {
+    return -1;
+  }
+
+  info->channels = buf[1];
+  info->seq = get_u16(buf + 2);
+  info->t0_us = get_u32(buf + 4);
+  info->period_us = get_u16(buf + 8);
+  info->count = buf[10];
+
+  if (info->channels == 0 || info->channels > JR_RAW_MAX_CHANNELS ||
+      info->count > max_samples) {
+    return -1;
+  }
+
+  size_t pos = JR_RAW_HEADER_SIZE;
+  jr_raw_sample_t prev = {};
+
+  for (uint8_t i = 0; i < info->count; i++) {
+    jr_raw_sample_t s = {};
+    uint32_t raw;
+    size_t n;
+
+    if (i == 0) {
+      s.ts_us = info->t0_us;
+    } else {
+      n = get_varint(buf + pos, len - pos, &raw);
+      if (n == 0) {
+        return -1;
+      }
+      pos += n;
+      s.ts_us = prev.ts_us + info->period_us + (uint32_t)unzigzag(raw);
+    }
+
+    for (uint8_t c = 0; c < info->channels; c++) {
+      n = get_varint(buf + pos, len - pos, &raw);
+      if (n == 0) {
+        return -1;
+      }
+      pos += n;
+      const int32_t base = (i == 0) ? 0 : prev.v[c];
+      s.v[c] = (int16_t)(base + unzigzag(raw));
+    }
+
+    out[i] = s;
+    prev = s;
+  }
+
+  return (pos == len) ? (int)info->count : -1;
+}
@@ -0,0 +1,83 @@
+#pragma once
+/*
+ * components/ble/jr_raw_codec.h
+ *
+ * Raw sensor frame codec (no ESP-IDF dependencies; also built into the host
+ * decoder in tools/jr_raw_decode.cpp).
+ *
+ * A frame is one BLE notification in raw streaming mode:
+ *
+ *   u8  type          JR_RAW_FRAME_TYPE
+ *   u8  channels      values per sample (1..JR_RAW_MAX_CHANNELS)
+ *   u16 seq           frame counter, wraps; gaps = lost frames
+ *   u32 t0_us         timestamp of the first sample (esp_timer, low 32 bits)
+ *   u16 period_us     nominal sample period
+ *   u8  count         samples in this frame
+ *   u8  reserved      0
+ *   ... samples
+ *
+ * Header fields are little-endian. Samples are zigzag LEB128 varints:
+ *   sample 0:  value[c]                        for each channel
+ *   sample i:  (dt_us - period_us), value[c] - previous value[c]
+ *
+ * With a steady sample clock the timestamp costs one byte and small
+ * accelerometer deltas one or two bytes per channel.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JR_RAW_FRAME_TYPE 0xA1
+#define JR_RAW_HEADER_SIZE 12
+#define JR_RAW_MAX_CHANNELS 4
+
+// Worst-case encoded size of one sample (varint of a 32-bit delta is 5 bytes)
+#define JR_RAW_MAX_SAMPLE_SIZE (5 * (1 + JR_RAW_MAX_CHANNELS))
+
+typedef struct {
+  uint32_t ts_us;
+  int16_t v[JR_RAW_MAX_CHANNELS];
+} jr_raw_sample_t;
+
+typedef struct {
+  uint8_t *buf;
+  size_t cap;
+  size_t len;
+  uint8_t channels;
+  uint16_t period_us;
+  uint8_t count;
+  jr_raw_sample_t prev;
+} jr_raw_encoder_t;
+
+typedef struct {
+  uint8_t channels;
+  uint16_t seq;
+  uint32_t t0_us;
+  uint16_t period_us;
+  uint8_t count;
+} jr_raw_frame_info_t;
+
+// Starts a frame in buf (cap bytes, at least JR_RAW_HEADER_SIZE).
+void jr_raw_encoder_begin(jr_raw_encoder_t *enc, uint8_t *buf, size_t cap,
+                          uint16_t seq, uint8_t channels, uint16_t period_us);
+
+// Appends one sample. Returns false (and leaves the frame unchanged) when the
+// sample does not fit or the frame already holds 255 samples.
+bool jr_raw_encoder_add(jr_raw_encoder_t *enc, const jr_raw_sample_t *s);
+
+// Finalizes the header; returns the frame length in bytes.
+size_t jr_raw_encoder_finish(jr_raw_encoder_t *enc);
+
+// Decodes a frame into out (room for max_samples). Returns the number of
+// samples decoded, or -1 when the frame is malformed or does not fit.
+int jr_raw_decode(const uint8_t *buf, size_t len, jr_raw_frame_info_t *info,
+                  jr_raw_sample_t *out, size_t max_samples);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,154 @@
+#include "jr_session.h"
+
+/*
+ * components/ble/jr_session.cpp
+ *
+ * Incremental session aggregates and the summary encoder.
+ */
+
+#include <cstring>
+
+static inline void put_u16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v) {
+  put_u16(p, (uint16_t)v);
+  put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+// Closes the current HR reading's time slice at now_ms.
+static void hr_accumulate(jr_session_t *s, uint32_t now_ms) {
+  if (s->hr_bpm != 0) {
+    const uint32_t dt = now_ms - s->hr_since_ms;
+    s->hr_bpm_ms += (uint64_t)s->hr_bpm * dt;
+    s->hr_valid_ms += dt;
+  }
+  s->hr_since_ms = now_ms;
+}
+
+static void hr_set(jr_session_t *s, uint8_t hr_bpm) {
+  s->hr_bpm = hr_bpm;
+  if (hr_bpm == 0) {
+    return;
+  }
+  if (s->hr_min_bpm == 0 || hr_bpm < s->hr_min_bpm) {
+    s->hr_min_bpm = hr_bpm;
+  }
+  if (hr_bpm > s->hr_max_bpm) {
+    s->hr_max_bpm = hr_bpm;
+  }
+}
+
+void jr_session_start(jr_session_t *s, uint32_t id, uint32_t now_ms,
+                      uint32_t jump_total, uint8_t hr_bpm) {
+  memset(s, 0, sizeof(*s));
+  s->id = id;
+  s->running = true;
+  s->start_ms = now_ms;
+  s->last_total = jump_total;
+  s->hr_since_ms = now_ms;
+  hr_set(s, hr_bpm);
+}
+
+void jr_session_update(jr_session_t *s, uint32_t now_ms, uint32_t jump_total,
+                       uint8_t hr_bpm) {
+  if (!s->running) {
+    return;
+  }
+
+  if (jump_total > s->last_total) {
+    if (s->jumps > 0 && now_ms - s->last_jump_ms <= JR_SESSION_ACTIVE_GAP_MS) {
+      s->active_ms += now_ms - s->last_jump_ms;
+    }
+    s->jumps += jump_total - s->last_total;
+    s->last_jump_ms = now_ms;
+  }
+  // A lower total means the detector was reset; count on from there
+  s->last_total = jump_total;
+
+  if (hr_bpm != s->hr_bpm) {
+    hr_accumulate(s, now_ms);
+    hr_set(s, hr_bpm);
+  }
+}
+
+void jr_session_cadence(jr_session_t *s, uint16_t jumps_per_min) {
+  if (s->running && jumps_per_min > s->cadence_max_jpm) {
+    s->cadence_max_jpm = jumps_per_min;
+  }
+}
+
+void jr_session_rhythm(jr_session_t *s, uint32_t longest_streak,
+                       uint16_t cadence_avg_jpm) {
+  if (s->running) {
+    s->longest_streak = longest_streak;
+    s->cadence_avg_jpm = cadence_avg_jpm;
+  }
+}
+
+void jr_session_stop(jr_session_t *s, uint32_t now_ms) {
+  if (!s->running) {
+    return;
+  }
+  hr_accumulate(s, now_ms);
+  s->running = false;
+  s->final = true;
+  s->end_ms = now_ms;
+}
+
+void jr_session_summary(const jr_session_t *s, uint32_t now_ms,
+                        jr_session_summary_t *out) {
+  memset(out, 0, sizeof(*out));
+  out->session_id = s->id;
+  if (!s->running && !s->final) {
+    return; // no session yet
+  }
+
+  const uint32_t end_ms = s->final ? s->end_ms : now_ms;
+  out->duration_ms = end_ms - s->start_ms;
+  out->jumps = s->jumps;
+  out->active_ms = s->active_ms;
+  out->longest_streak = s->longest_streak;
+  out->cadence_avg_jpm = s->cadence_avg_jpm;
+  out->cadence_max_jpm = s->cadence_max_jpm;
+
+  // Include the reading still open while running
+  uint64_t bpm_ms = s->hr_bpm_ms;
+  uint32_t valid_ms = s->hr_valid_ms;
+  if (s->running && s->hr_bpm != 0) {
+    bpm_ms += (uint64_t)s->hr_bpm * (end_ms - s->hr_since_ms);
+    valid_ms += end_ms - s->hr_since_ms;
+  }
+  if (s->hr_max_bpm != 0) {
+    out->hr_min_bpm = s->hr_min_bpm;
+    out->hr_max_bpm = s->hr_max_bpm;
+    out->hr_avg_bpm = (valid_ms > 0)
+                          ? (uint8_t)((bpm_ms + valid_ms / 2) / valid_ms)
+                          : s->hr_bpm;
+    out->flags |= JR_SESSION_F_HR_VALID;
+  }
+  if (s->final) {
+    out->flags |= JR_SESSION_F_FINAL;
+  }
+}
+
+size_t jr_session_encode(const jr_session_summary_t *sum, uint8_t *buf,
+                         size_t cap) {
+  if (cap < JR_SESSION_SUMMARY_SIZE) {
+    return 0;
+  }
+  put_u32(buf + 0, sum->session_id);
+  put_u32(buf + 4, sum->duration_ms);
+  put_u32(buf + 8, sum->jumps);
+  put_u32(buf + 12, sum->active_ms);
+  put_u32(buf + 16, sum->longest_streak);
+  put_u16(buf + 20, sum->cadence_avg_jpm);
+  put_u16(buf + 22, sum->cadence_max_jpm);
+  buf[24] = sum->hr_min_bpm;
+  buf[25] = sum->hr_avg_bpm;
+  buf[26] = sum->hr_max_bpm;
+  buf[27] = sum->flags;
+  return JR_SESSION_SUMMARY_SIZE;
+}
@@ -0,0 +1,116 @@
+#pragma once
+/*
+ * components/ble/jr_session.h
+ *
+ * Workout session aggregates (no ESP-IDF dependencies). Every update is O(1)
+ * and the state is a fixed-size struct, so the BLE layer can keep it current
+ * on every snapshot and serve the summary in one read:
+ *
+ *   u32 session_id
+ *   u32 duration_ms      START to STOP (to now while running)
+ *   u32 jumps
+ *   u32 active_ms        time between jumps <= JR_SESSION_ACTIVE_GAP_MS apart
+ *   u32 longest_streak   best run without a rhythm break (firmware reported)
+ *   u16 cadence_avg_jpm  mean in-rhythm cadence (firmware reported)
+ *   u16 cadence_max_jpm  highest cadence the firmware reported
+ *   u8  hr_min_bpm       0 when no valid reading
+ *   u8  hr_avg_bpm       time-weighted over valid readings
+ *   u8  hr_max_bpm
+ *   u8  flags            JR_SESSION_F_*
+ *
+ * All fields are little-endian. Jumps are counted from increments of the
+ * device total, so a detector reset mid-session loses nothing already
+ * counted, and the summary does not depend on which notifications a client
+ * received. Streaks and the average cadence come from the firmware's jump
+ * statistics (main/jump_stats.h), so the summary matches the device screen
+ * and the saved user profile.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JR_SESSION_SUMMARY_SIZE 28
+
+// A pause longer than this does not count as active time (matches
+// CADENCE_IDLE_MS in main/jump_stats.cpp).
+#ifndef JR_SESSION_ACTIVE_GAP_MS
+#define JR_SESSION_ACTIVE_GAP_MS 2000
+#endif
+
+#define JR_SESSION_F_FINAL 0x01    // STOP received; values are final
+#define JR_SESSION_F_HR_VALID 0x02 // at least one valid HR reading
+
+typedef struct {
+  uint32_t session_id;
+  uint32_t duration_ms;
+  uint32_t jumps;
+  uint32_t active_ms;
+  uint32_t longest_streak;
+  uint16_t cadence_avg_jpm;
+  uint16_t cadence_max_jpm;
+  uint8_t hr_min_bpm;
+  uint8_t hr_avg_bpm;
+  uint8_t hr_max_bpm;
+  uint8_t flags;
+} jr_session_summary_t;
+
+// Running state; zero-initialized means "no session yet".
+typedef struct {
+  uint32_t id;
+  bool running;
+  bool final;
+  uint32_t start_ms;
+  uint32_t end_ms;
+
+  uint32_t last_total; // device jump total at the previous update
+  uint32_t jumps;
+  uint32_t last_jump_ms;
+  uint32_t active_ms;
+  uint32_t longest_streak;
+  uint16_t cadence_avg_jpm;
+  uint16_t cadence_max_jpm;
+
+  uint8_t hr_bpm; // current reading, 0 = invalid
+  uint8_t hr_min_bpm;
+  uint8_t hr_max_bpm;
+  uint32_t hr_since_ms;  // when hr_bpm was set
+  uint64_t hr_bpm_ms;    // sum of bpm * ms over valid readings
+  uint32_t hr_valid_ms;
+} jr_session_t;
+
+// Starts a new session at the current device state.
+void jr_session_start(jr_session_t *s, uint32_t id, uint32_t now_ms,
+                      uint32_t jump_total, uint8_t hr_bpm);
+
+// Feeds a snapshot (hr_bpm 0 = invalid). Ignored unless running.
+void jr_session_update(jr_session_t *s, uint32_t now_ms, uint32_t jump_total,
+                       uint8_t hr_bpm);
+
+// Feeds the cadence the firmware currently reports (jumps per minute).
+void jr_session_cadence(jr_session_t *s, uint16_t jumps_per_min);
+
+// Feeds the firmware's best streak and mean in-rhythm cadence so far.
+// Ignored unless running.
+void jr_session_rhythm(jr_session_t *s, uint32_t longest_streak,
+                       uint16_t cadence_avg_jpm);
+
+// Ends the session; the summary is final from here on.
+void jr_session_stop(jr_session_t *s, uint32_t now_ms);
+
+// Summary as of now_ms (or of STOP once final).
+void jr_session_summary(const jr_session_t *s, uint32_t now_ms,
+                        jr_session_summary_t *out);
+
+// Writes the summary in the layout above. Returns JR_SESSION_SUMMARY_SIZE,
+// or 0 when cap is too small.
+size_t jr_session_encode(const jr_session_summary_t *sum, uint8_t *buf,
+                         size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
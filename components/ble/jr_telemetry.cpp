@@ -0,0 +1,109 @@
+#include "jr_telemetry.h"
+
+/*
+ * components/ble/jr_telemetry.cpp
+ *
+ * Telemetry record pack/unpack, generated from JR_TELEMETRY_FIELDS.
+ */
+
+#include <cstring>
+
+const jr_tm_field_t jr_telemetry_fields[] = {
+#define JR_TM_DESC(name, type, offset, since, doc)                             \
+  {#name, sizeof(jr_tm_##type##_t), offset, since, doc},
+    JR_TELEMETRY_FIELDS(JR_TM_DESC)
+#undef JR_TM_DESC
+};
+
+const size_t jr_telemetry_field_count =
+    sizeof(jr_telemetry_fields) / sizeof(jr_telemetry_fields[0]);
+
+const jr_tm_flag_t jr_telemetry_flags[] = {
+#define JR_TM_FLAG_DESC(name, bit, doc) {#name, bit, doc},
+    JR_TELEMETRY_FLAGS(JR_TM_FLAG_DESC)
+#undef JR_TM_FLAG_DESC
+};
+
+const size_t jr_telemetry_flag_count =
+    sizeof(jr_telemetry_flags) / sizeof(jr_telemetry_flags[0]);
+
+// Compile-time layout checks: every version is exactly the fields it carries,
+// back-to-back, and matches its published size.
+struct tm_layout_t {
+  uint8_t size;
+  uint8_t offset;
+  uint8_t since;
+};
+
+static constexpr tm_layout_t TM_LAYOUT[] = {
+#define JR_TM_LAYOUT(name, type, offset, since, doc)                           \
+  {sizeof(jr_tm_##type##_t), offset, since},
+    JR_TELEMETRY_FIELDS(JR_TM_LAYOUT)
+#undef JR_TM_LAYOUT
+};
+
+static constexpr size_t layout_end(uint8_t version) {
+  size_t end = 0;
+  for (const tm_layout_t &f : TM_LAYOUT) {
+    if (f.since <= version && f.offset + f.size > end) {
+      end = f.offset + f.size;
+    }
+  }
+  return end;
+}
+
+static constexpr size_t layout_bytes(uint8_t version) {
+  size_t n = 0;
+  for (const tm_layout_t &f : TM_LAYOUT) {
+    if (f.since <= version) {
+      n += f.size;
+    }
+  }
+  return n;
+}
+
+static_assert(layout_end(1) == JR_TELEMETRY_V1_SIZE, "v1 size mismatch");
+static_assert(layout_end(2) == JR_TELEMETRY_V2_SIZE, "v2 size mismatch");
+static_assert(layout_bytes(1) == layout_end(1), "v1 fields overlap or gap");
+static_assert(layout_end(3) == JR_TELEMETRY_V3_SIZE, "v3 size mismatch");
+static_assert(layout_bytes(2) == layout_end(2), "v2 fields overlap or gap");
+static_assert(layout_bytes(3) == layout_end(3), "v3 fields overlap or gap");
+static_assert(layout_end(JR_TELEMETRY_VERSION) == JR_TELEMETRY_MAX_SIZE,
+              "JR_TELEMETRY_MAX_SIZE mismatch");
+
+size_t jr_telemetry_size(uint8_t version) {
+  return (version >= 1 && version <= JR_TELEMETRY_VERSION)
+             ? layout_end(version)
+             : 0;
+}
+
+size_t jr_telemetry_pack(const jr_telemetry_t *t, uint8_t version,
+                         uint8_t *out, size_t cap) {
+  const size_t size = jr_telemetry_size(version);
+  if (size == 0 || cap < size) {
+    return 0;
+  }
+#define JR_TM_PACK(name, type, offset, since, doc)                             \
+  if ((since) <= version) {                                                    \
+    jr_tm_set_##name(out, t->name);                                            \
+  }
+  JR_TELEMETRY_FIELDS(JR_TM_PACK)
+#undef JR_TM_PACK
+  return size;
+}
+
+bool jr_telemetry_unpack(const uint8_t *rec, size_t len, uint8_t version,
+                         jr_telemetry_t *out) {
+  const size_t size = jr_telemetry_size(version);
+  if (size == 0 || len < size) {
+    return false;
+  }
+  memset(out, 0, sizeof(*out));
+#define JR_TM_UNPACK(name, type, offset, since, doc)                           \
+  if ((since) <= version) {                                                    \
+    out->name = jr_tm_get_##name(rec);                                         \
+  }
+  JR_TELEMETRY_FIELDS(JR_TM_UNPACK)
+#undef JR_TM_UNPACK
+  return true;
+}
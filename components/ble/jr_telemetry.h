@@ -0,0 +1,149 @@
+#pragma once
+/*
+ * components/ble/jr_telemetry.h
+ *
+ * Telemetry record schema and codec (no ESP-IDF dependencies; also built into
+ * tools/jr_schema_gen.cpp, which generates the web client's decoder,
+ * app/public/jr_telemetry.js, from the same table).
+ *
+ * JR_TELEMETRY_FIELDS is the only definition of the record layout. Each entry
+ * is X(name, type, offset, since, doc): a little-endian u8/u16/u32/u64 at a
+ * fixed byte offset, present from record version `since` on. Versions only
+ * append fields, so a version N decoder reads the prefix of any later record.
+ *
+ *   version 1: 12 bytes   timestamp_ms .. flags
+ *   version 2: 16 bytes   version 1 + seq
+ *   version 3: 24 bytes   version 2 + event_us
+ *
+ * jr_tm_get_<field>() / jr_tm_set_<field>() access one field in place in a
+ * record buffer, so a notification can be read or patched without unpacking.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JR_TELEMETRY_VERSION 3
+
+#define JR_TELEMETRY_V1_SIZE 12
+#define JR_TELEMETRY_V2_SIZE 16
+#define JR_TELEMETRY_V3_SIZE 24
+#define JR_TELEMETRY_MAX_SIZE JR_TELEMETRY_V3_SIZE
+
+// X(name, type, offset, since, doc)
+#define JR_TELEMETRY_FIELDS(X)                                                 \
+  X(timestamp_ms, u32, 0, 1, "ms since boot")                                  \
+  X(jump_count, u32, 4, 1, "jumps; relative to START with reset-on-start")     \
+  X(heart_rate_bpm, u8, 8, 1, "0 = invalid")                                   \
+  X(spo2_pct, u16, 9, 1, "SpO2 in percent, 0 = invalid")                       \
+  X(flags, u8, 11, 1, "JR_TM_F_* bits")                                        \
+  X(seq, u32, 12, 2, "record sequence number (gap fill)")                     \
+  X(event_us, u64, 16, 3, "device us since boot when the state changed")
+
+// X(name, bit, doc)
+#define JR_TELEMETRY_FLAGS(X)                                                  \
+  X(HR_VALID, 0, "heart_rate_bpm is a valid reading")                          \
+  X(SPO2_VALID, 1, "spo2_pct is a valid reading")                              \
+  X(CALIBRATING, 2, "the jump detector is calibrating")
+
+typedef uint8_t jr_tm_u8_t;
+typedef uint16_t jr_tm_u16_t;
+typedef uint32_t jr_tm_u32_t;
+typedef uint64_t jr_tm_u64_t;
+
+enum {
+#define JR_TM_FLAG(name, bit, doc) JR_TM_F_##name = 1u << (bit),
+  JR_TELEMETRY_FLAGS(JR_TM_FLAG)
+#undef JR_TM_FLAG
+};
+
+// One record in host byte order. Fields newer than the record's version
+// unpack as 0.
+typedef struct {
+#define JR_TM_MEMBER(name, type, offset, since, doc) jr_tm_##type##_t name;
+  JR_TELEMETRY_FIELDS(JR_TM_MEMBER)
+#undef JR_TM_MEMBER
+} jr_telemetry_t;
+
+static inline uint8_t jr_tm_load_u8(const uint8_t *p) { return p[0]; }
+
+static inline uint16_t jr_tm_load_u16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t jr_tm_load_u32(const uint8_t *p) {
+  return jr_tm_load_u16(p) | ((uint32_t)jr_tm_load_u16(p + 2) << 16);
+}
+
+static inline uint64_t jr_tm_load_u64(const uint8_t *p) {
+  return jr_tm_load_u32(p) | ((uint64_t)jr_tm_load_u32(p + 4) << 32);
+}
+
+static inline void jr_tm_store_u8(uint8_t *p, uint8_t v) { p[0] = v; }
+
+static inline void jr_tm_store_u16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void jr_tm_store_u32(uint8_t *p, uint32_t v) {
+  jr_tm_store_u16(p, (uint16_t)v);
+  jr_tm_store_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static inline void jr_tm_store_u64(uint8_t *p, uint64_t v) {
+  jr_tm_store_u32(p, (uint32_t)v);
+  jr_tm_store_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+#define JR_TM_ACCESSORS(name, type, offset, since, doc)                        \
+  static inline jr_tm_##type##_t jr_tm_get_##name(const uint8_t *rec) {        \
+    return jr_tm_load_##type(rec + (offset));                                  \
+  }                                                                            \
+  static inline void jr_tm_set_##name(uint8_t *rec, jr_tm_##type##_t v) {      \
+    jr_tm_store_##type(rec + (offset), v);                                     \
+  }
+JR_TELEMETRY_FIELDS(JR_TM_ACCESSORS)
+#undef JR_TM_ACCESSORS
+
+// Field table for generators and checks (same order as JR_TELEMETRY_FIELDS).
+typedef struct {
+  const char *name;
+  uint8_t size; // bytes
+  uint8_t offset;
+  uint8_t since; // first version carrying the field
+  const char *doc;
+} jr_tm_field_t;
+
+extern const jr_tm_field_t jr_telemetry_fields[];
+extern const size_t jr_telemetry_field_count;
+
+typedef struct {
+  const char *name;
+  uint8_t bit;
+  const char *doc;
+} jr_tm_flag_t;
+
+extern const jr_tm_flag_t jr_telemetry_flags[];
+extern const size_t jr_telemetry_flag_count;
+
+// Record size of a version; 0 when the version is unknown.
+size_t jr_telemetry_size(uint8_t version);
+
+// Writes one record of the given version. Returns its size, or 0 when cap
+// is too small or the version is unknown.
+size_t jr_telemetry_pack(const jr_telemetry_t *t, uint8_t version,
+                         uint8_t *out, size_t cap);
+
+// Reads one record of the given version. Returns false when len is too
+// short or the version is unknown.
+bool jr_telemetry_unpack(const uint8_t *rec, size_t len, uint8_t version,
+                         jr_telemetry_t *out);
+
+#ifdef __cplusplus
+}
+#endif
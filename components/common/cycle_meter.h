@@ -0,0 +1,34 @@
+#pragma once
+
+#include "esp_cpu.h"
+#include <cstdint>
+
+// Accumulates CPU cycles spent in a code region and reports the cost per
+// unit of work (e.g. per output sample). Not thread-safe; keep one per task.
+class CycleMeter {
+public:
+  void start() { _start = esp_cpu_get_cycle_count(); }
+
+  // Ends the region started by start() and credits it with `units` of work.
+  void stop(uint32_t units = 1) {
+    _cycles += static_cast<uint32_t>(esp_cpu_get_cycle_count() - _start);
+    _units += units;
+  }
+
+  uint32_t cyclesPerUnit() const {
+    return (_units == 0) ? 0 : static_cast<uint32_t>(_cycles / _units);
+  }
+
+  uint64_t totalCycles() const { return _cycles; }
+  uint32_t totalUnits() const { return _units; }
+
+  void reset() {
+    _cycles = 0;
+    _units = 0;
+  }
+
+private:
+  esp_cpu_cycle_count_t _start = 0;
+  uint64_t _cycles = 0;
+  uint32_t _units = 0;
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+// Quantiles of a positive value stream in constant memory. Values land in
+// BINS log-spaced bins between lo and hi (clamped), so the answer is exact to
+// within a bin (about 12% wide for a 200:1 range) before interpolation.
+// Older samples fade with the given half-life (in samples), so the estimate
+// follows a drifting stream instead of averaging over everything seen.
+// add() is O(1); quantile() walks the bins. Not thread-safe.
+template <int BINS = 48> class StreamingQuantile {
+public:
+  StreamingQuantile(float lo, float hi, float halfLifeSamples)
+      : _logLo(logf(lo)),
+        _binsPerLog(BINS / (logf(hi) - logf(lo))),
+        _growth(exp2f(1.0f / halfLifeSamples)) {
+    reset();
+  }
+
+  void reset() {
+    for (float &b : _bins) {
+      b = 0.0f;
+    }
+    _total = 0.0f;
+    _increment = 1.0f;
+  }
+
+  // Adds value with `weight` samples' worth of evidence.
+  void add(float value, float weight = 1.0f) {
+    // Instead of decaying every bin, later samples weigh more
+    _increment *= _growth;
+    if (_increment > RESCALE_AT) {
+      for (float &b : _bins) {
+        b /= _increment;
+      }
+      _total /= _increment;
+      _increment = 1.0f;
+    }
+    _bins[binOf(value)] += _increment * weight;
+    _total += _increment * weight;
+  }
+
+  // Faded number of samples behind the estimate (0 = none yet).
+  float weight() const { return _total / _increment; }
+
+  // Value below which a fraction q of the (faded) samples fall; 0 when
+  // nothing was added.
+  float quantile(float q) const {
+    if (_total <= 0.0f) {
+      return 0.0f;
+    }
+    const float target = q * _total;
+    float below = 0.0f;
+    for (int i = 0; i < BINS; i++) {
+      if (_bins[i] > 0.0f && below + _bins[i] >= target) {
+        // Interpolate within the bin on the log scale
+        const float frac = (target - below) / _bins[i];
+        return expf(_logLo + (i + frac) / _binsPerLog);
+      }
+      below += _bins[i];
+    }
+    return expf(_logLo + BINS / _binsPerLog);
+  }
+
+private:
+  static constexpr float RESCALE_AT = 1e6f;
+
+  int binOf(float value) const {
+    if (!(value > 0.0f)) {
+      return 0;
+    }
+    const int i = static_cast<int>((logf(value) - _logLo) * _binsPerLog);
+    return i < 0 ? 0 : (i >= BINS ? BINS - 1 : i);
+  }
+
+  float _logLo;
+  float _binsPerLog;
+  float _growth; // per-sample increment growth, 2^(1 / half-life)
+  float _bins[BINS];
+  float _total;
+  float _increment; // weight of the newest sample
+};
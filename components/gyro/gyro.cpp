@@ -1,11 +1,15 @@
 #include "gyro.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "i2cInit.h"
 #include "mutex.h"
 
 static const char *TAG = "MPU";
 
-SensorReading::SensorReading() : _initialized(false) {
+SensorReading::SensorReading()
+    : _initialized(false), accel_sensitivity(16384.0f),
+      gyro_sensitivity(131.0f), _lastRawAz(0), _accelHistory{},
+      _accelHead(0) {
   data_queue = xQueueCreate(10, sizeof(mpu_data_t));
   init();
 }
@@ -92,6 +96,12 @@ void SensorReading::readSensitivity() {
 
 // Read accelerometer only
 esp_err_t SensorReading::readRawAccel(int16_t &az) {
+  int16_t ax, ay;
+  return readRawAccel(ax, ay, az);
+}
+
+// Read all three accelerometer axes (one 6-byte burst)
+esp_err_t SensorReading::readRawAccel(int16_t &ax, int16_t &ay, int16_t &az) {
   if (!_initialized)
     return ESP_FAIL;
 
@@ -104,11 +114,57 @@ esp_err_t SensorReading::readRawAccel(int16_t &az) {
                                                raw, 6, pdMS_TO_TICKS(100));
   if (ret != ESP_OK)
     return ret;
+  ax = (raw[0] << 8) | raw[1];
+  ay = (raw[2] << 8) | raw[3];
   az = (raw[4] << 8) | raw[5];
+  _lastRawAz.store(az, std::memory_order_relaxed);
+
+  const uint32_t head = _accelHead.load(std::memory_order_relaxed);
+  AccelSample &slot = _accelHistory[head % ACCEL_HISTORY_LEN];
+  slot.tsUs = esp_timer_get_time();
+  slot.az = az;
+  _accelHead.store(head + 1, std::memory_order_release);
 
   return ESP_OK;
 }
 
+bool SensorReading::accelAtG(int64_t tsUs, float &g) const {
+  const uint32_t head = _accelHead.load(std::memory_order_acquire);
+  if (head == 0)
+    return false;
+
+  const uint32_t newest = head - 1;
+  const AccelSample &last = _accelHistory[newest % ACCEL_HISTORY_LEN];
+  if (tsUs >= last.tsUs) {
+    g = last.az / accel_sensitivity;
+    return true;
+  }
+
+  // Walk back to the sample at or before tsUs. Stay clear of the slot the
+  // writer may be overwriting next.
+  const uint32_t depth =
+      (head < ACCEL_HISTORY_LEN - 1) ? head : ACCEL_HISTORY_LEN - 1;
+  for (uint32_t back = 1; back < depth; back++) {
+    const uint32_t i = newest - back;
+    const AccelSample &a = _accelHistory[i % ACCEL_HISTORY_LEN];
+    if (a.tsUs > tsUs)
+      continue;
+
+    const AccelSample &b = _accelHistory[(i + 1) % ACCEL_HISTORY_LEN];
+    const float span = static_cast<float>(b.tsUs - a.tsUs);
+    const float t = (span > 0.0f) ? (tsUs - a.tsUs) / span : 0.0f;
+    const float az = a.az + t * (b.az - a.az);
+
+    // Reject if the writer lapped us while we were reading
+    if (_accelHead.load(std::memory_order_acquire) - i >= ACCEL_HISTORY_LEN)
+      return false;
+
+    g = az / accel_sensitivity;
+    return true;
+  }
+  return false;
+}
+
 // Read gyroscope only
 esp_err_t SensorReading::readRawGyro(int16_t &gx, int16_t &gy, int16_t &gz) {
   if (!_initialized)
@@ -4,10 +4,15 @@
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include <atomic>
 #include <cstdint>
 
 constexpr uint8_t MPU_ADDR = 0x68;
 
+// Timestamped accel history kept for consumers that need time alignment
+// (e.g. PPG motion cancellation). 128 samples = 1.28 s at 100 Hz.
+constexpr uint32_t ACCEL_HISTORY_LEN = 128;
+
 typedef struct {
   float ax_g, ay_g, az_g;
   float gx_dps, gy_dps, gz_dps;
@@ -25,9 +30,20 @@ public:
   void startTask();
   QueueHandle_t getQueue() const { return data_queue; }
   esp_err_t readRawAccel(int16_t &az);
+  esp_err_t readRawAccel(int16_t &ax, int16_t &ay, int16_t &az);
   esp_err_t readRawGyro(int16_t &gx, int16_t &gy, int16_t &gz);
   bool isInitialized() const { return _initialized; }
 
+  // Last Z acceleration seen by readRawAccel(), in g. Lock-free; safe to call
+  // from any task.
+  float latestAccelG() const {
+    return _lastRawAz.load(std::memory_order_relaxed) / accel_sensitivity;
+  }
+
+  // Z acceleration (g) at esp_timer time tsUs, linearly interpolated from the
+  // history. Returns false when tsUs is older than the retained history.
+  bool accelAtG(int64_t tsUs, float &g) const;
+
   SensorReading();
 
 private:
@@ -39,6 +55,17 @@ private:
   bool _initialized;
   float accel_sensitivity;
   float gyro_sensitivity;
+  std::atomic<int16_t> _lastRawAz;
+
+  // Written by readRawAccel, which several tasks call; writers are
+  // serialized by the I2C mutex held around the write. Readers are
+  // lock-free.
+  struct AccelSample {
+    int64_t tsUs;
+    int16_t az;
+  };
+  AccelSample _accelHistory[ACCEL_HISTORY_LEN];
+  std::atomic<uint32_t> _accelHead; // total samples written
 
   QueueHandle_t data_queue;
 
@@ -148,6 +148,36 @@ esp_err_t maxim_max30102_read_fifo(uint32_t *red, uint32_t *ir)
     return ESP_OK;
 }
 
+esp_err_t maxim_max30102_fifo_available(uint8_t *count)
+/**
+* \brief        Number of unread FIFO samples
+* \par          Details
+*               Derived from the FIFO write/read pointers (32-sample FIFO).
+*               A non-zero overflow counter means the FIFO is full.
+*
+* \param[out]   *count                  - Unread samples (0..32)
+*
+* \retval       ESP_OK on success
+*/
+{
+    uint8_t wr_ptr, rd_ptr, ovf;
+    esp_err_t ret;
+
+    ret = maxim_max30102_read_reg(REG_OVF_COUNTER, &ovf);
+    if (ret != ESP_OK) return ret;
+    ret = maxim_max30102_read_reg(REG_FIFO_WR_PTR, &wr_ptr);
+    if (ret != ESP_OK) return ret;
+    ret = maxim_max30102_read_reg(REG_FIFO_RD_PTR, &rd_ptr);
+    if (ret != ESP_OK) return ret;
+
+    if (ovf & 0x1F)
+        *count = 32;
+    else
+        *count = (uint8_t)((wr_ptr - rd_ptr) & 0x1F);
+
+    return ESP_OK;
+}
+
 bool maxim_max30102_reset()
 /**
 * \brief        Reset the MAX30102
@@ -46,5 +46,6 @@ bool maxim_max30102_read_temperature(int8_t *integer_part,
 esp_err_t maxim_max30102_write_reg(uint8_t reg, uint8_t value);
 esp_err_t maxim_max30102_read_reg(uint8_t reg, uint8_t *value);
 esp_err_t maxim_max30102_read_fifo(uint32_t *red, uint32_t *ir);
+esp_err_t maxim_max30102_fifo_available(uint8_t *count);
 
 #endif /* MAX30102_H_ */
@@ -46,8 +46,9 @@ namespace{
      */
     bool changeRegBitValue(uint8_t regAddr, uint8_t bit, bool value) {
         uint8_t actualRegValue;
-        maxim_max30102_read_reg(regAddr, &actualRegValue);
-        return maxim_max30102_write_reg(regAddr, alterBitValue(actualRegValue, bit, value));
+        if (maxim_max30102_read_reg(regAddr, &actualRegValue) != ESP_OK)
+            return false;
+        return maxim_max30102_write_reg(regAddr, alterBitValue(actualRegValue, bit, value)) == ESP_OK;
     }
 
     /**
@@ -64,9 +65,10 @@ namespace{
         
 
         uint8_t actualRegValue;
-        maxim_max30102_read_reg(regAddr, &actualRegValue);
+        if (maxim_max30102_read_reg(regAddr, &actualRegValue) != ESP_OK)
+            return false;
         actualRegValue = setBitsInField(actualRegValue, value, mask);
-        return maxim_max30102_write_reg(regAddr, actualRegValue);
+        return maxim_max30102_write_reg(regAddr, actualRegValue) == ESP_OK;
     }
 }
 
@@ -76,6 +78,7 @@ namespace{
 const uint8_t INTR_A_FULL_BIT = 7;
 const uint8_t INTR_PPG_RDY_BIT = 6;
 const uint8_t INTR_ALC_OVF_BIT = 5;
+const uint8_t INTR_PROX_INT_BIT = 4;
 
 bool interruptAFull(bool enable){
     return changeRegBitValue(REG_INTR_ENABLE_1, INTR_A_FULL_BIT, enable);
@@ -86,6 +89,9 @@ bool interruptPPGReady(bool enable){
 bool interruptALCOverflow(bool enable){
     return changeRegBitValue(REG_INTR_ENABLE_1, INTR_ALC_OVF_BIT, enable);
 }
+bool interruptProximity(bool enable){
+    return changeRegBitValue(REG_INTR_ENABLE_1, INTR_PROX_INT_BIT, enable);
+}
 
 
 // Interrupts Enable 2
@@ -175,6 +181,16 @@ bool setLED1PulseAmplitude(uint8_t amplitude){
 bool setLED2PulseAmplitude(uint8_t amplitude){
     return changeRegMaskValue(REG_LED2_PA, LED_PA_MASK, amplitude);
 }
+bool setPilotPulseAmplitude(uint8_t amplitude){
+    return changeRegMaskValue(REG_PILOT_PA, LED_PA_MASK, amplitude);
+}
+
+// Proximity Interrupt Threshold
+// Reg: REG_PROX_INT_THRESH (8 MSBs of the 18-bit IR ADC count)
+const uint8_t PROX_INT_THRESH_MASK = 0xFF;
+bool setProximityThreshold(uint8_t threshold){
+    return changeRegMaskValue(REG_PROX_INT_THRESH, PROX_INT_THRESH_MASK, threshold);
+}
 
 // Temperature Configuration
 // Reg: REG_TEMP_CONFIG
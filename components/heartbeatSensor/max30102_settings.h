@@ -62,6 +62,7 @@ bool interruptAFull(bool enable);
 bool interruptPPGReady(bool enable);
 bool interruptALCOverflow(bool enable);
 bool interruptDIETempReady(bool enable);
+bool interruptProximity(bool enable);
 
 // ===================== FIFO (0x04-0x07) =====================
 
@@ -88,13 +89,18 @@ bool setSPO2ADCRange(SPO2_ADC_Range adcRange);
 bool setSPO2SampleRate(SPO2_SampleRate sampleRate);
 bool setSPO2PulseWidth(SPO2_PulseWidth pulseWidth);
 
-// ===================== LED Pulse Amplitude (0x0C-0x0D) =====================
+// ===================== LED Pulse Amplitude (0x0C-0x0D, 0x10) ================
 
 bool setLED1PulseAmplitude(uint8_t amplitude);
 bool setLED2PulseAmplitude(uint8_t amplitude);
+bool setPilotPulseAmplitude(uint8_t amplitude);
 
 // ===================== Temperature Data (0x1F-0x21) =====================
 
 bool setTemperatureEnabled(bool enable);
 
+// ===================== Proximity Interrupt Threshold (0x30) =====================
+
+bool setProximityThreshold(uint8_t threshold);
+
 #endif // MAX30102_SETTINGS_H
@@ -9,10 +9,10 @@ namespace
                   uint8_t regToRead, uint8_t expectedResult, bool expectedSuccess = true)
     {
         uint8_t regValue = 0;
-        esp_err_t res = functionToCall(functionParamValue);
+        bool res = functionToCall(functionParamValue);
 
-        if ((res != ESP_OK && expectedSuccess) || (res == ESP_OK && !expectedSuccess)) {
-            printf("[FAIL] %s: Function call %s\n", testName, (res == ESP_OK) ? "succeeded unexpectedly" : "failed");
+        if (res != expectedSuccess) {
+            printf("[FAIL] %s: Function call %s\n", testName, res ? "succeeded unexpectedly" : "failed");
             return false;
         }
 
@@ -0,0 +1,80 @@
+#include "motion_canceller.h"
+
+// DC trackers: single-pole high-pass, time constant 2^shift samples.
+constexpr int PPG_DC_SHIFT = 5;   // ~1.3 s at 25 Hz
+constexpr int ACCEL_DC_SHIFT = 6; // ~2.6 s at 25 Hz
+
+// Regularization so quiet references do not blow up the step.
+constexpr int64_t NLMS_EPS = 1 << 16;
+
+// Keep the filter from chasing impossible gains on transients.
+constexpr int32_t NLMS_W_LIMIT = 1 << 28;
+
+MotionCanceller::MotionCanceller(int16_t muQ15) : _muQ15(muQ15) { reset(); }
+
+void MotionCanceller::reset() {
+  _ppgDcQ8 = 0;
+  _accelDcQ8 = 0;
+  _primed = false;
+  _head = 0;
+  _energy = 0;
+  for (int i = 0; i < MOTION_TAPS; i++) {
+    _x[i] = 0;
+    _w[i] = 0;
+  }
+}
+
+uint32_t MotionCanceller::process(uint32_t ppg, float accelG) {
+  float scaled = accelG * 4096.0f;
+  scaled = (scaled > 32767.0f) ? 32767.0f : scaled;
+  scaled = (scaled < -32768.0f) ? -32768.0f : scaled;
+  const int32_t accelQ12 = static_cast<int32_t>(scaled);
+
+  if (!_primed) {
+    _ppgDcQ8 = static_cast<int64_t>(ppg) << 8;
+    _accelDcQ8 = accelQ12 * 256; // signed: multiply, never shift
+    _primed = true;
+  }
+
+  // Remove DC from both signals
+  _ppgDcQ8 += ((static_cast<int64_t>(ppg) << 8) - _ppgDcQ8) >> PPG_DC_SHIFT;
+  _accelDcQ8 += (accelQ12 * 256 - _accelDcQ8) >> ACCEL_DC_SHIFT;
+  const int32_t d = static_cast<int32_t>(ppg - (_ppgDcQ8 >> 8));
+
+  int32_t xNew = accelQ12 - (_accelDcQ8 >> 8);
+  xNew = (xNew > 32767) ? 32767 : ((xNew < -32768) ? -32768 : xNew);
+
+  // Slide the reference window, keeping |x|^2 incrementally
+  const int16_t xOld = _x[_head];
+  _energy += static_cast<int64_t>(xNew) * xNew -
+             static_cast<int64_t>(xOld) * xOld;
+  _x[_head] = static_cast<int16_t>(xNew);
+
+  // Filter output: newest sample pairs with w[0]
+  int64_t acc = 0;
+  int idx = _head;
+  for (int k = 0; k < MOTION_TAPS; k++) {
+    acc += static_cast<int64_t>(_w[k]) * _x[idx];
+    idx = (idx == 0) ? MOTION_TAPS - 1 : idx - 1;
+  }
+  const int32_t y = static_cast<int32_t>(acc >> 16);
+  const int32_t e = d - y;
+
+  // Normalized update: one division per sample, shared by all taps
+  const int64_t step =
+      (static_cast<int64_t>(e) * _muQ15 * 65536) / (_energy + NLMS_EPS);
+  idx = _head;
+  for (int k = 0; k < MOTION_TAPS; k++) {
+    int64_t w = _w[k] + ((step * _x[idx]) >> 15);
+    w = (w > NLMS_W_LIMIT) ? NLMS_W_LIMIT
+                           : ((w < -NLMS_W_LIMIT) ? -NLMS_W_LIMIT : w);
+    _w[k] = static_cast<int32_t>(w);
+    idx = (idx == 0) ? MOTION_TAPS - 1 : idx - 1;
+  }
+
+  if (++_head == MOTION_TAPS)
+    _head = 0;
+
+  const int64_t out = (_ppgDcQ8 >> 8) + e;
+  return (out < 0) ? 0 : static_cast<uint32_t>(out);
+}
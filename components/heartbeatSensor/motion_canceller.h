@@ -0,0 +1,45 @@
+#pragma once
+/*
+ * components/heartbeatSensor/motion_canceller.h
+ *
+ * Accelerometer-referenced adaptive noise canceller for one PPG channel.
+ *
+ * Jumping adds a cadence-locked component to the IR/red signals that is
+ * strongly correlated with the rope's acceleration. A fixed-point NLMS filter
+ * predicts that component from the last MOTION_TAPS accelerometer samples
+ * (time-aligned to the PPG sample) and subtracts it; what is left is the
+ * cardiac pulse plus uncorrelated noise.
+ *
+ *   d[n] = PPG AC (DC removed)      x[n] = accel AC, Q12 g
+ *   y[n] = sum w[k] * x[n-k]        e[n] = d[n] - y[n]   (cleaned AC)
+ *   w[k] += mu * e[n] * x[n-k] / (eps + |x|^2)
+ */
+
+#include <cstdint>
+
+constexpr int MOTION_TAPS = 8; // 320 ms of reference at 25 Hz
+
+class MotionCanceller {
+public:
+  // muQ15: NLMS step size in Q15 (e.g. 3277 = 0.1).
+  explicit MotionCanceller(int16_t muQ15 = 3277);
+
+  // Processes one PPG sample with its time-aligned acceleration (g).
+  // Returns the cleaned sample with the PPG DC level restored, so the result
+  // can go straight into the algorithm buffers.
+  uint32_t process(uint32_t ppg, float accelG);
+
+  void reset();
+
+private:
+  int32_t _muQ15;
+
+  int64_t _ppgDcQ8;   // PPG DC estimate, Q8
+  int32_t _accelDcQ8; // accel DC estimate, Q12 g scaled by 2^8
+  bool _primed;
+
+  int16_t _x[MOTION_TAPS]; // reference history (circular), Q12 g
+  int32_t _w[MOTION_TAPS]; // weights, Q16
+  int _head;
+  int64_t _energy;         // sum of x^2 over the history
+};
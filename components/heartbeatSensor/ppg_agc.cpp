@@ -0,0 +1,129 @@
+#include "ppg_agc.h"
+
+constexpr uint32_t AGC_FULL_SCALE = 1UL << 18;
+constexpr uint32_t AGC_TARGET = AGC_FULL_SCALE / 2;
+constexpr uint32_t AGC_BAND_LOW = AGC_FULL_SCALE * 35 / 100;
+constexpr uint32_t AGC_BAND_HIGH = AGC_FULL_SCALE * 65 / 100;
+
+constexpr uint8_t AGC_PA_FLOOR = 4; // below this the PA step is too coarse
+constexpr uint8_t AGC_PA_MAX = 0xFF;
+constexpr uint8_t AGC_STABLE_BLOCKS = 2;
+
+// Smallest to largest full-scale current
+static const SPO2_ADC_Range AGC_RANGES[] = {ADC_RANGE_2048, ADC_RANGE_4096,
+                                           ADC_RANGE_8192, ADC_RANGE_16384};
+constexpr int AGC_NUM_RANGES = sizeof(AGC_RANGES) / sizeof(AGC_RANGES[0]);
+
+static int rangeIndex(SPO2_ADC_Range range) {
+  for (int i = 0; i < AGC_NUM_RANGES; i++) {
+    if (AGC_RANGES[i] == range)
+      return i;
+  }
+  return 1;
+}
+
+static bool inBand(uint32_t dc) {
+  return dc >= AGC_BAND_LOW && dc <= AGC_BAND_HIGH;
+}
+
+LedAgc::LedAgc(const LedAgcSettings &initial)
+    : _settings(initial), _redSum(0), _irSum(0), _count(0), _skipNext(false),
+      _converged(false), _stableBlocks(0), _restartUs(0), _convergenceMs(0) {}
+
+void LedAgc::restart(int64_t nowUs) {
+  _redSum = 0;
+  _irSum = 0;
+  _count = 0;
+  _skipNext = true;
+  _converged = false;
+  _stableBlocks = 0;
+  _restartUs = nowUs;
+  _convergenceMs = 0;
+}
+
+uint8_t LedAgc::adjust(uint8_t pa, uint32_t dc) const {
+  if (inBand(dc))
+    return pa;
+
+  // Proportional correction, limited to a factor of two per block. DC is
+  // roughly proportional to LED current; a clipped reading only says
+  // "too bright", which the 2x limit handles.
+  uint32_t want = (dc == 0) ? pa * 2u
+                            : static_cast<uint32_t>(
+                                  (static_cast<uint64_t>(pa) * AGC_TARGET) / dc);
+  const uint32_t lo = pa / 2u;
+  const uint32_t hi = pa * 2u + 1u;
+  want = (want < lo) ? lo : ((want > hi) ? hi : want);
+  return static_cast<uint8_t>((want > AGC_PA_MAX) ? AGC_PA_MAX : want);
+}
+
+bool LedAgc::push(uint32_t red, uint32_t ir, int64_t nowUs) {
+  _redSum += red;
+  _irSum += ir;
+  if (++_count < AGC_UPDATE_SAMPLES)
+    return false;
+
+  const uint32_t redDc = static_cast<uint32_t>(_redSum / _count);
+  const uint32_t irDc = static_cast<uint32_t>(_irSum / _count);
+  _redSum = 0;
+  _irSum = 0;
+  _count = 0;
+
+  if (_skipNext) {
+    _skipNext = false;
+    return false;
+  }
+
+  if (inBand(redDc) && inBand(irDc)) {
+    if (!_converged && ++_stableBlocks >= AGC_STABLE_BLOCKS) {
+      _converged = true;
+      _convergenceMs = static_cast<uint32_t>((nowUs - _restartUs) / 1000);
+    }
+    return false;
+  }
+
+  _stableBlocks = 0;
+  if (_converged) {
+    // Lost the operating point (pressure / placement changed)
+    _converged = false;
+    _restartUs = nowUs;
+  }
+
+  uint32_t redPa = adjust(_settings.redPa, redDc);
+  uint32_t irPa = adjust(_settings.irPa, irDc);
+  int range = rangeIndex(_settings.range);
+
+  if (range > 0 && redPa >= 2u * AGC_PA_FLOOR && irPa >= 2u * AGC_PA_FLOOR) {
+    // Halving the full scale doubles the counts: same DC at half the current
+    range--;
+    redPa /= 2;
+    irPa /= 2;
+  } else if (range < AGC_NUM_RANGES - 1 &&
+             ((redPa < AGC_PA_FLOOR && redDc > AGC_BAND_HIGH) ||
+              (irPa < AGC_PA_FLOOR && irDc > AGC_BAND_HIGH))) {
+    // Too bright even at the LED floor: widen the range instead
+    range++;
+    redPa = redPa * 2;
+    irPa = irPa * 2;
+  }
+
+  redPa = (redPa < 1) ? 1 : ((redPa > AGC_PA_MAX) ? AGC_PA_MAX : redPa);
+  irPa = (irPa < 1) ? 1 : ((irPa > AGC_PA_MAX) ? AGC_PA_MAX : irPa);
+
+  const LedAgcSettings next = {static_cast<uint8_t>(redPa),
+                               static_cast<uint8_t>(irPa), AGC_RANGES[range]};
+  if (next.redPa == _settings.redPa && next.irPa == _settings.irPa &&
+      next.range == _settings.range)
+    return false; // pinned at a limit; nothing more to do
+
+  _settings = next;
+  _skipNext = true;
+  return true;
+}
+
+bool ppgApplyAgcSettings(const LedAgcSettings &settings) {
+  return setSPO2ADCRange(settings.range) &&
+         setLED1PulseAmplitude(settings.redPa) &&
+         setLED2PulseAmplitude(settings.irPa) && setFifoWritePointer(0) &&
+         setFifoOverflowCounter(0) && setFifoReadPointer(0);
+}
@@ -0,0 +1,62 @@
+#pragma once
+/*
+ * components/heartbeatSensor/ppg_agc.h
+ *
+ * Closed-loop LED current control for the MAX30102.
+ *
+ * Every AGC_UPDATE_SAMPLES raw samples the loop compares the red and IR DC
+ * levels against a target band around half of the 18-bit ADC scale and
+ * rescales the LED pulse amplitudes proportionally (at most 2x per step).
+ * The ADC full-scale range is kept as small as the signal allows, since a
+ * smaller range reaches the same count with less photocurrent, i.e. less LED
+ * current. The range only grows when an LED is already at its floor and the
+ * channel is still too bright.
+ */
+
+#include "max30102_settings.h"
+#include <cstdint>
+
+constexpr uint16_t AGC_UPDATE_SAMPLES = 50; // 0.5 s at 100 Hz
+
+struct LedAgcSettings {
+  uint8_t redPa; // LED1 pulse amplitude (0.2 mA/LSB)
+  uint8_t irPa;  // LED2 pulse amplitude
+  SPO2_ADC_Range range;
+};
+
+class LedAgc {
+public:
+  explicit LedAgc(const LedAgcSettings &initial);
+
+  // Feeds one raw sample. Returns true when new settings were computed; the
+  // caller must then apply them (ppgApplyAgcSettings) and drop the samples
+  // it already read under the old ones.
+  bool push(uint32_t red, uint32_t ir, int64_t nowUs);
+
+  // Restarts convergence timing (start-up, finger placed back on sensor).
+  void restart(int64_t nowUs);
+
+  const LedAgcSettings &settings() const { return _settings; }
+  bool converged() const { return _converged; }
+  // Time from the last restart() to convergence; 0 while not converged.
+  uint32_t convergenceMs() const { return _convergenceMs; }
+
+private:
+  LedAgcSettings _settings;
+
+  uint64_t _redSum;
+  uint64_t _irSum;
+  uint16_t _count;
+  bool _skipNext; // first block after a change still holds old samples
+
+  bool _converged;
+  uint8_t _stableBlocks;
+  int64_t _restartUs;
+  uint32_t _convergenceMs;
+
+  uint8_t adjust(uint8_t pa, uint32_t dc) const;
+};
+
+// Writes the LED and ADC range settings, then empties the FIFO so the next
+// read only returns samples taken with them.
+bool ppgApplyAgcSettings(const LedAgcSettings &settings);
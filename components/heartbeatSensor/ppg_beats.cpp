@@ -0,0 +1,123 @@
+#include "ppg_beats.h"
+#include "algorithm_by_RF.h"
+#include <cmath>
+
+constexpr int BEAT_DC_SHIFT = 4;          // DC tracker, ~0.6 s at 25 Hz
+constexpr float BEAT_PEAK_FRACTION = 0.5f; // of the running peak height
+constexpr float BEAT_MAX_RR_JUMP = 0.3f;   // successive RR change allowed
+constexpr uint8_t BEAT_MAX_REJECTS = 4;    // in a row, then re-anchor
+constexpr float BEAT_MIN_RR_MS = 60000.0f / MAX_HR;
+constexpr float BEAT_MAX_RR_MS = 60000.0f / MIN_HR;
+
+BeatDetector::BeatDetector(uint16_t sampleRateHz)
+    : _rateHz(sampleRateHz),
+      _minGap(static_cast<uint32_t>(sampleRateHz * BEAT_MIN_RR_MS / 1000.0f)) {
+  reset();
+}
+
+void BeatDetector::resetSignal() {
+  _dcQ8 = 0;
+  _primed = false;
+  _x1 = 0;
+  _x2 = 0;
+  _n = 0;
+  _ampAvg = 0.0f;
+  _havePeak = false;
+  _lastPeakN = 0;
+  _lastPeakT = 0.0f;
+  _prevRrMs = 0.0f;
+  _consecutive = false;
+  _rejects = 0;
+}
+
+void BeatDetector::reset() {
+  resetSignal();
+  _stats = {};
+  _m2 = 0.0;
+  _sumSqDiff = 0.0;
+  _diffs = 0;
+}
+
+bool BeatDetector::push(uint32_t ir, float &rrMs) {
+  if (!_primed) {
+    _dcQ8 = static_cast<int64_t>(ir) << 8;
+    _primed = true;
+  }
+  _dcQ8 += ((static_cast<int64_t>(ir) << 8) - _dcQ8) >> BEAT_DC_SHIFT;
+  const int32_t x = static_cast<int32_t>((_dcQ8 >> 8) - ir); // inverted AC
+
+  bool accepted = false;
+  const uint32_t n = _n++;
+
+  // Local maximum at n-1: rising into it, not rising out of it
+  if (n >= 2 && _x1 > _x2 && _x1 >= x && _x1 > 0 &&
+      _x1 > BEAT_PEAK_FRACTION * _ampAvg &&
+      (!_havePeak || n - 1 - _lastPeakN >= _minGap)) {
+
+    // Parabolic interpolation of the true peak position
+    const float denom = static_cast<float>(_x2 - 2 * _x1 + x);
+    float delta = (denom != 0.0f) ? 0.5f * (_x2 - x) / denom : 0.0f;
+    delta = fmaxf(-0.5f, fminf(0.5f, delta));
+    const float t = static_cast<float>(n - 1) + delta;
+
+    _ampAvg = (_ampAvg == 0.0f) ? _x1 : 0.875f * _ampAvg + 0.125f * _x1;
+    _stats.beats++;
+
+    if (_havePeak) {
+      const float rr = (t - _lastPeakT) * 1000.0f / _rateHz;
+      const bool plausible = rr >= BEAT_MIN_RR_MS && rr <= BEAT_MAX_RR_MS;
+      const bool steady =
+          _prevRrMs == 0.0f ||
+          fabsf(rr - _prevRrMs) <= BEAT_MAX_RR_JUMP * _prevRrMs;
+      if (plausible && steady) {
+        acceptInterval(rr);
+        _prevRrMs = rr;
+        _consecutive = true;
+        _rejects = 0;
+        rrMs = rr;
+        accepted = true;
+      } else {
+        // Keep checking against the last accepted RR so alternating
+        // artifacts cannot reset it; only a run of rejects (a real rate
+        // change) re-anchors the check.
+        _consecutive = false;
+        if (++_rejects >= BEAT_MAX_REJECTS) {
+          _prevRrMs = 0.0f;
+          _rejects = 0;
+        }
+      }
+    }
+
+    _havePeak = true;
+    _lastPeakN = n - 1;
+    _lastPeakT = t;
+  }
+
+  _x2 = _x1;
+  _x1 = x;
+  return accepted;
+}
+
+void BeatDetector::acceptInterval(float rrMs) {
+  // Successive differences only between back-to-back accepted intervals
+  // (_consecutive is cleared by resetSignal and by every rejected interval)
+  const float prev = _prevRrMs;
+  const bool consecutive = _consecutive;
+
+  _stats.intervals++;
+  _stats.lastRrMs = rrMs;
+
+  const double delta = rrMs - _stats.meanRrMs;
+  _stats.meanRrMs += static_cast<float>(delta / _stats.intervals);
+  _m2 += delta * (rrMs - _stats.meanRrMs);
+  _stats.sdnnMs = (_stats.intervals > 1)
+                      ? static_cast<float>(sqrt(_m2 / (_stats.intervals - 1)))
+                      : 0.0f;
+
+  if (consecutive) {
+    const double d = rrMs - prev;
+    _sumSqDiff += d * d;
+    _diffs++;
+    _stats.rmssdMs = static_cast<float>(sqrt(_sumSqDiff / _diffs));
+  }
+}
@@ -0,0 +1,63 @@
+#pragma once
+/*
+ * components/heartbeatSensor/ppg_beats.h
+ *
+ * Streaming beat detector and HRV statistics.
+ *
+ * Works sample-by-sample on the cleaned PPG (O(1) per sample, no window):
+ * the IR AC component is inverted (more blood => less reflected light), a
+ * pulse peak is a +/- sign change of the first difference, and its position
+ * is refined with a parabola through the three samples around it. Accepted
+ * peaks yield beat-to-beat (RR) intervals that feed running SDNN (Welford)
+ * and RMSSD statistics.
+ */
+
+#include <cstdint>
+
+struct HrvStats {
+  uint32_t beats;     // peaks accepted
+  uint32_t intervals; // RR intervals that passed the artifact checks
+  float lastRrMs;
+  float meanRrMs;
+  float sdnnMs;  // std-dev of RR
+  float rmssdMs; // root mean square of successive RR differences
+};
+
+class BeatDetector {
+public:
+  explicit BeatDetector(uint16_t sampleRateHz);
+
+  // Pushes one PPG sample. Returns true when a new RR interval was accepted
+  // (written to rrMs) and the statistics were updated.
+  bool push(uint32_t ir, float &rrMs);
+
+  // Forgets signal history (after a gap or an LED change); keeps statistics.
+  void resetSignal();
+  // Clears the statistics as well.
+  void reset();
+
+  const HrvStats &stats() const { return _stats; }
+
+private:
+  uint16_t _rateHz;
+  uint32_t _minGap; // refractory period in samples (MAX_HR)
+
+  int64_t _dcQ8;
+  bool _primed;
+  int32_t _x1, _x2;   // previous two AC samples (x[n-1], x[n-2])
+  uint32_t _n;        // sample counter
+  float _ampAvg;      // running peak height for the adaptive threshold
+  bool _havePeak;
+  uint32_t _lastPeakN;
+  float _lastPeakT;   // samples, sub-sample resolution
+
+  HrvStats _stats;
+  float _prevRrMs;    // last accepted RR (steadiness reference), 0 = none
+  bool _consecutive;  // the previous interval was accepted (RMSSD)
+  uint8_t _rejects;   // intervals rejected in a row
+  double _m2;         // Welford accumulator for SDNN
+  double _sumSqDiff;  // for RMSSD
+  uint32_t _diffs;
+
+  void acceptInterval(float rrMs);
+};
@@ -0,0 +1,60 @@
+#include "ppg_contact.h"
+#include "max30102.h"
+#include "max30102_settings.h"
+
+// INTR_STATUS_1 bit 4
+constexpr uint8_t PROX_INT_STATUS = 1 << 4;
+
+ContactDetector::ContactDetector(const ContactConfig &config)
+    : _config(config), _state(CONTACT_PRESENT), _lowSamples(0),
+      _lostEvents(0) {}
+
+bool ContactDetector::onSample(uint32_t ir) {
+  if (_state != CONTACT_PRESENT)
+    return false;
+
+  if (ir >= _config.lostDcLevel) {
+    _lowSamples = 0;
+    return false;
+  }
+
+  if (++_lowSamples < _config.lostConfirmSamples)
+    return false;
+
+  _state = CONTACT_LOST;
+  _lowSamples = 0;
+  _lostEvents++;
+  return true;
+}
+
+void ContactDetector::onContactRestored() {
+  _state = CONTACT_PRESENT;
+  _lowSamples = 0;
+}
+
+bool ppgEnterProximityMode(const ContactConfig &config) {
+  // PROX_INT_THRESH compares against the 8 MSBs of the 18-bit IR count
+  const uint8_t threshold = static_cast<uint8_t>(config.presentDcLevel >> 10);
+
+  uint8_t status;
+  maxim_max30102_read_reg(REG_INTR_STATUS_1, &status); // clear stale flags
+
+  return setLED1PulseAmplitude(0) && setLED2PulseAmplitude(0) &&
+         setPilotPulseAmplitude(config.pilotPa) &&
+         setProximityThreshold(threshold) && interruptProximity(true) &&
+         // Re-entering SpO2 mode restarts the proximity function
+         setModeControl(SPO2);
+}
+
+bool ppgProximityDetected() {
+  uint8_t status = 0;
+  if (maxim_max30102_read_reg(REG_INTR_STATUS_1, &status) != ESP_OK)
+    return false;
+  return (status & PROX_INT_STATUS) != 0;
+}
+
+bool ppgLeaveProximityMode(uint8_t led1Pa, uint8_t led2Pa) {
+  return interruptProximity(false) && setLED1PulseAmplitude(led1Pa) &&
+         setLED2PulseAmplitude(led2Pa) && setFifoWritePointer(0) &&
+         setFifoOverflowCounter(0) && setFifoReadPointer(0);
+}
@@ -0,0 +1,66 @@
+#pragma once
+/*
+ * components/heartbeatSensor/ppg_contact.h
+ *
+ * Finger/contact detection for the MAX30102.
+ *
+ * While a finger is present the sensor samples normally and ContactDetector
+ * watches the IR DC level. When the level stays below lostDcLevel for
+ * lostConfirmSamples samples the caller switches the sensor to its
+ * proximity mode (ppgEnterProximityMode): measurement LEDs off, only a dim
+ * pilot LED pulsing, and the chip raises PROX_INT by itself once the IR
+ * count crosses REG_PROX_INT_THRESH. The caller polls ppgProximityDetected()
+ * every CONTACT_POLL_MS, so sampling resumes within that bound (plus one
+ * sensor sample) after the finger returns.
+ */
+
+#include <cstdint>
+
+constexpr uint32_t CONTACT_POLL_MS = 100;
+
+enum ContactState : uint8_t { CONTACT_PRESENT, CONTACT_LOST };
+
+struct ContactConfig {
+  uint32_t lostDcLevel;        // IR DC below this => no finger
+  uint32_t presentDcLevel;     // IR count that re-arms sampling (PROX_INT)
+  uint16_t lostConfirmSamples; // consecutive low samples before giving up
+  uint8_t pilotPa;             // pilot LED amplitude while searching
+};
+
+// Sensor has no finger: ~ambient + cover glass reflection. Samples are raw
+// sensor-rate samples (1 s at 100 Hz).
+constexpr ContactConfig CONTACT_DEFAULTS = {20000, 25000, 100, 0x0A};
+
+class ContactDetector {
+public:
+  explicit ContactDetector(const ContactConfig &config = CONTACT_DEFAULTS);
+
+  // Feeds one IR sample while in CONTACT_PRESENT. Returns true on the
+  // transition to CONTACT_LOST.
+  bool onSample(uint32_t ir);
+
+  // Call when the proximity interrupt reports the finger back.
+  void onContactRestored();
+
+  ContactState state() const { return _state; }
+  const ContactConfig &config() const { return _config; }
+
+  uint32_t lostEvents() const { return _lostEvents; }
+
+private:
+  ContactConfig _config;
+  ContactState _state;
+  uint16_t _lowSamples;
+  uint32_t _lostEvents;
+};
+
+// Turns the measurement LEDs off, sets the pilot LED and arms the proximity
+// interrupt at config.presentDcLevel.
+bool ppgEnterProximityMode(const ContactConfig &config);
+
+// Reads (and clears) INTR_STATUS_1; true when PROX_INT fired.
+bool ppgProximityDetected();
+
+// Disarms the proximity interrupt, restores the LED amplitudes and flushes
+// the FIFO so the next read starts with fresh samples.
+bool ppgLeaveProximityMode(uint8_t led1Pa, uint8_t led2Pa);
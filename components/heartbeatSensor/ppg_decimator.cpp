@@ -0,0 +1,145 @@
+#include "ppg_decimator.h"
+#include "max30102_settings.h"
+
+/*
+ * Windowed-sinc (Hamming) low-pass prototypes, Q15, unity DC gain.
+ * - x4: 24 taps, cutoff 0.10 * fs_in (10 Hz at 100 Hz in), stopband covers
+ *       everything that would fold into the 0-4 Hz heart-rate band at 25 Hz.
+ * - x2: 12 taps, cutoff 0.20 * fs_in.
+ */
+static const int16_t DECIM4_COEFFS[24] = {
+    58,   30,   -50,  -223, -455, -577, -333, 495,  1933, 3726, 5388, 6392,
+    6392, 5388, 3726, 1933, 495,  -333, -577, -455, -223, -50,  30,   58};
+
+static const int16_t DECIM2_COEFFS[12] = {89,    -207, -983, 0,    5528, 11957,
+                                          11957, 5528, 0,    -983, -207, 89};
+
+PpgDecimator::PpgDecimator(uint8_t factor)
+    : _factor(factor), _numTaps(1), _tapsPerPhase(1), _coeffs(nullptr),
+      _phase(0), _head(0) {
+  switch (factor) {
+  case 4:
+    _coeffs = DECIM4_COEFFS;
+    _numTaps = sizeof(DECIM4_COEFFS) / sizeof(DECIM4_COEFFS[0]);
+    break;
+  case 2:
+    _coeffs = DECIM2_COEFFS;
+    _numTaps = sizeof(DECIM2_COEFFS) / sizeof(DECIM2_COEFFS[0]);
+    break;
+  default:
+    // Pass-through: all rate reduction happens on the sensor.
+    _factor = 1;
+    break;
+  }
+  _tapsPerPhase = _numTaps / _factor;
+  reset();
+}
+
+void PpgDecimator::reset() {
+  _phase = 0;
+  _head = 0;
+  for (int i = 0; i < PPG_DECIM_MAX_TAPS_PER_PHASE; i++) {
+    _acc[i] = 0;
+  }
+}
+
+bool PpgDecimator::push(uint32_t in, uint32_t &out) {
+  if (_coeffs == nullptr) {
+    out = in;
+    return true;
+  }
+
+  const int64_t x = static_cast<int64_t>(in);
+  bool ready = false;
+
+  if (_phase == 0) {
+    // Phase 0 feeds taps 0, M, 2M, ... of the current and following outputs;
+    // tap 0 completes the output owned by _head.
+    int slot = _head;
+    for (int j = 0; j < _tapsPerPhase; j++) {
+      _acc[slot] += x * _coeffs[j * _factor];
+      if (++slot == _tapsPerPhase)
+        slot = 0;
+    }
+
+    int64_t y = (_acc[_head] + (1 << 14)) >> 15;
+    out = (y < 0) ? 0 : static_cast<uint32_t>(y);
+    ready = true;
+
+    _acc[_head] = 0;
+    if (++_head == _tapsPerPhase)
+      _head = 0;
+  } else {
+    // Phase p feeds taps M-p, 2M-p, ... of the next _tapsPerPhase outputs.
+    int slot = _head;
+    for (int j = 1; j <= _tapsPerPhase; j++) {
+      _acc[slot] += x * _coeffs[j * _factor - _phase];
+      if (++slot == _tapsPerPhase)
+        slot = 0;
+    }
+  }
+
+  if (++_phase == _factor)
+    _phase = 0;
+
+  return ready;
+}
+
+static bool sampleAveragingFor(uint8_t factor, SampleAveraging &out) {
+  switch (factor) {
+  case 1:
+    out = NO_AVERAGING;
+    return true;
+  case 2:
+    out = AVG_2;
+    return true;
+  case 4:
+    out = AVG_4;
+    return true;
+  case 8:
+    out = AVG_8;
+    return true;
+  case 16:
+    out = AVG_16;
+    return true;
+  case 32:
+    out = AVG_32;
+    return true;
+  default:
+    return false;
+  }
+}
+
+static bool sampleRateFor(uint16_t hz, SPO2_SampleRate &out) {
+  switch (hz) {
+  case 50:
+    out = SPO2_RATE_50;
+    return true;
+  case 100:
+    out = SPO2_RATE_100;
+    return true;
+  case 200:
+    out = SPO2_RATE_200;
+    return true;
+  case 400:
+    out = SPO2_RATE_400;
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool ppgApplyRateConfig(const PpgRateConfig &config) {
+  SampleAveraging averaging;
+  SPO2_SampleRate rate;
+
+  if (!sampleAveragingFor(config.sensorAveraging, averaging) ||
+      !sampleRateFor(config.sensorRateHz, rate))
+    return false;
+
+  if (config.swDecimation != 1 && config.swDecimation != 2 &&
+      config.swDecimation != 4)
+    return false;
+
+  return setSampleAveraging(averaging) && setSPO2SampleRate(rate);
+}
@@ -0,0 +1,70 @@
+#pragma once
+/*
+ * components/heartbeatSensor/ppg_decimator.h
+ *
+ * Anti-aliased decimation between the MAX30102 sample stream and the
+ * algorithm_by_RF input rate (FS).
+ *
+ * The total rate reduction is split between the sensor (FIFO SMP_AVE, a
+ * boxcar average done on-chip) and software (PpgDecimator, a fixed-point
+ * low-pass FIR evaluated in polyphase form):
+ *
+ *   sensorRateHz / (sensorAveraging * swDecimation) == FS
+ */
+
+#include <cstdint>
+
+// Software decimation factors that have a designed filter.
+constexpr uint8_t PPG_DECIM_MAX_FACTOR = 4;
+constexpr int PPG_DECIM_MAX_TAPS_PER_PHASE = 6;
+
+// Joint sensor + software rate configuration for one PPG channel.
+struct PpgRateConfig {
+  uint16_t sensorRateHz;   // MAX30102 SPO2_SR (50, 100, 200, 400, ...)
+  uint8_t sensorAveraging; // FIFO SMP_AVE factor (1, 2, 4, 8, 16, 32)
+  uint8_t swDecimation;    // PpgDecimator factor (1, 2, 4)
+
+  constexpr uint16_t outputRateHz() const {
+    return static_cast<uint16_t>(sensorRateHz /
+                                 (sensorAveraging * swDecimation));
+  }
+};
+
+// Writes SMP_AVE and SPO2_SR for the given configuration.
+// Returns false when the configuration cannot be expressed by the sensor or
+// has no matching software filter.
+bool ppgApplyRateConfig(const PpgRateConfig &config);
+
+// Fixed-point (Q15) decimating low-pass FIR.
+//
+// Uses the transposed polyphase form: each input sample is multiplied only by
+// the taps of its own phase and accumulated into the pending outputs, so the
+// work per input is taps/factor MACs and no sample history is kept.
+class PpgDecimator {
+public:
+  explicit PpgDecimator(uint8_t factor = PPG_DECIM_MAX_FACTOR);
+
+  // Pushes one raw sample. Returns true and writes `out` when an output
+  // sample (at the decimated rate) is ready.
+  bool push(uint32_t in, uint32_t &out);
+
+  void reset();
+
+  uint8_t factor() const { return _factor; }
+  int taps() const { return _numTaps; }
+
+  // Linear-phase delay of an output relative to the input that completed it.
+  int32_t groupDelayUs(uint16_t inputRateHz) const {
+    return static_cast<int32_t>((_numTaps - 1) * 500000L / inputRateHz);
+  }
+
+private:
+  uint8_t _factor;
+  int _numTaps;
+  int _tapsPerPhase;
+  const int16_t *_coeffs;
+
+  uint8_t _phase;
+  int _head; // accumulator slot of the output being completed
+  int64_t _acc[PPG_DECIM_MAX_TAPS_PER_PHASE];
+};
@@ -0,0 +1,137 @@
+#include "ppg_quality.h"
+#include <cmath>
+
+// 18-bit ADC; samples this close to either rail are treated as clipped.
+constexpr uint32_t PPG_ADC_MAX = 0x3FFFF;
+constexpr uint32_t PPG_CLIP_MARGIN = 256;
+
+static float clamp01(float v) { return fmaxf(0.0f, fminf(1.0f, v)); }
+
+PpgQuality::PpgQuality(const PpgQualityConfig &config) : _config(config) {
+  reset();
+}
+
+void PpgQuality::reset() {
+  _prevDc = 0.0f;
+  _lastPerfusionPct = 0.0f;
+  _lastReject = SQI_EMPTY;
+  _stats = {};
+  _runCycles = 0;
+  resetWindow();
+}
+
+void PpgQuality::discardWindow() {
+  _prevDc = 0.0f;
+  resetWindow();
+}
+
+void PpgQuality::resetWindow() {
+  _rawCount = 0;
+  _clipped = 0;
+  _rawIrSum = 0;
+  _count = 0;
+  _irMin = UINT32_MAX;
+  _irMax = 0;
+  _irSum = 0;
+  _accelMean = 0.0f;
+  _accelM2 = 0.0f;
+}
+
+void PpgQuality::pushRaw(uint32_t ir, uint32_t red) {
+  _rawCount++;
+
+  if (ir >= PPG_ADC_MAX - PPG_CLIP_MARGIN ||
+      red >= PPG_ADC_MAX - PPG_CLIP_MARGIN || ir <= PPG_CLIP_MARGIN ||
+      red <= PPG_CLIP_MARGIN) {
+    _clipped++;
+  }
+  _rawIrSum += ir;
+}
+
+void PpgQuality::push(uint32_t ir, float accelG) {
+  _count++;
+
+  if (ir < _irMin)
+    _irMin = ir;
+  if (ir > _irMax)
+    _irMax = ir;
+  _irSum += ir;
+
+  const float delta = accelG - _accelMean;
+  _accelMean += delta / _count;
+  _accelM2 += delta * (accelG - _accelMean);
+}
+
+uint8_t PpgQuality::endWindow() {
+  _stats.windows++;
+
+  if (_count == 0 || _rawCount == 0) {
+    resetWindow();
+    _lastReject = SQI_EMPTY;
+    return 0;
+  }
+
+  const float rawDc = static_cast<float>(_rawIrSum) / _rawCount;
+  const float cleanDc = static_cast<float>(_irSum) / _count;
+  const float clipFraction = static_cast<float>(_clipped) / _rawCount;
+  const float perfusion =
+      (cleanDc > 0.0f) ? 100.0f * (_irMax - _irMin) / cleanDc : 0.0f;
+  const float drift =
+      (_prevDc > 0.0f) ? 100.0f * fabsf(rawDc - _prevDc) / _prevDc : 0.0f;
+  const float accelStd = sqrtf(_accelM2 / _count);
+
+  _prevDc = rawDc;
+  _lastPerfusionPct = perfusion;
+  resetWindow();
+
+  // Hard gates first: any of these makes the algorithm output meaningless.
+  if (clipFraction > _config.maxClipFraction) {
+    _lastReject = SQI_CLIPPED;
+    return 0;
+  }
+  if (perfusion < _config.minPerfusionPct) {
+    _lastReject = SQI_LOW_PERFUSION;
+    return 0;
+  }
+  if (perfusion > _config.maxPerfusionPct) {
+    _lastReject = SQI_HIGH_PERFUSION;
+    return 0;
+  }
+  if (drift > _config.maxDcDriftPct) {
+    _lastReject = SQI_DC_DRIFT;
+    return 0;
+  }
+  const bool motionGate = _config.maxAccelStdG > 0.0f;
+  if (motionGate && accelStd > _config.maxAccelStdG) {
+    _lastReject = SQI_MOTION;
+    return 0;
+  }
+
+  // Soft score: the weakest criterion decides.
+  const float perfusionQ =
+      clamp01((perfusion - _config.minPerfusionPct) /
+              (_config.goodPerfusionPct - _config.minPerfusionPct));
+  const float driftQ = 1.0f - clamp01(drift / _config.maxDcDriftPct);
+  const float motionQ =
+      motionGate ? 1.0f - clamp01(accelStd / _config.maxAccelStdG) : 1.0f;
+  const float q = fminf(perfusionQ, fminf(driftQ, motionQ));
+
+  const uint8_t score = static_cast<uint8_t>(lroundf(100.0f * q));
+  _lastReject = (score >= _config.passScore) ? SQI_OK : SQI_LOW_SCORE;
+  return score;
+}
+
+void PpgQuality::noteAlgorithmRun(uint32_t cycles) {
+  _stats.algorithmRuns++;
+  _runCycles += cycles;
+  _stats.avgRunCycles =
+      static_cast<uint32_t>(_runCycles / _stats.algorithmRuns);
+  _stats.cyclesSaved =
+      static_cast<uint64_t>(_stats.algorithmSkips) * _stats.avgRunCycles;
+}
+
+void PpgQuality::noteAlgorithmSkipped() {
+  _stats.algorithmSkips++;
+  _stats.cyclesSaved =
+      static_cast<uint64_t>(_stats.algorithmSkips) * _stats.avgRunCycles;
+}
@@ -0,0 +1,110 @@
+#pragma once
+/*
+ * components/heartbeatSensor/ppg_quality.h
+ *
+ * Streaming PPG signal-quality index (SQI).
+ *
+ * Scores each algorithm window from cheap running statistics collected while
+ * the window fills (O(1) per sample), so rf_heart_rate_and_oxygen_saturation
+ * only runs on windows that have a chance of producing a valid result:
+ *   - perfusion index (IR AC/DC) inside a plausible band
+ *   - fraction of samples clipped at the ADC rails
+ *   - DC drift relative to the previous window (finger moving/pressing)
+ *   - accelerometer activity (std-dev of |a| over the window)
+ *
+ * Clipping and DC level are properties of the ADC reading, so they are taken
+ * from the raw FIFO samples (pushRaw). Perfusion and motion are scored on the
+ * filtered, motion-cancelled samples the algorithm will see (push).
+ */
+
+#include <cstdint>
+
+struct PpgQualityConfig {
+  float minPerfusionPct;  // below: no pulsatile signal (no finger / too dim)
+  float goodPerfusionPct; // at or above: full marks for perfusion
+  float maxPerfusionPct;  // above: swing dominated by motion
+  float maxClipFraction;  // fraction of samples at the ADC rails
+  float maxDcDriftPct;    // window-to-window DC change
+  float maxAccelStdG;     // accelerometer activity gate, 0 = off
+  uint8_t passScore;      // 0..100, windows below this are skipped
+};
+
+constexpr PpgQualityConfig PPG_QUALITY_DEFAULTS = {
+    0.1f, 0.5f, 10.0f, 0.02f, 5.0f, 0.25f, 50,
+};
+
+// Why the last window was rejected (0 = accepted).
+enum PpgQualityReject : uint8_t {
+  SQI_OK = 0,
+  SQI_EMPTY,
+  SQI_CLIPPED,
+  SQI_LOW_PERFUSION,
+  SQI_HIGH_PERFUSION,
+  SQI_DC_DRIFT,
+  SQI_MOTION,
+  SQI_LOW_SCORE,
+};
+
+struct PpgQualityStats {
+  uint32_t windows;        // windows scored
+  uint32_t algorithmRuns;  // windows passed to the HR/SpO2 algorithm
+  uint32_t algorithmSkips; // algorithm invocations avoided
+  uint32_t avgRunCycles;   // measured cost of one algorithm run
+  uint64_t cyclesSaved;    // algorithmSkips * avgRunCycles
+};
+
+class PpgQuality {
+public:
+  explicit PpgQuality(const PpgQualityConfig &config = PPG_QUALITY_DEFAULTS);
+
+  // Adds one raw FIFO sample (before decimation) to the current window.
+  void pushRaw(uint32_t ir, uint32_t red);
+
+  // Adds one cleaned algorithm sample of the current window. accelG is the
+  // accelerometer magnitude (or a single axis) in g, sampled at the same
+  // instant.
+  void push(uint32_t ir, float accelG);
+
+  // Closes the current window and returns its score (0..100).
+  uint8_t endWindow();
+
+  bool passed() const { return _lastReject == SQI_OK; }
+  PpgQualityReject lastReject() const { return _lastReject; }
+  float lastPerfusionPct() const { return _lastPerfusionPct; }
+
+  // Bookkeeping for the gate itself; call exactly one per closed window.
+  void noteAlgorithmRun(uint32_t cycles);
+  void noteAlgorithmSkipped();
+
+  const PpgQualityStats &stats() const { return _stats; }
+  void reset();
+
+  // Drops the partially filled window (e.g. after a sampling gap) without
+  // scoring it or touching the counters.
+  void discardWindow();
+
+private:
+  PpgQualityConfig _config;
+
+  // Running window statistics, raw samples
+  uint32_t _rawCount;
+  uint32_t _clipped;
+  uint64_t _rawIrSum;
+
+  // Cleaned samples
+  uint32_t _count;
+  uint32_t _irMin;
+  uint32_t _irMax;
+  uint64_t _irSum;
+  float _accelMean; // Welford
+  float _accelM2;
+
+  float _prevDc;
+  float _lastPerfusionPct;
+  PpgQualityReject _lastReject;
+
+  PpgQualityStats _stats;
+  uint64_t _runCycles;
+
+  void resetWindow();
+};
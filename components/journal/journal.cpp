@@ -0,0 +1,411 @@
+#include "journal.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "mutex.h"
+#include <cinttypes>
+#include <cstring>
+
+static const char *TAG = "JOURNAL";
+
+constexpr uint32_t JOURNAL_SECTOR_SIZE = 4096;
+constexpr uint8_t JOURNAL_MAGIC = 0xA5;
+constexpr uint8_t JOURNAL_ERASED = 0xFF;
+constexpr UBaseType_t JOURNAL_QUEUE_LEN = 32;
+
+struct __attribute__((packed)) FlashHeader {
+  uint8_t magic;
+  uint8_t type;
+  uint8_t len;
+  uint8_t reserved;
+  uint32_t seq;
+  uint32_t crc;
+};
+constexpr uint32_t FLASH_HEADER_SIZE = sizeof(FlashHeader);
+static_assert(FLASH_HEADER_SIZE == 12, "journal flash header must be 12 bytes");
+
+static uint32_t recordCrc(uint8_t type, uint8_t len, uint32_t seq,
+                          const uint8_t *payload) {
+  const uint8_t head[2] = {type, len};
+  uint32_t crc = esp_rom_crc32_le(0, head, sizeof(head));
+  crc = esp_rom_crc32_le(crc, reinterpret_cast<const uint8_t *>(&seq),
+                         sizeof(seq));
+  return esp_rom_crc32_le(crc, payload, len);
+}
+
+Journal &Journal::getInstance() {
+  static Journal instance;
+  return instance;
+}
+
+Journal::Journal()
+    : _partition(nullptr), _initialized(false), _queue(nullptr),
+      _mutex(nullptr), _sectors(0), _sectorFirstSeq(nullptr), _writeSector(0),
+      _writeOffset(0), _nextSeq(1), _committedSeq(1), _stats{}, _readSeq(0),
+      _readSector(0), _readOffset(0), _staging{}, _stagingLen(0),
+      _stagingSeqEnd(0), _stagingRecords(0), _stagingPayload(0),
+      _stagingSince(0) {}
+
+bool Journal::init() {
+  if (_initialized) {
+    ESP_LOGW(TAG, "Journal already initialized");
+    return true;
+  }
+
+  _partition = esp_partition_find_first(
+      ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "journal");
+  if (!_partition) {
+    ESP_LOGE(TAG, "No 'journal' partition; check partitions.csv");
+    return false;
+  }
+
+  _sectors = _partition->size / JOURNAL_SECTOR_SIZE;
+  if (_sectors < 2) {
+    ESP_LOGE(TAG, "Journal partition too small (%" PRIu32 " bytes)",
+             _partition->size);
+    return false;
+  }
+
+  _mutex = xSemaphoreCreateMutex();
+  _queue = xQueueCreate(JOURNAL_QUEUE_LEN, sizeof(Pending));
+  _sectorFirstSeq = new uint32_t[_sectors]();
+  configASSERT(_mutex != nullptr && _queue != nullptr);
+
+  const int64_t startUs = esp_timer_get_time();
+  recover();
+  _initialized = true;
+
+  uint32_t oldest, next;
+  range(oldest, next);
+  ESP_LOGI(TAG,
+           "Journal ready: %" PRIu32 " sectors, records %" PRIu32
+           "..%" PRIu32 ", write at %" PRIu32 ":%" PRIu32 " (%" PRId64
+           " ms)",
+           _sectors, oldest, next, _writeSector, _writeOffset,
+           (esp_timer_get_time() - startUs) / 1000);
+  return true;
+}
+
+// Walks a sector's records. Returns the end of valid data; a sector with a
+// torn or corrupt record is reported as full so nothing is appended after it.
+uint32_t Journal::scanSector(uint32_t sector, uint32_t &lastSeq) {
+  const uint32_t base = sector * JOURNAL_SECTOR_SIZE;
+  uint32_t offset = 0;
+  uint8_t payload[JOURNAL_MAX_PAYLOAD];
+
+  _sectorFirstSeq[sector] = 0;
+  while (offset + FLASH_HEADER_SIZE <= JOURNAL_SECTOR_SIZE) {
+    FlashHeader h;
+    if (esp_partition_read(_partition, base + offset, &h, sizeof(h)) != ESP_OK)
+      return JOURNAL_SECTOR_SIZE;
+    if (h.magic == JOURNAL_ERASED && h.seq == UINT32_MAX)
+      return offset;
+    if (h.magic != JOURNAL_MAGIC || h.len > JOURNAL_MAX_PAYLOAD ||
+        offset + FLASH_HEADER_SIZE + h.len > JOURNAL_SECTOR_SIZE)
+      return JOURNAL_SECTOR_SIZE;
+    if (esp_partition_read(_partition, base + offset + FLASH_HEADER_SIZE,
+                           payload, h.len) != ESP_OK ||
+        recordCrc(h.type, h.len, h.seq, payload) != h.crc)
+      return JOURNAL_SECTOR_SIZE;
+
+    if (_sectorFirstSeq[sector] == 0)
+      _sectorFirstSeq[sector] = h.seq;
+    lastSeq = h.seq;
+    offset += FLASH_HEADER_SIZE + h.len;
+  }
+  return offset;
+}
+
+void Journal::recover() {
+  uint32_t newestFirst = 0;
+  uint32_t newestSeq = 0;
+  uint32_t newestEnd = 0;
+
+  for (uint32_t s = 0; s < _sectors; s++) {
+    uint32_t lastSeq = 0;
+    const uint32_t end = scanSector(s, lastSeq);
+    if (_sectorFirstSeq[s] > newestFirst) {
+      newestFirst = _sectorFirstSeq[s];
+      newestSeq = lastSeq;
+      newestEnd = end;
+      _writeSector = s;
+    }
+  }
+
+  if (newestFirst == 0) {
+    // Empty (or unformatted) partition
+    openSector(0);
+    return;
+  }
+
+  _writeOffset = newestEnd;
+  _nextSeq = newestSeq + 1;
+  _committedSeq = _nextSeq;
+}
+
+// Erases a sector and makes it the write sector.
+bool Journal::openSector(uint32_t sector) {
+  {
+    MutexGuard lock(_mutex);
+    _sectorFirstSeq[sector] = 0;
+    if (_readSector == sector)
+      _readSeq = 0; // cached position points at data being erased
+    _writeSector = sector;
+    _writeOffset = 0; // readers stop here until something is committed
+  }
+
+  const esp_err_t err = esp_partition_erase_range(
+      _partition, sector * JOURNAL_SECTOR_SIZE, JOURNAL_SECTOR_SIZE);
+
+  MutexGuard lock(_mutex);
+  _stats.sectorErases++;
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Erase of sector %" PRIu32 " failed: %s", sector,
+             esp_err_to_name(err));
+    _writeOffset = JOURNAL_SECTOR_SIZE; // skip it on the next append
+    return false;
+  }
+  return true;
+}
+
+void Journal::stage(const Pending &rec) {
+  const size_t size = FLASH_HEADER_SIZE + rec.len;
+
+  // Records never span sectors
+  if (_writeOffset + _stagingLen + size > JOURNAL_SECTOR_SIZE) {
+    commitStaging();
+    if (!openSector((_writeSector + 1) % _sectors)) {
+      MutexGuard lock(_mutex);
+      _stats.dropped++;
+      return;
+    }
+  }
+  if (_stagingLen + size > JOURNAL_STAGING_SIZE)
+    commitStaging();
+
+  FlashHeader h;
+  h.magic = JOURNAL_MAGIC;
+  h.type = rec.type;
+  h.len = rec.len;
+  h.reserved = 0;
+  h.seq = rec.seq;
+  h.crc = recordCrc(rec.type, rec.len, rec.seq, rec.payload);
+
+  if (_stagingLen == 0)
+    _stagingSince = xTaskGetTickCount();
+  memcpy(_staging + _stagingLen, &h, sizeof(h));
+  memcpy(_staging + _stagingLen + sizeof(h), rec.payload, rec.len);
+  _stagingLen += size;
+  _stagingSeqEnd = rec.seq + 1;
+  _stagingRecords++;
+  _stagingPayload += rec.len;
+}
+
+void Journal::commitStaging() {
+  if (_stagingLen == 0)
+    return;
+
+  // Programming happens past the committed end, so readers are not blocked
+  const uint32_t addr = _writeSector * JOURNAL_SECTOR_SIZE + _writeOffset;
+  const esp_err_t err = esp_partition_write(_partition, addr, _staging,
+                                            _stagingLen);
+
+  MutexGuard lock(_mutex);
+  if (err == ESP_OK) {
+    if (_writeOffset == 0) {
+      FlashHeader first;
+      memcpy(&first, _staging, sizeof(first));
+      _sectorFirstSeq[_writeSector] = first.seq;
+    }
+    _writeOffset += _stagingLen;
+    _stats.records += _stagingRecords;
+    _stats.payloadBytes += _stagingPayload;
+  } else {
+    // Unknown how much was programmed; never append to this sector again
+    ESP_LOGE(TAG, "Write at 0x%08" PRIx32 " failed: %s", addr,
+             esp_err_to_name(err));
+    _writeOffset = JOURNAL_SECTOR_SIZE;
+    _stats.dropped += _stagingRecords;
+  }
+  _stats.flashBytes += _stagingLen;
+  _stats.flashWrites++;
+  _committedSeq = _stagingSeqEnd;
+
+  _stagingLen = 0;
+  _stagingRecords = 0;
+  _stagingPayload = 0;
+}
+
+bool Journal::append(JournalRecordType type, const void *payload,
+                     uint8_t len) {
+  if (!_initialized || len > JOURNAL_MAX_PAYLOAD)
+    return false;
+
+  Pending rec;
+  rec.type = type;
+  rec.len = len;
+  memcpy(rec.payload, payload, len);
+
+  // Sequence numbers are handed out in queue order
+  MutexGuard lock(_mutex);
+  rec.seq = _nextSeq;
+  if (xQueueSend(_queue, &rec, 0) != pdTRUE) {
+    _stats.dropped++;
+    return false;
+  }
+  _nextSeq++;
+  return true;
+}
+
+void Journal::requestFlush() {
+  if (!_initialized)
+    return;
+  Pending rec = {};
+  xQueueSend(_queue, &rec, 0); // a full queue means the writer is busy anyway
+}
+
+// Finds where to start reading for cursor: the newest sector whose first
+// record is at or before it, or the oldest sector if cursor was overwritten.
+bool Journal::locate(uint32_t cursor, uint32_t &sector, uint32_t &offset) {
+  bool found = false;
+  uint32_t best = 0, oldest = 0;
+  uint32_t bestSector = 0, oldestSector = 0;
+
+  for (uint32_t s = 0; s < _sectors; s++) {
+    const uint32_t first = _sectorFirstSeq[s];
+    if (first == 0)
+      continue;
+    if (first <= cursor && first >= best) {
+      best = first;
+      bestSector = s;
+      found = true;
+    }
+    if (oldest == 0 || first < oldest) {
+      oldest = first;
+      oldestSector = s;
+    }
+  }
+  if (oldest == 0)
+    return false;
+
+  sector = found ? bestSector : oldestSector;
+  offset = 0;
+  return true;
+}
+
+size_t Journal::read(uint32_t &cursor, uint8_t *buf, size_t cap) {
+  if (!_initialized)
+    return 0;
+
+  MutexGuard lock(_mutex);
+  if (cursor >= _committedSeq)
+    return 0;
+
+  uint32_t sector = _readSector, offset = _readOffset;
+  if (_readSeq == 0 || cursor != _readSeq) {
+    if (!locate(cursor, sector, offset))
+      return 0;
+  }
+
+  size_t out = 0;
+  uint32_t visited = 0;
+  while (visited <= _sectors) {
+    const uint32_t end =
+        (sector == _writeSector) ? _writeOffset : JOURNAL_SECTOR_SIZE;
+    FlashHeader h;
+    bool next = offset + FLASH_HEADER_SIZE > end;
+    if (!next) {
+      const uint32_t addr = sector * JOURNAL_SECTOR_SIZE + offset;
+      next = esp_partition_read(_partition, addr, &h, sizeof(h)) != ESP_OK ||
+             h.magic != JOURNAL_MAGIC || h.len > JOURNAL_MAX_PAYLOAD;
+    }
+    if (next) {
+      if (sector == _writeSector)
+        break; // caught up with the writer
+      sector = (sector + 1) % _sectors;
+      offset = 0;
+      visited++;
+      continue;
+    }
+
+    const uint32_t size = FLASH_HEADER_SIZE + h.len;
+    if (h.seq >= cursor) {
+      if (out + JOURNAL_WIRE_HEADER_SIZE + h.len > cap)
+        break;
+
+      uint8_t *rec = buf + out;
+      uint8_t *payload = rec + JOURNAL_WIRE_HEADER_SIZE;
+      const uint32_t addr =
+          sector * JOURNAL_SECTOR_SIZE + offset + FLASH_HEADER_SIZE;
+      if (esp_partition_read(_partition, addr, payload, h.len) == ESP_OK &&
+          recordCrc(h.type, h.len, h.seq, payload) == h.crc) {
+        memcpy(rec, &h.seq, sizeof(h.seq));
+        rec[4] = h.type;
+        rec[5] = h.len;
+        out += JOURNAL_WIRE_HEADER_SIZE + h.len;
+        cursor = h.seq + 1;
+      } else {
+        ESP_LOGW(TAG, "Skipping corrupt record %" PRIu32, h.seq);
+      }
+    }
+    offset += size;
+  }
+
+  _readSeq = cursor;
+  _readSector = sector;
+  _readOffset = offset;
+  return out;
+}
+
+void Journal::range(uint32_t &oldest, uint32_t &next) {
+  MutexGuard lock(_mutex);
+  oldest = 0;
+  for (uint32_t s = 0; s < _sectors; s++) {
+    const uint32_t first = _sectorFirstSeq[s];
+    if (first != 0 && (oldest == 0 || first < oldest))
+      oldest = first;
+  }
+  next = _committedSeq;
+  if (oldest == 0)
+    oldest = next;
+}
+
+JournalStats Journal::stats() {
+  MutexGuard lock(_mutex);
+  return _stats;
+}
+
+void Journal::taskEntry(void *param) {
+  static_cast<Journal *>(param)->taskLoop();
+}
+
+void Journal::startTask() {
+  if (!_initialized)
+    return;
+  // Lowest priority: flash erases may take tens of ms and nothing waits on
+  // the journal
+  xTaskCreate(taskEntry, "journal", 3072, this, 1, nullptr);
+}
+
+void Journal::taskLoop() {
+  const TickType_t flushTicks = pdMS_TO_TICKS(JOURNAL_FLUSH_MS);
+
+  while (true) {
+    TickType_t wait = portMAX_DELAY;
+    if (_stagingLen > 0) {
+      const TickType_t age = xTaskGetTickCount() - _stagingSince;
+      wait = (age >= flushTicks) ? 0 : flushTicks - age;
+    }
+
+    Pending rec;
+    if (xQueueReceive(_queue, &rec, wait) != pdTRUE) {
+      commitStaging(); // flush deadline
+      continue;
+    }
+
+    if (rec.type == 0)
+      commitStaging();
+    else
+      stage(rec);
+  }
+}
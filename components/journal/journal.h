@@ -0,0 +1,150 @@
+#pragma once
+/*
+ * components/journal/journal.h
+ *
+ * Append-only workout journal in the "journal" flash partition.
+ *
+ * The partition is used as a ring of 4 KB sectors. Each record is framed as
+ *
+ *   u8  magic (0xA5)   u8 type   u8 len   u8 reserved
+ *   u32 seq            u32 crc32 (type, len, seq, payload)
+ *   payload[len]
+ *
+ * and never spans a sector. Erased flash (0xFF) ends a sector. When the ring
+ * is full the oldest sector is erased and its records are gone.
+ *
+ * append() only queues the record; a low-priority writer task gathers
+ * records in a page-sized staging buffer and programs flash in one write per
+ * page (or after JOURNAL_FLUSH_MS), which keeps small records from turning
+ * into many small flash writes.
+ *
+ * Every record gets a sequence number that doubles as a sync cursor: read()
+ * returns records with seq >= cursor in the wire format
+ *
+ *   u32 seq   u8 type   u8 len   payload[len]
+ */
+
+#include "esp_partition.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include <cstddef>
+#include <cstdint>
+
+constexpr uint8_t JOURNAL_MAX_PAYLOAD = 32;
+constexpr uint32_t JOURNAL_FLUSH_MS = 5000;   // longest a record stays in RAM
+constexpr size_t JOURNAL_STAGING_SIZE = 256;  // one flash page
+constexpr size_t JOURNAL_WIRE_HEADER_SIZE = 6; // seq + type + len
+
+enum JournalRecordType : uint8_t {
+  JOURNAL_SESSION_START = 1, // JournalSession
+  JOURNAL_SESSION_END = 2,   // JournalSession
+  JOURNAL_SAMPLE = 3,        // JournalSample
+  JOURNAL_JUMP_EVENT = 4,    // JumpEvent (main/jump_events.h)
+};
+
+struct __attribute__((packed)) JournalSession {
+  uint32_t timestampMs; // device uptime
+  uint32_t sessionId;
+  uint32_t jumpCount;
+};
+
+struct __attribute__((packed)) JournalSample {
+  uint32_t timestampMs; // device uptime
+  uint32_t jumpCount;   // session-relative
+  uint8_t heartRate;    // 0 => invalid
+  uint8_t spo2;         // 0 => invalid
+  uint16_t flags;       // JR_TM_F_* bits of the live record
+};
+
+struct JournalStats {
+  uint32_t records;          // records committed to flash
+  uint32_t dropped;          // records lost to a full queue
+  uint64_t payloadBytes;     // record payloads committed
+  uint64_t flashBytes;       // bytes programmed (headers included)
+  uint32_t flashWrites;      // program operations
+  uint32_t sectorErases;
+
+  // Flash bytes programmed per payload byte
+  float writeAmplification() const {
+    return payloadBytes ? (float)flashBytes / payloadBytes : 0.0f;
+  }
+};
+
+class Journal {
+public:
+  static Journal &getInstance();
+
+  // Finds the partition and rebuilds the write position and sequence
+  // counter from flash. Returns false when the partition is missing.
+  bool init();
+  void startTask();
+
+  bool isInitialized() const { return _initialized; }
+
+  // Queues one record. Non-blocking; returns false when the queue is full or
+  // the journal is not initialized.
+  bool append(JournalRecordType type, const void *payload, uint8_t len);
+
+  // Asks the writer to commit staged records now.
+  void requestFlush();
+
+  // Copies whole records with seq >= cursor into buf (wire format) and
+  // advances cursor past the last one copied. Returns bytes written; 0 when
+  // there is nothing committed at or after cursor.
+  size_t read(uint32_t &cursor, uint8_t *buf, size_t cap);
+
+  // Range of committed records: [oldest, next).
+  void range(uint32_t &oldest, uint32_t &next);
+
+  JournalStats stats();
+
+  Journal(const Journal &) = delete;
+  Journal &operator=(const Journal &) = delete;
+
+private:
+  Journal();
+
+  struct Pending {
+    uint8_t type; // 0 => flush request
+    uint8_t len;
+    uint32_t seq;
+    uint8_t payload[JOURNAL_MAX_PAYLOAD];
+  };
+
+  const esp_partition_t *_partition;
+  bool _initialized;
+  QueueHandle_t _queue;
+  SemaphoreHandle_t _mutex; // guards everything below
+
+  uint32_t _sectors;
+  uint32_t *_sectorFirstSeq; // per sector, 0 = empty
+  uint32_t _writeSector;
+  uint32_t _writeOffset;     // committed end within _writeSector
+  uint32_t _nextSeq;         // next seq handed out by append()
+  uint32_t _committedSeq;    // seq after the last committed record
+  JournalStats _stats;
+
+  // Sequential read position cached between read() calls
+  uint32_t _readSeq;
+  uint32_t _readSector;
+  uint32_t _readOffset;
+
+  // Writer task only
+  uint8_t _staging[JOURNAL_STAGING_SIZE];
+  size_t _stagingLen;
+  uint32_t _stagingSeqEnd;
+  uint32_t _stagingRecords;
+  uint32_t _stagingPayload;
+  TickType_t _stagingSince;
+
+  void recover();
+  uint32_t scanSector(uint32_t sector, uint32_t &lastSeq);
+  bool openSector(uint32_t sector);
+  void stage(const Pending &rec);
+  void commitStaging();
+  bool locate(uint32_t cursor, uint32_t &sector, uint32_t &offset);
+
+  void taskLoop();
+  static void taskEntry(void *param);
+};
@@ -7,11 +7,14 @@
 #include <initializer_list>
 
 // ===== Timing + Filtering Controls =====
-constexpr int TIMING_TOLERANCE_MS = 40;
-constexpr int MAX_PHASE_DURATION_MS = 800;
+// Tolerances, thresholds and the poll rate are runtime parameters (JR_PARAMS
+// in jr_params.h), handed over through setTuning().
+// Filter weights per FILTER_PERIOD_MS; update() rescales them to the actual
+// poll interval so the time constants do not depend on the rate
 constexpr float FILTER_ALPHA_FAST = 0.4f;
 constexpr float FILTER_ALPHA_SLOW = 0.15f;
-constexpr int CALIBRATION_JUMPS = 5;
+constexpr uint32_t FILTER_PERIOD_MS = 10;
+constexpr uint32_t MAX_FILTER_STEP_MS = 100; // longer gaps (stalls) clamp
 
 // Peak detection hysteresis
 constexpr float PEAK_DROP_THRESHOLD = 0.85f; // 15% drop confirms peak
@@ -20,12 +23,32 @@ constexpr float MIN_PEAK_VALUE = 30.0f;      // Minimum value to consider
 // Adaptive threshold bounds
 constexpr float MIN_THRESHOLD = 40.0f;
 constexpr float MAX_THRESHOLD = 800.0f;
-constexpr float INITIAL_THRESHOLD = 100.0f;
-constexpr float JUMP_THRESHOLD_FACTOR = 1.3f;
-constexpr int MIN_JUMP_INTERVAL_MS = 300;
-constexpr int JUMP_UPDATE_HZ = 100;
-constexpr int DISPLAY_UPDATE_HZ = 4;
-constexpr int CALIBRATION_TIME_MS = 3000;
+constexpr float INITIAL_THRESHOLD = 100.0f; // amplitude before any jump
+
+// Streaming statistics behind the thresholds: range and half-life (in
+// candidates of the counted timing config, one per jump)
+constexpr float AMPLITUDE_LO = 10.0f;
+constexpr float AMPLITUDE_HI = 2000.0f;
+constexpr float INTERVAL_LO_MS = 100.0f;
+constexpr float INTERVAL_HI_MS = 4000.0f;
+constexpr float STATS_HALF_LIFE = 10.0f;
+// Samples (jumps) before the statistics count as settled
+constexpr float SETTLED_SAMPLES = 3.0f;
+// Candidates that could pass the lowest threshold are sampled. The floor is
+// absolute: a gate relative to the threshold would cut off the low tail and
+// ratchet the median upward.
+constexpr float SAMPLE_FLOOR = MIN_THRESHOLD;
+// Rejections are logged as near misses above this fraction of the threshold
+// (logging only, the statistics do not see it)
+constexpr float NEAR_MISS_FRACTION = 0.65f;
+// Longer gaps are pauses, not the user's rhythm
+constexpr uint32_t MAX_SAMPLED_INTERVAL_MS = 2000;
+// A second jump sooner than this fraction of the median interval is a
+// double bounce
+constexpr float INTERVAL_GUARD = 0.6f;
+// Rise times this many tolerances off the expected one are logged as near
+// misses; further off they are just noise
+constexpr uint32_t NEAR_MISS_TOLERANCES = 2;
 
 // Timing configurations: {rise, fall} - 4 configs
 static const struct {
@@ -38,11 +61,15 @@ static const struct {
     {210, 210}  // Very slow
 };
 
-JumpDetector::JumpDetector(SensorReading *sensor,
-                           float thresholdFactor, uint32_t minIntervalMs)
-    : _sensor(sensor), _thresholdFactor(thresholdFactor),
-      _minIntervalMs(minIntervalMs), _avgJump(INITIAL_THRESHOLD),
-      _calibrationComplete(false), _calibrationJumps(0) {
+JumpDetector::JumpDetector(SensorReading *sensor)
+    : _sensor(sensor), _thresholdFactor(0.0f), _minIntervalMs(0),
+      _timingToleranceMs(0), _maxPhaseMs(0), _lastUpdateMs(0),
+      _filterStepMs(0), _alphaFast(FILTER_ALPHA_FAST),
+      _alphaSlow(FILTER_ALPHA_SLOW),
+      _amplitudes(AMPLITUDE_LO, AMPLITUDE_HI, STATS_HALF_LIFE),
+      _intervals(INTERVAL_LO_MS, INTERVAL_HI_MS, STATS_HALF_LIFE),
+      _lastSampleMs(0), _phaseSumMs(0), _phaseSamples(0), _countedConfig(0),
+      _events(nullptr) {
 
   // Initialize axis names
   
@@ -78,6 +105,16 @@ void JumpDetector::update() {
     return;
 
   uint32_t now = getMillis();
+  uint32_t step = _lastUpdateMs ? now - _lastUpdateMs : FILTER_PERIOD_MS;
+  step = step < 1 ? 1 : (step > MAX_FILTER_STEP_MS ? MAX_FILTER_STEP_MS : step);
+  _lastUpdateMs = now;
+  if (step != _filterStepMs) {
+    // Same decay per millisecond as FILTER_ALPHA_* per FILTER_PERIOD_MS
+    const float periods = static_cast<float>(step) / FILTER_PERIOD_MS;
+    _alphaFast = 1.0f - powf(1.0f - FILTER_ALPHA_FAST, periods);
+    _alphaSlow = 1.0f - powf(1.0f - FILTER_ALPHA_SLOW, periods);
+    _filterStepMs = step;
+  }
   updateAxis(_axisZ, (float)az, now);
 }
 
@@ -90,10 +127,10 @@ void JumpDetector::updateAxis(AxisDetector &axis, float value, uint32_t now) {
 
 void JumpDetector::updateConfig(JumpConfig &config, float value, uint32_t now) {
   // Two-stage filtering
-  config.filteredFast = FILTER_ALPHA_FAST * value +
-                        (1.0f - FILTER_ALPHA_FAST) * config.filteredFast;
-  config.filteredSlow = FILTER_ALPHA_SLOW * value +
-                        (1.0f - FILTER_ALPHA_SLOW) * config.filteredSlow;
+  config.filteredFast =
+      _alphaFast * value + (1.0f - _alphaFast) * config.filteredFast;
+  config.filteredSlow =
+      _alphaSlow * value + (1.0f - _alphaSlow) * config.filteredSlow;
 
   float filteredValue = config.filteredFast;
 
@@ -120,19 +157,30 @@ void JumpDetector::updateConfig(JumpConfig &config, float value, uint32_t now) {
       uint32_t riseDuration = now - config.risingStartTime;
 
       // Validate rise timing
-      if (riseDuration >= config.minRiseDuration - TIMING_TOLERANCE_MS &&
-          riseDuration <= config.minRiseDuration + TIMING_TOLERANCE_MS) {
+      if (riseDuration >= config.minRiseDuration - _timingToleranceMs &&
+          riseDuration <= config.minRiseDuration + _timingToleranceMs) {
         config.state = STATE_FALLING;
         config.fallingStartTime = now;
         config.valley = filteredValue;
       } else {
-        // Invalid timing, reset
+        // Invalid timing, reset. Logged as a near miss when the peak
+        // stands out from the baseline like a jump would
+        const uint32_t offBy = riseDuration > config.minRiseDuration
+                                   ? riseDuration - config.minRiseDuration
+                                   : config.minRiseDuration - riseDuration;
+        const float threshold = amplitudeThreshold();
+        const float height = config.peak - config.filteredSlow;
+        if (offBy <= NEAR_MISS_TOLERANCES * _timingToleranceMs &&
+            height > threshold * NEAR_MISS_FRACTION) {
+          logEvent(config, JUMP_EVENT_RISE_TIMING, now, riseDuration, 0,
+                   filteredValue, threshold, minJumpInterval());
+        }
         config.state = STATE_IDLE;
       }
     }
 
     // Timeout guard
-    if (now - config.risingStartTime > MAX_PHASE_DURATION_MS) {
+    if (now - config.risingStartTime > _maxPhaseMs) {
       config.state = STATE_IDLE;
     }
     break;
@@ -146,43 +194,55 @@ void JumpDetector::updateConfig(JumpConfig &config, float value, uint32_t now) {
     uint32_t fallDuration = now - config.fallingStartTime;
 
     // Check fall timing and complete jump
-    if (fallDuration >= config.minFallDuration - TIMING_TOLERANCE_MS &&
-        fallDuration <= config.minFallDuration + TIMING_TOLERANCE_MS) {
+    if (fallDuration >= config.minFallDuration - _timingToleranceMs &&
+        fallDuration <= config.minFallDuration + _timingToleranceMs) {
 
       float diff = fabs(config.peak - config.valley);
-
-      // Use calibration mode threshold or normal threshold
-      float currentThreshold = _avgJump * _thresholdFactor;
-      if (!_calibrationComplete) {
-        currentThreshold *= 0.7f; // More lenient during calibration
+      const float threshold = amplitudeThreshold();
+      const uint32_t interval = now - config.lastJumpTime;
+
+      // Candidates of the counted config feed the statistics even when
+      // rejected, so the thresholds follow a user who jumps softer or faster.
+      // The other configs see the same jumps and would count them again.
+      // Intervals run from the previous sampled candidate: a jump rejected
+      // as too soon must not double the next one.
+      if (&config == &_axisZ.configs[_countedConfig] && diff > SAMPLE_FLOOR) {
+        _amplitudes.add(diff);
+        const uint32_t sampled = now - _lastSampleMs;
+        if (_lastSampleMs != 0 && sampled <= MAX_SAMPLED_INTERVAL_MS) {
+          _intervals.add(static_cast<float>(sampled));
+        }
+        _lastSampleMs = now;
       }
 
       // Validate jump and enforce minimum interval
-      if (diff > currentThreshold &&
-          now - config.lastJumpTime > _minIntervalMs) {
+      const uint32_t minInterval = minJumpInterval();
+      const uint32_t riseDuration =
+          config.fallingStartTime - config.risingStartTime;
+      if (diff <= threshold) {
+        if (diff > threshold * NEAR_MISS_FRACTION) {
+          logEvent(config, JUMP_EVENT_LOW_AMPLITUDE, now, riseDuration,
+                   fallDuration, config.valley, threshold, minInterval);
+        }
+      } else if (interval <= minInterval) {
+        logEvent(config, JUMP_EVENT_TOO_SOON, now, riseDuration, fallDuration,
+                 config.valley, threshold, minInterval);
+      } else {
+        logEvent(config, JUMP_EVENT_ACCEPTED, now, riseDuration, fallDuration,
+                 config.valley, threshold, minInterval);
 
         // Register jump
         config.jumpCount++;
         config.lastJumpTime = now;
-
-        // Update adaptive threshold with bounds
-        _avgJump = 0.92f * _avgJump + 0.08f * diff;
-        _avgJump = fmaxf(MIN_THRESHOLD, fminf(MAX_THRESHOLD, _avgJump));
-
-        // Track calibration
-        if (!_calibrationComplete) {
-          _calibrationJumps++;
-          if (_calibrationJumps >= CALIBRATION_JUMPS) {
-            _calibrationComplete = true;
-                      }
-        }
+        _phaseSumMs += now - config.risingStartTime;
+        _phaseSamples++;
       }
 
       config.state = STATE_IDLE;
     }
 
     // Timeout guard
-    if (fallDuration > MAX_PHASE_DURATION_MS) {
+    if (fallDuration > _maxPhaseMs) {
       config.state = STATE_IDLE;
     }
     break;
@@ -191,6 +251,39 @@ void JumpDetector::updateConfig(JumpConfig &config, float value, uint32_t now) {
   config.lastValue = filteredValue;
 }
 
+// Features are clamped into the 16-bit fields of the record
+static uint16_t clampU16(uint32_t value) {
+  return value > UINT16_MAX ? UINT16_MAX : static_cast<uint16_t>(value);
+}
+
+static int16_t clampI16(float value) {
+  return static_cast<int16_t>(fmaxf(INT16_MIN, fminf(INT16_MAX, value)));
+}
+
+void JumpDetector::logEvent(JumpConfig &config, JumpEventReason reason,
+                            uint32_t now, uint32_t riseMs, uint32_t fallMs,
+                            float valley, float threshold,
+                            uint32_t minInterval) {
+  if (!_events) {
+    return;
+  }
+  JumpEvent event;
+  event.timestampMs = now;
+  event.config = static_cast<uint8_t>(getConfigIndex(&config));
+  event.reason = reason;
+  event.riseMs = clampU16(riseMs);
+  event.fallMs = clampU16(fallMs);
+  event.intervalMs = config.lastJumpTime == 0
+                         ? UINT16_MAX
+                         : clampU16(now - config.lastJumpTime);
+  event.peak = clampI16(config.peak);
+  event.valley = clampI16(valley);
+  event.diff = clampU16(static_cast<uint32_t>(fabsf(config.peak - valley)));
+  event.threshold = clampU16(static_cast<uint32_t>(threshold));
+  event.minIntervalMs = clampU16(minInterval);
+  _events->push(event);
+}
+
 int JumpDetector::getConfigIndex(JumpConfig *config) {
   for (AxisDetector *axis : {&_axisZ}) {
     for (int i = 0; i < NUM_TIMING_CONFIGS; i++) {
@@ -223,40 +316,18 @@ uint32_t JumpDetector::getAxisTotal(const AxisDetector &axis) const
   return axis.configs[2].jumpCount;
 }
 
-float JumpDetector::getAxisRate(const AxisDetector &axis) const {
-  uint32_t maxJumps = 0;
-  uint32_t lastJumpTime = 0;
-
-  for (int i = 0; i < NUM_TIMING_CONFIGS; i++) {
-    if (axis.configs[i].jumpCount > maxJumps) {
-      maxJumps = axis.configs[i].jumpCount;
-      lastJumpTime = axis.configs[i].lastJumpTime;
-    }
-  }
-
-  if (maxJumps < 2 || lastJumpTime == 0)
-    return 0.0f;
-
-  // Return jumps per minute
-  float timeMinutes = lastJumpTime / 60000.0f;
-  return maxJumps / timeMinutes;
-}
-
 void JumpDetector::getTotalJumps(
                                  uint32_t &totalZ) const {
   
   totalZ = getAxisTotal(_axisZ);
 }
 
-void JumpDetector::getAverageRates(float &rateZ) const
-{
-  rateZ = getAxisRate(_axisZ);
-}
-
 void JumpDetector::resetSession() {
-  _avgJump = INITIAL_THRESHOLD;
-  _calibrationComplete = false;
-  _calibrationJumps = 0;
+  _amplitudes.reset();
+  _intervals.reset();
+  _lastSampleMs = 0;
+  _phaseSumMs = 0;
+  _phaseSamples = 0;
 
   for (AxisDetector *axis : {&_axisZ}) {
     for (int i = 0; i < NUM_TIMING_CONFIGS; i++) {
@@ -274,5 +345,66 @@ void JumpDetector::resetSession() {
   }
 }
 
-bool JumpDetector::isCalibrated() const { return _calibrationComplete; }
+void JumpDetector::setTuning(float thresholdFactor, uint32_t minIntervalMs,
+                             uint32_t timingToleranceMs, uint32_t maxPhaseMs) {
+  _thresholdFactor = thresholdFactor;
+  _minIntervalMs = minIntervalMs;
+  _timingToleranceMs = timingToleranceMs;
+  _maxPhaseMs = maxPhaseMs;
+}
+
+void JumpDetector::setEventLog(JumpEventLog *log) { _events = log; }
+
+void JumpDetector::setCountedConfig(int configIndex) {
+  if (configIndex >= 0 && configIndex < NUM_TIMING_CONFIGS) {
+    _countedConfig = configIndex;
+  }
+}
+
+bool JumpDetector::isCalibrated() const {
+  return _amplitudes.weight() >= SETTLED_SAMPLES;
+}
+
+float JumpDetector::getJumpAmplitude() const {
+  return _amplitudes.weight() > 0.0f ? _amplitudes.quantile(0.5f)
+                                     : INITIAL_THRESHOLD;
+}
 
+void JumpDetector::restoreCalibration(float amplitude) {
+  _amplitudes.reset();
+  _amplitudes.add(amplitude, SETTLED_SAMPLES);
+}
+
+float JumpDetector::amplitudeThreshold() const {
+  const float threshold = getJumpAmplitude() / _thresholdFactor;
+  return fmaxf(MIN_THRESHOLD, fminf(MAX_THRESHOLD, threshold));
+}
+
+uint32_t JumpDetector::minJumpInterval() const {
+  if (_intervals.weight() < SETTLED_SAMPLES) {
+    return _minIntervalMs;
+  }
+  const uint32_t guard =
+      static_cast<uint32_t>(_intervals.quantile(0.5f) * INTERVAL_GUARD);
+  return guard > _minIntervalMs ? guard : _minIntervalMs;
+}
+
+int JumpDetector::getBestTimingConfig() const {
+  if (_phaseSamples == 0)
+    return -1;
+
+  // Average rise + fall of a jump against each config's expected pair
+  const uint32_t phaseMs = _phaseSumMs / _phaseSamples;
+  int best = 0;
+  uint32_t bestError = UINT32_MAX;
+  for (int i = 0; i < NUM_TIMING_CONFIGS; i++) {
+    const uint32_t expected = TIMING_CONFIGS[i].rise + TIMING_CONFIGS[i].fall;
+    const uint32_t error =
+        phaseMs > expected ? phaseMs - expected : expected - phaseMs;
+    if (error < bestError) {
+      best = i;
+      bestError = error;
+    }
+  }
+  return best;
+}
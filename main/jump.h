@@ -2,6 +2,8 @@
 #define JUMP_H
 
 #include "gyro.h"
+#include "jump_events.h"
+#include "streaming_quantile.h"
 #include <cstdint>
 
 // Number of timing configurations to test
@@ -39,8 +41,8 @@ struct AxisDetector {
 
 class JumpDetector {
 public:
-  JumpDetector(SensorReading *sensor,
-               float thresholdFactor = 1.3f, uint32_t minIntervalMs = 300);
+  // Call setTuning() before the first update().
+  explicit JumpDetector(SensorReading *sensor);
 
   void update();
   void jumpDetectionTask();
@@ -54,35 +56,80 @@ public:
 
   void getTotalJumps(uint32_t &totalZ) const;
 
-  void getAverageRates(float &rateZ) const;
   void resetSession();
 
+  // Sets the detection tolerances (JR_PARAMS); counts and calibration are
+  // kept.
+  void setTuning(float thresholdFactor, uint32_t minIntervalMs,
+                 uint32_t timingToleranceMs, uint32_t maxPhaseMs);
+
+  // True once the thresholds rest on a few jumps' worth of samples.
   bool isCalibrated() const;
 
+  // Median amplitude of recent jumps, for saving a user's calibration.
+  float getJumpAmplitude() const;
+
+  // Seeds the amplitude statistics with a saved median, as if a few jumps
+  // of that size had been seen.
+  void restoreCalibration(float amplitude);
+
+  // Timing config whose rise/fall time is closest to the jumps seen this
+  // session; -1 before the first jump.
+  int getBestTimingConfig() const;
+
+  // Timing config whose jumps are counted; only its candidates feed the
+  // amplitude and interval statistics.
+  void setCountedConfig(int configIndex);
+
+  // Records every decision (and near miss) of updateConfig() in log; the
+  // log must outlive the detector. nullptr stops recording.
+  void setEventLog(JumpEventLog *log);
+
   const char *getName() const;
 
 private:
   SensorReading *_sensor;
   float _thresholdFactor;
   uint32_t _minIntervalMs;
+  uint32_t _timingToleranceMs; // allowed deviation from the rise/fall time
+  uint32_t _maxPhaseMs;        // rise/fall timeout
+
+  // Filter weights for the current poll interval
+  uint32_t _lastUpdateMs;
+  uint32_t _filterStepMs; // interval _alphaFast/_alphaSlow were computed for
+  float _alphaFast;
+  float _alphaSlow;
 
   AxisDetector _axisZ;
 
-  float _avgJump;             // Adaptive threshold baseline
-  bool _calibrationComplete;  // Calibration status
-  uint32_t _calibrationJumps; // Jumps during calibration
+  // Recent jump candidates; the thresholds are derived from their medians
+  StreamingQuantile<> _amplitudes; // peak - valley
+  StreamingQuantile<> _intervals;  // ms between sampled candidates
+  uint32_t _lastSampleMs;          // last sampled candidate, 0 = none
+  uint32_t _phaseSumMs;            // Measured rise + fall of registered jumps
+  uint32_t _phaseSamples;
+  int _countedConfig;    // feeds _amplitudes/_intervals
+  JumpEventLog *_events; // decisions with their features, may be nullptr
 
   uint32_t getMillis();
 
+  // Amplitude a candidate must exceed: the median over _thresholdFactor
+  float amplitudeThreshold() const;
+
+  // Shortest accepted gap: _minIntervalMs, raised for slow cadences
+  uint32_t minJumpInterval() const;
+
   void updateAxis(AxisDetector &axis, float value, uint32_t now);
 
   void updateConfig(JumpConfig &config, float value, uint32_t now);
 
+  void logEvent(JumpConfig &config, JumpEventReason reason, uint32_t now,
+                uint32_t riseMs, uint32_t fallMs, float valley,
+                float threshold, uint32_t minInterval);
+
   int getConfigIndex(JumpConfig *config);
 
   uint32_t getAxisTotal(const AxisDetector &axis) const;
-
-  float getAxisRate(const AxisDetector &axis) const;
 };
 
 #endif // JUMP_H
@@ -0,0 +1,54 @@
+#include "jump_events.h"
+
+JumpEventLog::JumpEventLog() : _next(0) {
+  for (Slot &slot : _slots) {
+    slot.stamp.store(0, std::memory_order_relaxed);
+  }
+}
+
+void JumpEventLog::push(const JumpEvent &event) {
+  const uint32_t seq = _next.load(std::memory_order_relaxed);
+  Slot &slot = _slots[seq % JUMP_EVENT_RING];
+  slot.stamp.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.event = event;
+  slot.stamp.store(seq + 1, std::memory_order_release);
+  _next.store(seq + 1, std::memory_order_release);
+}
+
+void JumpEventLog::range(uint32_t &oldest, uint32_t &next) const {
+  next = _next.load(std::memory_order_acquire);
+  // The slot of `next` may be half written, so one less than the ring holds
+  oldest = next >= JUMP_EVENT_RING ? next - JUMP_EVENT_RING + 1 : 0;
+}
+
+bool JumpEventLog::next(uint32_t &cursor, JumpEvent &out,
+                        uint32_t *seq) const {
+  while (true) {
+    uint32_t oldest, head;
+    range(oldest, head);
+    if (cursor >= head) {
+      return false;
+    }
+    if (cursor < oldest) {
+      cursor = oldest; // lapped; the events in between are gone
+    }
+
+    // Retry when the writer reused the slot while it was copied
+    const Slot &slot = _slots[cursor % JUMP_EVENT_RING];
+    if (slot.stamp.load(std::memory_order_acquire) != cursor + 1) {
+      continue;
+    }
+    out = slot.event;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.stamp.load(std::memory_order_relaxed) != cursor + 1) {
+      continue;
+    }
+
+    if (seq) {
+      *seq = cursor;
+    }
+    cursor++;
+    return true;
+  }
+}
@@ -0,0 +1,66 @@
+#ifndef JUMP_EVENTS_H
+#define JUMP_EVENTS_H
+
+#include <atomic>
+#include <cstdint>
+
+// Events kept in RAM; at 4 timing configs and 3 jumps/s about 10 s' worth
+constexpr uint32_t JUMP_EVENT_RING = 128;
+
+// Why the detector decided the way it did
+enum JumpEventReason : uint8_t {
+  JUMP_EVENT_ACCEPTED = 0,
+  JUMP_EVENT_LOW_AMPLITUDE = 1, // diff below the threshold (near miss)
+  JUMP_EVENT_TOO_SOON = 2,      // interval below the minimum
+  JUMP_EVENT_RISE_TIMING = 3,   // rise time just outside the tolerance
+};
+
+// One detector decision with the features it was based on. Wire and
+// journal payload (little endian, packed).
+struct __attribute__((packed)) JumpEvent {
+  uint32_t timestampMs;   // device uptime
+  uint8_t config;         // timing config index
+  uint8_t reason;         // JumpEventReason
+  uint16_t riseMs;
+  uint16_t fallMs;        // 0 for rise rejections
+  uint16_t intervalMs;    // since the config's last jump, 0xFFFF = none/long
+  int16_t peak;           // filtered value at the peak
+  int16_t valley;         // at the valley; on rise rejections, the value
+                          // that confirmed the peak
+  uint16_t diff;          // |peak - valley|
+  uint16_t threshold;     // amplitude threshold at decision time
+  uint16_t minIntervalMs; // interval guard at decision time
+};
+static_assert(sizeof(JumpEvent) == 22, "JumpEvent is a wire format");
+
+// Fixed-capacity ring of detector decisions. One writer (the detector, in
+// the jump detection task); any number of readers, each with its own cursor
+// (the event sequence number), read without a lock. When the writer laps a
+// reader, the reader skips to the oldest event still held.
+class JumpEventLog {
+public:
+  JumpEventLog();
+
+  void push(const JumpEvent &event);
+
+  // Copies the first event with seq >= cursor into out and moves cursor past
+  // it; false when caught up. *seq (if given) gets the event's number.
+  bool next(uint32_t &cursor, JumpEvent &out, uint32_t *seq = nullptr) const;
+
+  // Held range: [oldest, next).
+  void range(uint32_t &oldest, uint32_t &next) const;
+
+  JumpEventLog(const JumpEventLog &) = delete;
+  JumpEventLog &operator=(const JumpEventLog &) = delete;
+
+private:
+  struct Slot {
+    std::atomic<uint32_t> stamp; // seq + 1 of the event held, 0 while written
+    JumpEvent event;
+  };
+
+  Slot _slots[JUMP_EVENT_RING];
+  std::atomic<uint32_t> _next; // seq of the next event pushed
+};
+
+#endif // JUMP_EVENTS_H
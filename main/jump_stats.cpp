@@ -0,0 +1,131 @@
+#include "jump_stats.h"
+#include <cmath>
+#include <cstring>
+
+// Cadence drops to 0 after this long without a jump
+constexpr uint32_t CADENCE_IDLE_MS = 2000;
+// A gap this many mean intervals long breaks the rhythm (a miss)...
+constexpr float MISS_FACTOR = 1.75f;
+// ...unless it is long enough to be a rest
+constexpr uint32_t REST_MS = 5000;
+// Intervals needed before a mean is trusted to spot misses
+constexpr uint32_t MIN_RHYTHM_INTERVALS = 3;
+
+JumpStats::JumpStats() : _seq(0) { reset(); }
+
+void JumpStats::reset() {
+  _head = 0;
+  memset(_tail, 0, sizeof(_tail));
+  _intervals = 0;
+  _mean = 0.0f;
+  _m2 = 0.0f;
+  _seedMs = 0.0f;
+  _streak = 0;
+  _bestStreak = 0;
+  _misses = 0;
+  publish(0);
+}
+
+void JumpStats::seedInterval(float intervalMs) {
+  _seedMs = intervalMs > 0.0f ? intervalMs : 0.0f;
+}
+
+void JumpStats::addInterval(float intervalMs) {
+  _intervals++;
+  const float delta = intervalMs - _mean;
+  _mean += delta / _intervals;
+  _m2 += delta * (intervalMs - _mean);
+}
+
+float JumpStats::rhythmMs() const {
+  // The last 10 s follow a user who slows down; the session mean, or
+  // before that a known user's seed, covers the first jumps
+  const uint32_t n = _head - _tail[0];
+  if (n > MIN_RHYTHM_INTERVALS) {
+    const uint32_t first = _times[_tail[0] % JUMP_STATS_RING];
+    const uint32_t last = _times[(_head - 1) % JUMP_STATS_RING];
+    return static_cast<float>(last - first) / (n - 1);
+  }
+  return _intervals >= MIN_RHYTHM_INTERVALS ? _mean : _seedMs;
+}
+
+void JumpStats::addJumps(uint32_t count, uint32_t nowMs) {
+  if (count == 0) {
+    return;
+  }
+  if (_head > 0) {
+    const uint32_t gap = nowMs - _times[(_head - 1) % JUMP_STATS_RING];
+    const float interval = static_cast<float>(gap) / count;
+    const float rhythm = rhythmMs();
+    if (gap > REST_MS) {
+      _streak = 0;
+    } else if (rhythm > 0.0f && interval > MISS_FACTOR * rhythm) {
+      _misses++;
+      _streak = 0;
+    } else {
+      for (uint32_t i = 0; i < count; i++) {
+        addInterval(interval);
+      }
+    }
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    _times[_head % JUMP_STATS_RING] = nowMs;
+    _head++;
+  }
+  _streak += count;
+  if (_streak > _bestStreak) {
+    _bestStreak = _streak;
+  }
+}
+
+void JumpStats::tick(uint32_t nowMs) {
+  for (int w = 0; w < JUMP_STATS_WINDOWS; w++) {
+    // The ring only remembers the newest JUMP_STATS_RING jumps
+    if (_head - _tail[w] > JUMP_STATS_RING) {
+      _tail[w] = _head - JUMP_STATS_RING;
+    }
+    while (_tail[w] != _head && nowMs - _times[_tail[w] % JUMP_STATS_RING] >
+                                    JUMP_STATS_WINDOW_MS[w]) {
+      _tail[w]++;
+    }
+  }
+  publish(nowMs);
+}
+
+void JumpStats::publish(uint32_t nowMs) {
+  const uint32_t seq = _seq.load(std::memory_order_relaxed);
+  _seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  const uint32_t last = _head ? _times[(_head - 1) % JUMP_STATS_RING] : 0;
+  const bool idle = _head == 0 || nowMs - last > CADENCE_IDLE_MS;
+  _snapshot.jumps = _head;
+  _snapshot.lastJumpMs = last;
+  for (int w = 0; w < JUMP_STATS_WINDOWS; w++) {
+    const uint32_t n = _head - _tail[w];
+    const uint32_t spanMs = n ? last - _times[_tail[w] % JUMP_STATS_RING] : 0;
+    _snapshot.cadenceJpm[w] =
+        (idle || n < 2 || spanMs == 0)
+            ? 0
+            : static_cast<uint16_t>(60000.0f * (n - 1) / spanMs + 0.5f);
+  }
+  _snapshot.intervalMeanMs = _intervals ? _mean : 0.0f;
+  _snapshot.intervalStdMs =
+      _intervals > 1 ? sqrtf(_m2 / (_intervals - 1)) : 0.0f;
+  _snapshot.streak = _streak;
+  _snapshot.bestStreak = _bestStreak;
+  _snapshot.misses = _misses;
+
+  _seq.store(seq + 2, std::memory_order_release);
+}
+
+void JumpStats::read(JumpStatsSnapshot &out) const {
+  uint32_t before, after;
+  do {
+    before = _seq.load(std::memory_order_acquire);
+    out = _snapshot;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = _seq.load(std::memory_order_relaxed);
+  } while ((before & 1) || before != after);
+}
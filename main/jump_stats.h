@@ -0,0 +1,86 @@
+#ifndef JUMP_STATS_H
+#define JUMP_STATS_H
+
+#include <atomic>
+#include <cstdint>
+
+// Jump timestamps kept; enough for the longest window at 8 jumps/s
+constexpr int JUMP_STATS_RING = 512;
+// Sliding cadence windows
+constexpr int JUMP_STATS_WINDOWS = 3;
+constexpr uint32_t JUMP_STATS_WINDOW_MS[JUMP_STATS_WINDOWS] = {10000, 30000,
+                                                               60000};
+
+// What the display and BLE read; a consistent copy from one update
+struct JumpStatsSnapshot {
+  uint32_t jumps;      // since reset()
+  uint32_t lastJumpMs; // 0 = none yet
+  // Cadence of the jumps inside each window (jumps/min); 0 with fewer than
+  // two jumps in it or once the rope has been idle for a moment
+  uint16_t cadenceJpm[JUMP_STATS_WINDOWS];
+  float intervalMeanMs; // between jumps in rhythm (misses and rests left out)
+  float intervalStdMs;
+  uint32_t streak;     // jumps since the last miss or rest
+  uint32_t bestStreak;
+  uint32_t misses;     // rhythm breaks shorter than a rest
+
+  // Cadence of the mean in-rhythm interval (jumps/min), 0 = none yet
+  uint16_t meanCadenceJpm() const {
+    return intervalMeanMs > 0.0f
+               ? static_cast<uint16_t>(60000.0f / intervalMeanMs + 0.5f)
+               : 0;
+  }
+};
+
+// Session statistics over the counted jumps. The jump detection task is the
+// only writer; every update is O(1) (windows advance past the jumps that
+// left them, so each jump is expired once per window). Any task can read()
+// without a lock: a sequence counter lets a reader retry when it raced with
+// an update.
+class JumpStats {
+public:
+  JumpStats();
+
+  // Starts a new session.
+  void reset();
+
+  // Sets the expected interval from a known user, so rhythm breaks count
+  // from the first jumps. Only miss detection uses it; the reported interval
+  // statistics stay those of this session.
+  void seedInterval(float intervalMs);
+
+  // Records count jumps detected at nowMs (usually 1).
+  void addJumps(uint32_t count, uint32_t nowMs);
+
+  // Expires jumps that left the windows and publishes; call every poll.
+  void tick(uint32_t nowMs);
+
+  void read(JumpStatsSnapshot &out) const;
+
+  JumpStats(const JumpStats &) = delete;
+  JumpStats &operator=(const JumpStats &) = delete;
+
+private:
+  uint32_t _times[JUMP_STATS_RING];
+  uint32_t _head;                       // jumps recorded (next ring slot)
+  uint32_t _tail[JUMP_STATS_WINDOWS];   // oldest jump inside each window
+
+  // Welford running mean/variance of in-rhythm intervals
+  uint32_t _intervals;
+  float _mean;
+  float _m2;
+  float _seedMs; // expected interval before the session has its own, 0 = none
+
+  uint32_t _streak;
+  uint32_t _bestStreak;
+  uint32_t _misses;
+
+  JumpStatsSnapshot _snapshot;
+  std::atomic<uint32_t> _seq; // odd while _snapshot is being written
+
+  void addInterval(float intervalMs);
+  float rhythmMs() const; // expected interval, 0 = not known yet
+  void publish(uint32_t nowMs);
+};
+
+#endif // JUMP_STATS_H
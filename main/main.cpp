@@ -1,28 +1,70 @@
 #include "algorithm_by_RF.h"
+#include "cycle_meter.h"
 #include "display.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
 #include "i2cInit.h"
 #include "jr_ble.h"
+#include "journal.h"
 #include "jump.h"
+#include "jump_events.h"
+#include "jump_stats.h"
 #include "max30102.h"
+#include "motion_canceller.h"
 #include "mutex.h"
+#include "ppg_agc.h"
+#include "ppg_beats.h"
+#include "ppg_contact.h"
+#include "ppg_decimator.h"
+#include "ppg_quality.h"
+#include "profiles.h"
+#include <atomic>
 #include <cstdio>
+#include <cstring>
 #include <inttypes.h>
 
 /* =========================
    CONFIGURATION
    ========================= */
-constexpr float JUMP_THRESHOLD_FACTOR = 1.3f;
-constexpr int MIN_JUMP_INTERVAL_MS = 300;
-constexpr int JUMP_UPDATE_HZ = 100;
-constexpr int DISPLAY_UPDATE_HZ = 4;
-constexpr int CALIBRATION_TIME_MS = 3000;
-
-constexpr int SPO2_BUFFER_SIZE = 100;
+// Task rates and detector thresholds are runtime parameters (JR_PARAMS in
+// components/ble/jr_params.h), set over BLE and kept in NVS.
+
+// Timing config counted over BLE until a user profile picks another
+constexpr int DEFAULT_COUNT_CONFIG = 3;
+// A session updates its user's profile only after this many jumps
+constexpr uint32_t PROFILE_MIN_JUMPS = 20;
+// Weight of the latest session in the profile's typical cadence
+constexpr float PROFILE_CADENCE_WEIGHT = 0.3f;
+
+// Group sessions: advertise live count/cadence/HR to passive scanners
+constexpr bool BLE_GROUP_BROADCAST = false;
+// JUMP_STATS_WINDOW_MS entries behind the live (BLE) and displayed cadence
+constexpr int BLE_CADENCE_WINDOW = 0;     // 10 s
+constexpr int DISPLAY_CADENCE_WINDOW = 1; // 30 s
+
+// MAX30102 ADC rate, split into on-chip averaging and software decimation
+// so the algorithm always sees FS (25 Hz) samples.
 constexpr int SPO2_SAMPLE_HZ = 100;
+constexpr uint8_t SPO2_SENSOR_AVERAGING = 1;
+constexpr uint8_t SPO2_SW_DECIMATION = 4;
+constexpr PpgRateConfig SPO2_RATE_CONFIG = {
+    SPO2_SAMPLE_HZ, SPO2_SENSOR_AVERAGING, SPO2_SW_DECIMATION};
+static_assert(SPO2_RATE_CONFIG.outputRateHz() == FS,
+              "PPG rate config must produce the algorithm rate FS");
+
+constexpr int SPO2_BUFFER_SIZE = BUFFER_SIZE; // ST seconds at FS
+constexpr int SPO2_POLL_MS = 100;             // FIFO holds 32 samples
+constexpr LedAgcSettings SPO2_LED_START = {0x24, 0x24, ADC_RANGE_4096};
+
+// Motion is cancelled before scoring, so there is no accelerometer gate:
+// motion the canceller leaves behind still fails the perfusion and DC drift
+// checks.
+constexpr PpgQualityConfig SPO2_QUALITY_CONFIG = {
+    0.1f, 0.5f, 10.0f, 0.02f, 5.0f, 0.0f, 50,
+};
 /* =========================
    GLOBALS
    ========================= */
@@ -32,14 +74,26 @@ static JumpDetector *accelDetector = nullptr;
 static SensorReading *sensor = nullptr;
 static SemaphoreHandle_t dataMutex = nullptr;
 
-// Calibration
-static uint32_t calibrationStartTime = 0;
-static bool calibrationPhase = true;
+// Set until the detector's thresholds rest on a few jumps (there is no
+// separate calibration phase); written by jumpDetectionTask
+static std::atomic<bool> g_calibrating{true};
 
 // Count cache for display (Z-axis only)
 static uint32_t accelCountsZ[NUM_TIMING_CONFIGS];
 
-// Heart rate / SpO2 — written by heartRateTask, read by bleUpdateTask +
+// Cadence, streaks and misses of the counted jumps; written by
+// jumpDetectionTask, read lock-free by the display
+static JumpStats g_jumpStats;
+
+// Detector decisions and near misses; written by the detector in
+// jumpDetectionTask, read lock-free by the journal drain and BLE sync
+static JumpEventLog g_jumpEvents;
+
+// Jump count sent over BLE (the session's timing config); written by
+// jumpDetectionTask
+static std::atomic<uint32_t> g_bleJumpCount{0};
+
+// Heart rate / SpO2 — written by heartRateTask, read by publishBleSnapshot +
 // displayTask
 static SemaphoreHandle_t hrMutex = nullptr;
 static int32_t g_heart_rate = 0;
@@ -47,27 +101,316 @@ static int8_t g_hr_valid = 0;
 static float g_spo2 = 0.0f;
 static int8_t g_spo2_valid = 0;
 
+/* =========================
+   BLE PUBLISHING
+   ========================= */
+// Pushes the current jump count and vitals to the BLE layer. Called whenever
+// either changes; jr_ble coalesces changes into notifications.
+static void publishBleSnapshot() {
+  int32_t hr;
+  int8_t hrValid;
+  float spo2;
+  int8_t spo2Valid;
+  {
+    MutexGuard lock(hrMutex);
+    hr = g_heart_rate;
+    hrValid = g_hr_valid;
+    spo2 = g_spo2;
+    spo2Valid = g_spo2_valid;
+  }
+
+  // Only send real SpO2 when the algorithm says it's valid; otherwise 0
+  uint8_t hr_to_send = hrValid ? (uint8_t)hr : 0;
+  uint8_t spo2_to_send = spo2Valid ? (uint8_t)spo2 : 0;
+  const uint8_t flags =
+      static_cast<uint8_t>((hrValid ? JR_TM_F_HR_VALID : 0) |
+                           (spo2Valid ? JR_TM_F_SPO2_VALID : 0) |
+                           (g_calibrating.load(std::memory_order_relaxed)
+                                ? JR_TM_F_CALIBRATING
+                                : 0));
+  const uint32_t jumps = g_bleJumpCount.load(std::memory_order_relaxed);
+  jr_ble_set_sensor_snapshot(jumps, hr_to_send, spo2_to_send, flags);
+
+  // Keep a copy on the device so a client that drops out can sync it later
+  if (jr_ble_session_active()) {
+    JournalSample sample = {};
+    sample.timestampMs = static_cast<uint32_t>(esp_timer_get_time() / 1000);
+    sample.jumpCount = jumps;
+    sample.heartRate = hr_to_send;
+    sample.spo2 = spo2_to_send;
+    sample.flags = flags; // same validity bits as the live record
+    Journal::getInstance().append(JOURNAL_SAMPLE, &sample, sizeof(sample));
+  }
+}
+
+/* =========================
+   JOURNAL
+   ========================= */
+static size_t journalSyncRead(uint32_t *cursor, uint8_t *buf, size_t cap) {
+  return Journal::getInstance().read(*cursor, buf, cap);
+}
+
+static void journalSyncRange(uint32_t *oldest, uint32_t *next) {
+  Journal::getInstance().range(*oldest, *next);
+}
+
+static const jr_sync_source_t journalSyncSource = {journalSyncRead,
+                                                   journalSyncRange};
+
+static void journalSession(JournalRecordType type, uint32_t sessionId,
+                           uint32_t jumpCount) {
+  Journal &journal = Journal::getInstance();
+  JournalSession rec = {};
+  rec.timestampMs = static_cast<uint32_t>(esp_timer_get_time() / 1000);
+  rec.sessionId = sessionId;
+  rec.jumpCount = jumpCount;
+  journal.append(type, &rec, sizeof(rec));
+
+  if (type == JOURNAL_SESSION_END) {
+    journal.requestFlush();
+    const JournalStats stats = journal.stats();
+    ESP_LOGI(TAG,
+             "Journal: %" PRIu32 " records, %" PRIu32 " KB programmed, "
+             "write amplification %.2f, %" PRIu32 " erases, %" PRIu32
+             " dropped",
+             stats.records, static_cast<uint32_t>(stats.flashBytes / 1024),
+             stats.writeAmplification(), stats.sectorErases, stats.dropped);
+  }
+}
+
+/* =========================
+   JUMP EVENTS
+   ========================= */
+// Events journaled per jump task loop (a loop adds at most a few)
+constexpr int JUMP_EVENT_JOURNAL_BATCH = 8;
+
+// Serves the event ring as a second sync source, in the journal's wire
+// format (record type JOURNAL_JUMP_EVENT, seq = event number)
+static size_t eventSyncRead(uint32_t *cursor, uint8_t *buf, size_t cap) {
+  constexpr size_t RECORD_SIZE = JR_SYNC_RECORD_HEADER_SIZE + sizeof(JumpEvent);
+  size_t len = 0;
+  JumpEvent event;
+  uint32_t seq;
+  while (len + RECORD_SIZE <= cap && g_jumpEvents.next(*cursor, event, &seq)) {
+    uint8_t *p = buf + len;
+    memcpy(p, &seq, sizeof(seq));
+    p[4] = JOURNAL_JUMP_EVENT;
+    p[5] = sizeof(event);
+    memcpy(p + JR_SYNC_RECORD_HEADER_SIZE, &event, sizeof(event));
+    len += RECORD_SIZE;
+  }
+  return len;
+}
+
+static void eventSyncRange(uint32_t *oldest, uint32_t *next) {
+  g_jumpEvents.range(*oldest, *next);
+}
+
+static const jr_sync_source_t eventSyncSource = {eventSyncRead,
+                                                 eventSyncRange};
+
+// Journals the decisions of the counted config during a session; the other
+// configs' events stay in RAM (BLE sync only) to spare the flash.
+static void journalJumpEvents(uint32_t &cursor, bool active,
+                              int countConfig) {
+  if (!active) {
+    uint32_t oldest;
+    g_jumpEvents.range(oldest, cursor); // nothing to keep between sessions
+    return;
+  }
+  JumpEvent event;
+  for (int i = 0;
+       i < JUMP_EVENT_JOURNAL_BATCH && g_jumpEvents.next(cursor, event);
+       i++) {
+    if (event.config == countConfig) {
+      Journal::getInstance().append(JOURNAL_JUMP_EVENT, &event,
+                                    sizeof(event));
+    }
+  }
+}
+
+/* =========================
+   RUNTIME PARAMETERS
+   ========================= */
+// Poll period for a rate parameter, rounded to the nearest RTOS tick (at a
+// 100 Hz tick, 67-100 Hz poll every tick and 50-66 Hz every other one)
+static TickType_t periodTicks(jr_param_id_t rateParam) {
+  const uint32_t hz = jr_param_get(rateParam);
+  const TickType_t ticks = (configTICK_RATE_HZ + hz / 2) / hz;
+  return ticks > 0 ? ticks : 1;
+}
+
+// Hands the tuned thresholds to the detector (caller holds dataMutex once
+// the tasks run).
+static void applyDetectorTuning() {
+  accelDetector->setTuning(
+      jr_param_get(JR_PARAM_JUMP_THRESHOLD_X100) / 100.0f,
+      jr_param_get(JR_PARAM_MIN_JUMP_INTERVAL_MS),
+      jr_param_get(JR_PARAM_TIMING_TOLERANCE_MS),
+      jr_param_get(JR_PARAM_MAX_PHASE_MS));
+}
+
+/* =========================
+   USER PROFILES
+   ========================= */
+// Seeds a new session with the user's saved calibration when there is one
+// (caller holds dataMutex). Returns false for unknown users.
+static bool restoreUserProfile(uint32_t userId, int &countConfig) {
+  JumpProfile profile;
+  if (!ProfileStore::getInstance().find(userId, profile)) {
+    return false;
+  }
+  accelDetector->restoreCalibration(profile.jumpAmplitude);
+  if (profile.timingConfig < NUM_TIMING_CONFIGS) {
+    countConfig = profile.timingConfig;
+  }
+  if (profile.cadenceJpm != 0) {
+    g_jumpStats.seedInterval(60000.0f / profile.cadenceJpm);
+  }
+  return true;
+}
+
+// Folds a finished session into its user's profile. Anonymous, short or
+// uncalibrated sessions leave the profiles alone.
+static void saveUserProfile(uint32_t userId, uint32_t jumps,
+                            uint16_t cadenceJpm) {
+  if (userId == 0 || jumps < PROFILE_MIN_JUMPS) {
+    return;
+  }
+  float jumpAmplitude;
+  int timingConfig;
+  {
+    MutexGuard lock(dataMutex);
+    if (!accelDetector->isCalibrated()) {
+      return;
+    }
+    jumpAmplitude = accelDetector->getJumpAmplitude();
+    timingConfig = accelDetector->getBestTimingConfig();
+  }
+
+  ProfileStore &store = ProfileStore::getInstance();
+  JumpProfile profile = {};
+  if (!store.find(userId, profile)) {
+    profile.userId = userId;
+    profile.timingConfig = DEFAULT_COUNT_CONFIG;
+  }
+  profile.jumpAmplitude = jumpAmplitude;
+  if (timingConfig >= 0) {
+    profile.timingConfig = static_cast<uint8_t>(timingConfig);
+  }
+  if (cadenceJpm != 0) {
+    profile.cadenceJpm =
+        profile.cadenceJpm == 0
+            ? cadenceJpm
+            : static_cast<uint16_t>(
+                  profile.cadenceJpm +
+                  PROFILE_CADENCE_WEIGHT * (cadenceJpm - profile.cadenceJpm) +
+                  0.5f);
+  }
+  if (profile.sessions < UINT8_MAX) {
+    profile.sessions++;
+  }
+  store.save(profile);
+  ESP_LOGI(TAG,
+           "Profile of user %" PRIu32 ": amplitude %.0f, timing config %u, "
+           "%u jumps/min, %u sessions",
+           userId, profile.jumpAmplitude, (unsigned)profile.timingConfig,
+           (unsigned)profile.cadenceJpm, (unsigned)profile.sessions);
+}
+
 /* =========================
    JUMP DETECTION TASK
    ========================= */
 void jumpDetectionTask(void *param) {
   ESP_LOGI(TAG, "Jump detection task started");
-  bool wasStreaming = false;
+  uint32_t sessionId = 0;
+  bool wasActive = false;
+  uint32_t counts[NUM_TIMING_CONFIGS];
+  uint32_t tuning = jr_params_generation();
+  // Per session: who is jumping and which config counts
+  uint32_t sessionUser = 0;
+  int countConfig = DEFAULT_COUNT_CONFIG;
+  uint32_t eventCursor = 0; // next jump event to journal
   while (true) {
-    const bool isStreaming = jr_ble_is_streaming();
+    // A session outlives BLE disconnects, so only a new session id resets
+    const uint32_t currentId = jr_ble_session_id();
+    const bool isActive = jr_ble_session_active();
+    const bool newSession = currentId != sessionId;
+    if (wasActive && (newSession || !isActive)) {
+      const uint32_t jumps = g_bleJumpCount.load(std::memory_order_relaxed);
+      JumpStatsSnapshot stats;
+      g_jumpStats.read(stats);
+      journalSession(JOURNAL_SESSION_END, sessionId, jumps);
+      ESP_LOGI(TAG,
+               "Session %" PRIu32 ": %" PRIu32 " jumps, interval %.0f +/- "
+               "%.0f ms, best streak %" PRIu32 ", %" PRIu32 " misses",
+               sessionId, jumps, stats.intervalMeanMs, stats.intervalStdMs,
+               stats.bestStreak, stats.misses);
+      saveUserProfile(sessionUser, jumps, stats.meanCadenceJpm());
+    }
+    bool restored = false;
+    bool calibrating;
+    if (newSession) {
+      sessionUser = isActive ? jr_ble_session_user() : 0;
+      countConfig = DEFAULT_COUNT_CONFIG;
+      g_jumpStats.reset();
+    }
     {
       MutexGuard lock(dataMutex);
       // Start of a new BLE workout session: reset detector state/counts so
       // OLED and web session counters both begin from 0.
-      if (isStreaming && !wasStreaming) {
+      if (newSession) {
         accelDetector->resetSession();
-        calibrationStartTime = xTaskGetTickCount() * portTICK_PERIOD_MS;
-        calibrationPhase = true;
+        restored =
+            sessionUser != 0 && restoreUserProfile(sessionUser, countConfig);
+        accelDetector->setCountedConfig(countConfig);
+      }
+      if (jr_params_generation() != tuning) {
+        tuning = jr_params_generation();
+        applyDetectorTuning();
+        ESP_LOGI(TAG, "Detector retuned");
       }
       accelDetector->update();
+      accelDetector->getCounts(counts);
+      calibrating = !accelDetector->isCalibrated();
+    }
+    if (newSession && isActive) {
+      journalSession(JOURNAL_SESSION_START, currentId, 0);
+      if (restored) {
+        ESP_LOGI(TAG, "User %" PRIu32 " known; starting from the profile",
+                 sessionUser);
+      }
     }
-    wasStreaming = isStreaming;
-    vTaskDelay(pdMS_TO_TICKS(1000 / JUMP_UPDATE_HZ));
+    if (calibrating != g_calibrating.load(std::memory_order_relaxed)) {
+      g_calibrating.store(calibrating, std::memory_order_relaxed);
+      ESP_LOGI(TAG, calibrating ? "Thresholds reset" : "Thresholds settled");
+      publishBleSnapshot(); // updates the calibrating flag for clients
+    }
+    journalJumpEvents(eventCursor, isActive, countConfig);
+    sessionId = currentId;
+    wasActive = isActive;
+
+    // Push jumps to BLE the moment they are detected
+    const uint32_t selectedJumpCount = counts[countConfig];
+    const uint32_t previousCount =
+        g_bleJumpCount.load(std::memory_order_relaxed);
+    const uint32_t nowMs = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    if (selectedJumpCount != previousCount) {
+      if (selectedJumpCount > previousCount) {
+        g_jumpStats.addJumps(selectedJumpCount - previousCount, nowMs);
+      }
+      g_bleJumpCount.store(selectedJumpCount, std::memory_order_relaxed);
+      publishBleSnapshot();
+    }
+    g_jumpStats.tick(nowMs);
+    JumpStatsSnapshot stats;
+    g_jumpStats.read(stats);
+    jr_ble_set_cadence(stats.cadenceJpm[BLE_CADENCE_WINDOW]);
+    if (isActive) {
+      // The summary's streak and average use the same definitions
+      jr_ble_set_rhythm(currentId, stats.bestStreak, stats.meanCadenceJpm());
+    }
+    vTaskDelay(periodTicks(JR_PARAM_JUMP_UPDATE_HZ));
   }
 }
 
@@ -84,29 +427,6 @@ void displayTask(void *param) {
   while (true) {
     now = xTaskGetTickCount() * portTICK_PERIOD_MS;
 
-    // --- Calibration phase ---
-    if (calibrationPhase) {
-      uint32_t elapsed = now - calibrationStartTime;
-      if (elapsed < CALIBRATION_TIME_MS) {
-        uint32_t remaining = (CALIBRATION_TIME_MS - elapsed) / 1000;
-        char countdownStr[32];
-
-        display->clear();
-        display->drawString(10, 10, "CALIBRATING...");
-        display->drawString(5, 25, "Start jumping!");
-        snprintf(countdownStr, sizeof(countdownStr), "%lu seconds",
-                 remaining + 1);
-        display->drawString(30, 40, countdownStr);
-        display->commit();
-
-        vTaskDelay(pdMS_TO_TICKS(1000 / DISPLAY_UPDATE_HZ));
-        continue;
-      } else {
-        calibrationPhase = false;
-        ESP_LOGI(TAG, "Calibration complete");
-      }
-    }
-
     // --- Fetch Z counts under mutex ---
     {
       MutexGuard lock(dataMutex);
@@ -136,17 +456,16 @@ void displayTask(void *param) {
       // ===== ACCEL Z summary =====
       display->drawString(20, 0, "JUMP TOTAL");
 
-      uint32_t totalZ;
-      float rateZ;
-      {
-        MutexGuard lock(dataMutex);
-        accelDetector->getTotalJumps(totalZ);
-        accelDetector->getAverageRates(rateZ);
-      }
-      snprintf(line, sizeof(line), "Jumps: %lu", totalZ);
-      display->drawString(15, 25, line);
-      snprintf(line, sizeof(line), "Rate:  %.0f/min", rateZ);
-      display->drawString(15, 42, line);
+      // Counted jumps, the same total BLE clients see
+      JumpStatsSnapshot stats;
+      g_jumpStats.read(stats);
+      snprintf(line, sizeof(line), "Jumps: %" PRIu32, stats.jumps);
+      display->drawString(15, 18, line);
+      snprintf(line, sizeof(line), "Rate:  %u/min",
+               (unsigned)stats.cadenceJpm[DISPLAY_CADENCE_WINDOW]);
+      display->drawString(15, 33, line);
+      snprintf(line, sizeof(line), "Streak: %" PRIu32, stats.streak);
+      display->drawString(15, 48, line);
 
     } else {
       // HR/SpO2 page intentionally disabled for now; keep logic for later reuse.
@@ -183,48 +502,26 @@ void displayTask(void *param) {
     }
 
     display->commit();
-    vTaskDelay(pdMS_TO_TICKS(1000 / DISPLAY_UPDATE_HZ));
+    vTaskDelay(periodTicks(JR_PARAM_DISPLAY_UPDATE_HZ));
   }
 }
 
 /* =========================
-   BLE UPDATE TASK
+   HEART RATE TASK
    ========================= */
-void bleUpdateTask(void *param) {
-  while (true) {
-    uint32_t selectedJumpCount;
-
-    {
-      MutexGuard lock(dataMutex);
-      accelDetector->getCounts(accelCountsZ);
-    }
-
-    selectedJumpCount = accelCountsZ[3]; // look this up in the jump.cpp
-
-    int32_t hr;
-    int8_t hrValid;
-    float spo2;
-    int8_t spo2Valid;
-    {
-      MutexGuard lock(hrMutex);
-      hr = g_heart_rate;
-      hrValid = g_hr_valid;
-      spo2 = g_spo2;
-      spo2Valid = g_spo2_valid;
-    }
-
-    // Only send real SpO2 when the algorithm says it's valid; otherwise 0
-    uint8_t hr_to_send = hrValid ? (uint8_t)hr : 0;
-    uint8_t spo2_to_send = spo2Valid ? (uint8_t)spo2 : 0;
-    jr_ble_set_sensor_snapshot(selectedJumpCount, hr_to_send, spo2_to_send, 0);
-
-    vTaskDelay(pdMS_TO_TICKS(200));
+static void publishVitals(int32_t heartRate, int8_t hrValid, float spo2,
+                          int8_t spo2Valid) {
+  // Send 0 for HR/SpO2 when invalid
+  {
+    MutexGuard lock(hrMutex);
+    g_heart_rate = hrValid ? heartRate : 0;
+    g_hr_valid = hrValid;
+    g_spo2 = spo2Valid ? spo2 : 0.0f;
+    g_spo2_valid = spo2Valid;
   }
+  publishBleSnapshot();
 }
 
-/* =========================
-   HEART RATE TASK
-   ========================= */
 void heartRateTask(void *param) {
   (void)param;
 
@@ -233,13 +530,59 @@ void heartRateTask(void *param) {
     vTaskDelete(nullptr);
     return;
   }
-  ESP_LOGI(TAG, "MAX30102 initialized");
+  if (!ppgApplyRateConfig(SPO2_RATE_CONFIG)) {
+    ESP_LOGE(TAG, "MAX30102 rate config rejected");
+    vTaskDelete(nullptr);
+    return;
+  }
+  ESP_LOGI(TAG, "MAX30102 initialized (%d Hz, avg=%d, decim=%d -> %d Hz)",
+           SPO2_SAMPLE_HZ, SPO2_SENSOR_AVERAGING, SPO2_SW_DECIMATION, FS);
 
-  // Circular sample buffers
+  // Buffers hold decimated samples (FS Hz)
   static uint32_t irBuffer[SPO2_BUFFER_SIZE];
   static uint32_t redBuffer[SPO2_BUFFER_SIZE];
   int sampleIndex = 0;
 
+  PpgDecimator irDecimator(SPO2_SW_DECIMATION);
+  PpgDecimator redDecimator(SPO2_SW_DECIMATION);
+  CycleMeter decimCost;
+  PpgQuality quality(SPO2_QUALITY_CONFIG);
+
+  // Accelerometer-referenced motion cancellation, one filter per channel
+  MotionCanceller irCanceller;
+  MotionCanceller redCanceller;
+  CycleMeter cancelCost;
+  // The decimator runs on FIFO samples, after on-chip averaging
+  const int fifoRateHz = SPO2_SAMPLE_HZ / SPO2_SENSOR_AVERAGING;
+  const int32_t decimDelayUs = irDecimator.groupDelayUs(fifoRateHz);
+  const int32_t samplePeriodUs = 1000000 / fifoRateHz;
+  uint32_t validWindows = 0;
+
+  // Beat-to-beat intervals from the cleaned stream, published as HRV
+  BeatDetector beats(FS);
+
+  // No finger => LEDs off, algorithm suspended until PROX_INT fires
+  ContactDetector contact;
+  int64_t resumeUs = 0;
+
+  // LED current AGC, starting from the maxim_max30102_init operating point
+  LedAgc agc(SPO2_LED_START);
+  if (!ppgApplyAgcSettings(SPO2_LED_START))
+    ESP_LOGW(TAG, "Failed to apply initial LED settings");
+  agc.restart(esp_timer_get_time());
+  bool agcConverged = false;
+
+  // Drops everything derived from samples taken under old conditions
+  auto restartPipeline = [&]() {
+    sampleIndex = 0;
+    irDecimator.reset();
+    redDecimator.reset();
+    irCanceller.reset();
+    redCanceller.reset();
+    quality.discardWindow();
+    beats.resetSignal();
+  };
+
   float ratio = 0.0f, correl = 0.0f;
   float spo2 = 0.0f;
   int8_t spo2Valid = 0;
@@ -247,41 +590,223 @@ void heartRateTask(void *param) {
   int8_t hrValid = 0;
 
   while (true) {
-    uint32_t red, ir;
-    esp_err_t ret = maxim_max30102_read_fifo(&red, &ir);
+    if (contact.state() == CONTACT_LOST) {
+      if (!ppgProximityDetected()) {
+        vTaskDelay(pdMS_TO_TICKS(CONTACT_POLL_MS));
+        continue;
+      }
+      if (!ppgLeaveProximityMode(agc.settings().redPa, agc.settings().irPa))
+        ESP_LOGW(TAG, "Failed to restore MAX30102 LEDs");
+      contact.onContactRestored();
+      resumeUs = esp_timer_get_time();
+      agc.restart(resumeUs);
+      agcConverged = false;
+      ESP_LOGI(TAG, "Finger detected, sampling resumed");
+    }
 
-    if (ret != ESP_OK) {
-      ESP_LOGW(TAG, "Failed to read MAX30102 FIFO");
-      vTaskDelay(pdMS_TO_TICKS(1000 / SPO2_SAMPLE_HZ));
+    uint8_t available = 0;
+    if (maxim_max30102_fifo_available(&available) != ESP_OK) {
+      ESP_LOGW(TAG, "Failed to read MAX30102 FIFO pointers");
+      vTaskDelay(pdMS_TO_TICKS(SPO2_POLL_MS));
       continue;
     }
 
-    redBuffer[sampleIndex] = red;
-    irBuffer[sampleIndex] = ir;
-    sampleIndex++;
+    // The newest FIFO sample was taken roughly now; older ones one sample
+    // period apart.
+    const int64_t drainUs = esp_timer_get_time();
 
-    // Once the buffer is full, run the algorithm and reset
-    if (sampleIndex >= SPO2_BUFFER_SIZE) {
-      sampleIndex = 0;
+    for (uint8_t n = 0; n < available; n++) {
+      uint32_t red, ir;
+      if (maxim_max30102_read_fifo(&red, &ir) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to read MAX30102 FIFO");
+        break;
+      }
 
-      rf_heart_rate_and_oxygen_saturation(irBuffer, SPO2_BUFFER_SIZE, redBuffer,
-                                          &spo2, &spo2Valid, &heartRate,
-                                          &hrValid, &ratio, &correl);
+      if (resumeUs != 0) {
+        ESP_LOGI(TAG, "First sample %" PRId64 " ms after contact",
+                 (esp_timer_get_time() - resumeUs) / 1000);
+        resumeUs = 0;
+      }
 
-      ESP_LOGI(TAG, "HR: %" PRId32 " (valid=%d)  SpO2: %.1f (valid=%d)",
-               heartRate, hrValid, spo2, spo2Valid);
+      if (contact.onSample(ir)) {
+        ESP_LOGI(TAG, "Finger removed (%" PRIu32 "), LEDs off",
+                 contact.lostEvents());
+        if (!ppgEnterProximityMode(contact.config()))
+          ESP_LOGW(TAG, "Failed to enter MAX30102 proximity mode");
+
+        // Restart every stage so stale state does not leak into the next
+        // contact period
+        restartPipeline();
+        beats.reset();
+        publishVitals(0, 0, 0.0f, 0);
+        break;
+      }
 
-      // Publish results — send 0 for SpO2 when invalid
-      {
-        MutexGuard lock(hrMutex);
-        g_heart_rate = hrValid ? heartRate : 0;
-        g_hr_valid = hrValid;
-        g_spo2 = spo2Valid ? spo2 : 0.0f;
-        g_spo2_valid = spo2Valid;
+      if (agc.push(red, ir, esp_timer_get_time())) {
+        const LedAgcSettings &led = agc.settings();
+        if (!ppgApplyAgcSettings(led))
+          ESP_LOGW(TAG, "Failed to apply LED AGC settings");
+        ESP_LOGD(TAG, "AGC step: red=0x%02X ir=0x%02X range=0x%02X",
+                 led.redPa, led.irPa, led.range);
+        // The FIFO was emptied with the new settings; the rest of this
+        // block was taken with the old ones
+        restartPipeline();
+        break;
+      }
+      if (agc.converged() != agcConverged) {
+        agcConverged = agc.converged();
+        if (agcConverged) {
+          const LedAgcSettings &led = agc.settings();
+          ESP_LOGI(TAG,
+                   "AGC converged in %" PRIu32
+                   " ms: red=0x%02X ir=0x%02X range=0x%02X",
+                   agc.convergenceMs(), led.redPa, led.irPa, led.range);
+        }
+      }
+
+      quality.pushRaw(ir, red);
+
+      uint32_t irOut, redOut;
+      decimCost.start();
+      const bool ready = irDecimator.push(ir, irOut);
+      redDecimator.push(red, redOut);
+      decimCost.stop(ready ? 1 : 0);
+      if (!ready)
+        continue;
+
+      const int64_t sampleUs =
+          drainUs - (int64_t)(available - 1 - n) * samplePeriodUs -
+          decimDelayUs;
+      float accelG;
+      if (!sensor->accelAtG(sampleUs, accelG))
+        accelG = sensor->latestAccelG();
+
+      cancelCost.start();
+      const uint32_t irClean = irCanceller.process(irOut, accelG);
+      const uint32_t redClean = redCanceller.process(redOut, accelG);
+      cancelCost.stop();
+
+      float rrMs;
+      if (beats.push(irClean, rrMs)) {
+        const HrvStats &hrv = beats.stats();
+        jr_ble_set_hrv(static_cast<uint16_t>(rrMs + 0.5f),
+                       static_cast<uint16_t>(hrv.rmssdMs * 10.0f + 0.5f),
+                       static_cast<uint16_t>(hrv.sdnnMs * 10.0f + 0.5f),
+                       static_cast<uint16_t>(
+                           hrv.intervals > UINT16_MAX ? UINT16_MAX
+                                                      : hrv.intervals));
+      }
+
+      redBuffer[sampleIndex] = redClean;
+      irBuffer[sampleIndex] = irClean;
+      sampleIndex++;
+      quality.push(irClean, accelG);
+
+      // Once the buffer is full, score it and run the algorithm only if the
+      // window is usable
+      if (sampleIndex >= SPO2_BUFFER_SIZE) {
+        sampleIndex = 0;
+
+        const uint8_t score = quality.endWindow();
+        if (quality.passed()) {
+          CycleMeter algoCost;
+          algoCost.start();
+          rf_heart_rate_and_oxygen_saturation(
+              irBuffer, SPO2_BUFFER_SIZE, redBuffer, &spo2, &spo2Valid,
+              &heartRate, &hrValid, &ratio, &correl);
+          algoCost.stop();
+          quality.noteAlgorithmRun(algoCost.cyclesPerUnit());
+          if (hrValid)
+            validWindows++;
+        } else {
+          quality.noteAlgorithmSkipped();
+          hrValid = 0;
+          spo2Valid = 0;
+        }
+
+        const PpgQualityStats &qs = quality.stats();
+        ESP_LOGI(TAG,
+                 "HR: %" PRId32 " (valid=%d)  SpO2: %.1f (valid=%d)  "
+                 "SQI: %u (reject=%d, PI=%.2f%%)  decim: %" PRIu32
+                 " cycles/sample",
+                 heartRate, hrValid, spo2, spo2Valid, score,
+                 quality.lastReject(), quality.lastPerfusionPct(),
+                 decimCost.cyclesPerUnit());
+        ESP_LOGI(TAG,
+                 "SQI gate: runs=%" PRIu32 " skipped=%" PRIu32
+                 " saved=%" PRIu64 " cycles (%" PRIu32 "/run)",
+                 qs.algorithmRuns, qs.algorithmSkips, qs.cyclesSaved,
+                 qs.avgRunCycles);
+        ESP_LOGI(TAG,
+                 "Motion cancel: valid %" PRIu32 "/%" PRIu32
+                 " windows, %" PRIu32 " cycles/sample",
+                 validWindows, qs.windows, cancelCost.cyclesPerUnit());
+        const HrvStats &hrv = beats.stats();
+        ESP_LOGI(TAG,
+                 "HRV: %" PRIu32 " RR, last=%.0f ms  SDNN=%.1f ms  "
+                 "RMSSD=%.1f ms",
+                 hrv.intervals, hrv.lastRrMs, hrv.sdnnMs, hrv.rmssdMs);
+        decimCost.reset();
+        cancelCost.reset();
+
+        publishVitals(heartRate, hrValid, spo2, spo2Valid);
       }
     }
 
-    vTaskDelay(pdMS_TO_TICKS(20));
+    vTaskDelay(pdMS_TO_TICKS(SPO2_POLL_MS));
+  }
+}
+
+/* =========================
+   RAW STREAM TASK
+   ========================= */
+static TaskHandle_t rawTaskHandle = nullptr;
+
+static void rawSampleTimerCb(void *arg) { xTaskNotifyGive(rawTaskHandle); }
+
+// Samples all accel axes at the client-requested rate while raw streaming is
+// on. Paced by an esp_timer because the tick rate cannot express 400 Hz.
+void rawStreamTask(void *param) {
+  rawTaskHandle = xTaskGetCurrentTaskHandle();
+
+  const esp_timer_create_args_t timerArgs = {
+      .callback = rawSampleTimerCb,
+      .arg = nullptr,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "raw_sample",
+      .skip_unhandled_events = true,
+  };
+  esp_timer_handle_t timer;
+  ESP_ERROR_CHECK(esp_timer_create(&timerArgs, &timer));
+
+  uint16_t activeRateHz = 0;
+  while (true) {
+    const bool raw =
+        jr_ble_is_streaming() && jr_ble_stream_mode() == JR_STREAM_RAW;
+    const uint16_t rateHz = raw ? jr_ble_raw_rate_hz() : 0;
+
+    if (rateHz != activeRateHz) {
+      esp_timer_stop(timer); // not running is fine
+      if (rateHz != 0)
+        ESP_ERROR_CHECK(esp_timer_start_periodic(timer, 1000000 / rateHz));
+      activeRateHz = rateHz;
+      ESP_LOGI(TAG, "Raw accel sampling %s (%u Hz)",
+               rateHz ? "started" : "stopped", rateHz);
+    }
+
+    if (activeRateHz == 0) {
+      vTaskDelay(pdMS_TO_TICKS(100));
+      continue;
+    }
+
+    // Missed timer ticks collapse into one; the gap shows in the timestamps
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100)) == 0)
+      continue;
+
+    int16_t accel[3];
+    const int64_t nowUs = esp_timer_get_time();
+    if (sensor->readRawAccel(accel[0], accel[1], accel[2]) == ESP_OK)
+      jr_ble_push_raw(static_cast<uint32_t>(nowUs), accel, 3);
   }
 }
 
@@ -302,7 +827,16 @@ void initTask(void *param) {
   configASSERT(i2c.isInitialized());
   vTaskDelay(pdMS_TO_TICKS(100));
 
+  Journal &journal = Journal::getInstance();
+  if (journal.init()) {
+    journal.startTask();
+    jr_ble_set_sync_source(&journalSyncSource);
+  }
+  jr_ble_set_event_source(&eventSyncSource);
+
   jr_ble_init();
+  jr_ble_set_broadcast(BLE_GROUP_BROADCAST);
+  ProfileStore::getInstance().init(); // after jr_ble_init() set up NVS
 
   display = new OledDisplay();
   display->clear();
@@ -315,16 +849,17 @@ void initTask(void *param) {
   sensor->startTask();
   vTaskDelay(pdMS_TO_TICKS(100));
 
-  accelDetector =
-      new JumpDetector(sensor, JUMP_THRESHOLD_FACTOR, MIN_JUMP_INTERVAL_MS);
-
-  calibrationStartTime = xTaskGetTickCount() * portTICK_PERIOD_MS;
-  calibrationPhase = true;
+  accelDetector = new JumpDetector(sensor);
+  accelDetector->setEventLog(&g_jumpEvents);
+  accelDetector->setCountedConfig(DEFAULT_COUNT_CONFIG);
+  applyDetectorTuning();
 
   xTaskCreate(jumpDetectionTask, "jump_task", 4096, nullptr, 5, nullptr);
   xTaskCreate(displayTask, "display_task", 3072, nullptr, 4, nullptr);
-  xTaskCreate(bleUpdateTask, "ble_task", 3072, nullptr, 3, nullptr);
-  //xTaskCreate(heartRateTask, "hr_task", 3072, nullptr, 3, nullptr);
+  xTaskCreate(rawStreamTask, "raw_task", 3072, nullptr, 5, nullptr);
+  // The PPG pipeline plus the RF algorithm's float windows and float
+  // logging need more than 3 KB
+  xTaskCreate(heartRateTask, "hr_task", 6144, nullptr, 3, nullptr);
 
   ESP_LOGI(TAG, "All tasks started");
   vTaskDelete(nullptr);
@@ -0,0 +1,98 @@
+#include "profiles.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include <cinttypes>
+#include <cstring>
+
+static const char *TAG = "PROFILES";
+
+static const char *PROFILE_NAMESPACE = "jr_profiles";
+static const char *PROFILE_KEY = "profiles";
+constexpr uint32_t PROFILE_VERSION = 2; // 2: median amplitude, not EMA
+
+// NVS blob; a different version or size is ignored
+struct ProfileBlob {
+  uint32_t version;
+  JumpProfile slots[PROFILE_SLOTS];
+};
+
+ProfileStore &ProfileStore::getInstance() {
+  static ProfileStore instance;
+  return instance;
+}
+
+ProfileStore::ProfileStore() : _slots{}, _clock(0) {}
+
+void ProfileStore::init() {
+  nvs_handle_t nvs;
+  if (nvs_open(PROFILE_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+    return; // nothing stored yet
+  }
+  ProfileBlob blob;
+  size_t len = sizeof(blob);
+  if (nvs_get_blob(nvs, PROFILE_KEY, &blob, &len) == ESP_OK &&
+      len == sizeof(blob) && blob.version == PROFILE_VERSION) {
+    memcpy(_slots, blob.slots, sizeof(_slots));
+    int users = 0;
+    for (const JumpProfile &p : _slots) {
+      if (p.userId != 0) {
+        users++;
+        _clock = p.lastUsed > _clock ? p.lastUsed : _clock;
+      }
+    }
+    ESP_LOGI(TAG, "Loaded %d user profiles", users);
+  }
+  nvs_close(nvs);
+}
+
+bool ProfileStore::find(uint32_t userId, JumpProfile &out) const {
+  if (userId == 0) {
+    return false;
+  }
+  for (const JumpProfile &p : _slots) {
+    if (p.userId == userId) {
+      out = p;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ProfileStore::save(const JumpProfile &profile) {
+  if (profile.userId == 0) {
+    return;
+  }
+
+  // Same user, else a free slot, else the least recently used one
+  JumpProfile *slot = nullptr;
+  for (JumpProfile &p : _slots) {
+    if (p.userId == profile.userId) {
+      slot = &p;
+      break;
+    }
+    if (!slot || p.lastUsed < slot->lastUsed) { // free slots hold 0
+      slot = &p;
+    }
+  }
+  if (slot->userId != 0 && slot->userId != profile.userId) {
+    ESP_LOGI(TAG, "Forgetting user %" PRIu32, slot->userId);
+  }
+  *slot = profile;
+  slot->lastUsed = ++_clock;
+
+  ProfileBlob blob = {};
+  blob.version = PROFILE_VERSION;
+  memcpy(blob.slots, _slots, sizeof(blob.slots));
+  nvs_handle_t nvs;
+  if (nvs_open(PROFILE_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+    ESP_LOGW(TAG, "Profile not saved (NVS unavailable)");
+    return;
+  }
+  const esp_err_t err = nvs_set_blob(nvs, PROFILE_KEY, &blob, sizeof(blob));
+  if (err == ESP_OK) {
+    nvs_commit(nvs);
+  } else {
+    ESP_LOGW(TAG, "Profile not saved; err=%d", (int)err);
+  }
+  nvs_close(nvs);
+}
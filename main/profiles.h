@@ -0,0 +1,46 @@
+#ifndef PROFILES_H
+#define PROFILES_H
+
+#include <cstdint>
+
+// Users remembered; saving one more replaces the least recently used
+constexpr int PROFILE_SLOTS = 4;
+
+// Calibration learned from one user's sessions
+struct JumpProfile {
+  uint32_t userId;      // jr_ble_session_user(), 0 = free slot
+  uint32_t lastUsed;    // store clock at the last save (LRU order)
+  float jumpAmplitude;  // median jump amplitude (detector units)
+  uint16_t cadenceJpm;  // typical cadence while jumping, 0 = unknown
+  uint8_t timingConfig; // timing config counted over BLE
+  uint8_t sessions;     // sessions folded in (saturates at 255)
+};
+static_assert(sizeof(JumpProfile) == 16, "JumpProfile is stored in NVS");
+
+// Per-user jump calibration kept in NVS (one blob, PROFILE_SLOTS entries),
+// so a returning user's thresholds start at their level instead of settling
+// over the first jumps. Used by the jump detection task only.
+class ProfileStore {
+public:
+  static ProfileStore &getInstance();
+
+  // Loads the stored profiles; NVS must be initialized (jr_ble_init()).
+  void init();
+
+  // Copies the profile of userId into out. False for unknown users and 0.
+  bool find(uint32_t userId, JumpProfile &out) const;
+
+  // Inserts or replaces the profile of profile.userId and writes the store.
+  void save(const JumpProfile &profile);
+
+  ProfileStore(const ProfileStore &) = delete;
+  ProfileStore &operator=(const ProfileStore &) = delete;
+
+private:
+  ProfileStore();
+
+  JumpProfile _slots[PROFILE_SLOTS];
+  uint32_t _clock; // highest lastUsed handed out
+};
+
+#endif // PROFILES_H
@@ -0,0 +1,110 @@
+/*
+ * tools/jr_adv_decode.cpp
+ *
+ * Host-side decoder for broadcast (group mode) advertisements (see
+ * components/ble/jr_adv_codec.h). Reads one advertisement per line from
+ * stdin as
+ *
+ *   <label> <manufacturer data as hex, company id included>
+ *
+ * (label is typically the scanner's address column), prints the decoded
+ * updates as CSV on stdout and a per-rope summary with missed updates on
+ * stderr. Lines that are not jump rope broadcasts are skipped.
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 -Icomponents/ble tools/jr_adv_decode.cpp \
+ *       components/ble/jr_adv_codec.cpp -o jr_adv_decode
+ *
+ * Usage:
+ *   ./jr_adv_decode < scan.txt > ropes.csv
+ */
+
+#include "jr_adv_codec.h"
+
+#include <cctype>
+#include <cinttypes>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct RopeStats {
+  jr_adv_state_t last;
+  uint32_t updates;
+  uint32_t repeats; // same seq seen again (advertising repeats it)
+  uint32_t missed;
+};
+
+static bool parseHex(const std::string &hex, std::vector<uint8_t> &out) {
+  out.clear();
+  std::string digits;
+  for (char c : hex) {
+    if (std::isxdigit(static_cast<unsigned char>(c))) {
+      digits += c;
+    } else if (c != ':' && c != '-') {
+      return false;
+    }
+  }
+  if (digits.size() % 2 != 0) {
+    return false;
+  }
+  for (size_t i = 0; i < digits.size(); i += 2) {
+    out.push_back(
+        static_cast<uint8_t>(std::stoul(digits.substr(i, 2), nullptr, 16)));
+  }
+  return true;
+}
+
+int main() {
+  std::map<uint16_t, RopeStats> ropes;
+  uint32_t lines = 0, skipped = 0;
+  std::string line;
+  std::vector<uint8_t> data;
+
+  printf("label,rope_id,seq,jump_count,cadence_jpm,heart_rate,flags\n");
+
+  while (std::getline(std::cin, line)) {
+    lines++;
+    std::istringstream in(line);
+    std::string label, hex;
+    jr_adv_state_t s;
+    if (!(in >> label >> hex) || !parseHex(hex, data) ||
+        !jr_adv_decode(data.data(), data.size(), &s)) {
+      skipped++;
+      continue;
+    }
+
+    auto it = ropes.find(s.rope_id);
+    if (it == ropes.end()) {
+      ropes[s.rope_id] = RopeStats{s, 1, 0, 0};
+    } else if (s.seq == it->second.last.seq) {
+      it->second.repeats++;
+      continue; // same payload advertised again
+    } else {
+      it->second.missed += jr_adv_missed(it->second.last.seq, s.seq);
+      it->second.updates++;
+      it->second.last = s;
+    }
+
+    printf("%s,%04x,%u,%" PRIu32 ",%u,%u,0x%02x\n", label.c_str(),
+           (unsigned)s.rope_id, (unsigned)s.seq, s.jump_count,
+           (unsigned)s.cadence_jpm, (unsigned)s.heart_rate_bpm,
+           (unsigned)s.flags);
+  }
+
+  fprintf(stderr, "%" PRIu32 " lines, %" PRIu32 " skipped, %zu ropes\n", lines,
+          skipped, ropes.size());
+  for (const auto &kv : ropes) {
+    const RopeStats &r = kv.second;
+    const uint32_t offered = r.updates + r.missed;
+    fprintf(stderr,
+            "rope %04x: jumps=%" PRIu32 " cadence=%u hr=%u updates=%" PRIu32
+            " repeats=%" PRIu32 " missed=%" PRIu32 " (%.1f%%)\n",
+            (unsigned)kv.first, r.last.jump_count, (unsigned)r.last.cadence_jpm,
+            (unsigned)r.last.heart_rate_bpm, r.updates, r.repeats, r.missed,
+            offered ? 100.0f * r.missed / offered : 0.0f);
+  }
+  return 0;
+}
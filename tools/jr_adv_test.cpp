@@ -0,0 +1,150 @@
+/*
+ * tools/jr_adv_test.cpp
+ *
+ * Host test for the broadcast advertising codec
+ * (components/ble/jr_adv_codec.h): encode -> decode round trips, the wire
+ * layout, payloads that are not ours or too short, longer payloads from later
+ * versions, and missed-update counting across the seq wrap.
+ *
+ * Build and run:
+ *   g++ -std=c++17 -O2 -Icomponents/ble tools/jr_adv_test.cpp \
+ *       components/ble/jr_adv_codec.cpp -o jr_adv_test && ./jr_adv_test
+ *
+ * Exits non-zero when a check fails.
+ */
+
+#include "jr_adv_codec.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+static bool sameState(const jr_adv_state_t &a, const jr_adv_state_t &b) {
+  return a.seq == b.seq && a.rope_id == b.rope_id &&
+         a.jump_count == b.jump_count && a.cadence_jpm == b.cadence_jpm &&
+         a.heart_rate_bpm == b.heart_rate_bpm && a.flags == b.flags;
+}
+
+static const jr_adv_state_t SAMPLE = {
+    0x81, 0xBEEF, 0x01020304, 0x0123, 142,
+    JR_ADV_F_SESSION | JR_ADV_F_HR_VALID,
+};
+
+static void testWireLayout() {
+  uint8_t buf[JR_ADV_MFG_SIZE];
+  CHECK(jr_adv_encode(&SAMPLE, buf, sizeof(buf)) == JR_ADV_MFG_SIZE);
+
+  const uint8_t expected[JR_ADV_MFG_SIZE] = {
+      0xFF, 0xFF, JR_ADV_FRAME_TYPE, 0x81, 0xEF, 0xBE, 0x04,
+      0x03, 0x02, 0x01, 0x23,         0x01, 142,  0x03,
+  };
+  CHECK(memcmp(buf, expected, sizeof(buf)) == 0);
+}
+
+static void testRoundTrip() {
+  std::mt19937 rng(1234);
+  for (int i = 0; i < 10000; i++) {
+    jr_adv_state_t in;
+    in.seq = (uint8_t)rng();
+    in.rope_id = (uint16_t)rng();
+    in.jump_count = (uint32_t)rng();
+    in.cadence_jpm = (uint16_t)rng();
+    in.heart_rate_bpm = (uint8_t)rng();
+    in.flags = (uint8_t)rng();
+
+    uint8_t buf[JR_ADV_MFG_SIZE];
+    jr_adv_state_t out = {};
+    CHECK(jr_adv_encode(&in, buf, sizeof(buf)) == JR_ADV_MFG_SIZE);
+    CHECK(jr_adv_decode(buf, sizeof(buf), &out));
+    CHECK(sameState(in, out));
+  }
+}
+
+static void testShortBuffers() {
+  // Encoder: too little room writes nothing
+  uint8_t buf[JR_ADV_MFG_SIZE];
+  memset(buf, 0xAA, sizeof(buf));
+  CHECK(jr_adv_encode(&SAMPLE, buf, sizeof(buf) - 1) == 0);
+  for (uint8_t b : buf) {
+    CHECK(b == 0xAA);
+  }
+
+  // Decoder: every truncation of a valid payload is rejected
+  CHECK(jr_adv_encode(&SAMPLE, buf, sizeof(buf)) == JR_ADV_MFG_SIZE);
+  jr_adv_state_t out;
+  for (size_t len = 0; len < JR_ADV_MFG_SIZE; len++) {
+    CHECK(!jr_adv_decode(buf, len, &out));
+  }
+}
+
+static void testNotOurs() {
+  uint8_t buf[JR_ADV_MFG_SIZE];
+  jr_adv_state_t out;
+
+  CHECK(jr_adv_encode(&SAMPLE, buf, sizeof(buf)) == JR_ADV_MFG_SIZE);
+  buf[0] = 0x4C; // another company (Apple, 0x004C)
+  buf[1] = 0x00;
+  CHECK(!jr_adv_decode(buf, sizeof(buf), &out));
+
+  CHECK(jr_adv_encode(&SAMPLE, buf, sizeof(buf)) == JR_ADV_MFG_SIZE);
+  buf[1] = 0xFE; // only the high byte differs
+  CHECK(!jr_adv_decode(buf, sizeof(buf), &out));
+
+  CHECK(jr_adv_encode(&SAMPLE, buf, sizeof(buf)) == JR_ADV_MFG_SIZE);
+  buf[2] = JR_ADV_FRAME_TYPE + 1;
+  CHECK(!jr_adv_decode(buf, sizeof(buf), &out));
+}
+
+static void testLongerPayload() {
+  // A later version appends fields; today's fields still decode
+  uint8_t buf[JR_ADV_MFG_SIZE + 6];
+  memset(buf, 0x5C, sizeof(buf));
+  CHECK(jr_adv_encode(&SAMPLE, buf, sizeof(buf)) == JR_ADV_MFG_SIZE);
+
+  jr_adv_state_t out = {};
+  CHECK(jr_adv_decode(buf, sizeof(buf), &out));
+  CHECK(sameState(SAMPLE, out));
+  CHECK(buf[JR_ADV_MFG_SIZE] == 0x5C); // encoder stays within its size
+}
+
+static void testMissed() {
+  CHECK(jr_adv_missed(5, 6) == 0);
+  CHECK(jr_adv_missed(5, 9) == 3);
+  // Across the wrap
+  CHECK(jr_adv_missed(255, 0) == 0);
+  CHECK(jr_adv_missed(254, 1) == 2);
+  CHECK(jr_adv_missed(200, 10) == 65);
+  // Every distance, from every starting point
+  for (int prev = 0; prev < 256; prev++) {
+    for (int step = 1; step < 256; step++) {
+      const uint8_t seq = (uint8_t)(prev + step);
+      CHECK(jr_adv_missed((uint8_t)prev, seq) == step - 1);
+    }
+  }
+}
+
+int main() {
+  testWireLayout();
+  testRoundTrip();
+  testShortBuffers();
+  testNotOurs();
+  testLongerPayload();
+  testMissed();
+
+  if (failures) {
+    fprintf(stderr, "%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("jr_adv_codec: all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,348 @@
+/*
+ * tools/jr_bulk_test.cpp
+ *
+ * Host test for the L2CAP bulk framing and flow control
+ * (components/ble/jr_bulk.h). A loopback transport answers each send with a
+ * scripted OK / STALLED / BUSY / ERROR and hands accepted SDUs to the
+ * receive side; the record source is an in-memory journal.
+ *
+ * Build and run:
+ *   g++ -std=c++17 -O2 -Icomponents/ble tools/jr_bulk_test.cpp \
+ *       components/ble/jr_bulk.cpp -o jr_bulk_test && ./jr_bulk_test
+ *
+ * Exits non-zero when a check fails.
+ */
+
+#include "jr_bulk.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+/* ===== Record source ===== */
+
+// Records [oldest, next) in the sync wire format: u32 seq, u8 type, u8 len,
+// payload. Payload length and bytes are derived from seq so the receiver can
+// check every record without a copy of the journal.
+struct Journal {
+  uint32_t oldest;
+  uint32_t next;
+};
+
+// Both callbacks share the io context
+struct Loopback {
+  Journal journal;
+  std::vector<jr_bulk_send_rc_t> script; // answers, then OK
+  size_t calls;
+  std::vector<std::vector<uint8_t>> offered; // every send, accepted or not
+  std::vector<std::vector<uint8_t>> accepted;
+};
+
+static uint8_t recordLen(uint32_t seq) { return (uint8_t)(seq % 23); }
+static uint8_t recordByte(uint32_t seq, size_t i) {
+  return (uint8_t)(seq * 7 + i);
+}
+
+static size_t journalRead(void *ctx, uint32_t *cursor, uint8_t *buf,
+                          size_t cap) {
+  const Journal *j = &static_cast<const Loopback *>(ctx)->journal;
+  uint32_t seq = *cursor < j->oldest ? j->oldest : *cursor;
+  size_t n = 0;
+  while (seq < j->next) {
+    const uint8_t len = recordLen(seq);
+    if (n + 6 + len > cap) {
+      break;
+    }
+    memcpy(buf + n, &seq, 4);
+    buf[n + 4] = 3;
+    buf[n + 5] = len;
+    for (size_t i = 0; i < len; i++) {
+      buf[n + 6 + i] = recordByte(seq, i);
+    }
+    n += 6 + len;
+    seq++;
+  }
+  if (n != 0 || seq > *cursor) {
+    *cursor = seq;
+  }
+  return n;
+}
+
+/* ===== Loopback transport ===== */
+
+static jr_bulk_send_rc_t loopSend(void *ctx, const uint8_t *sdu, size_t len) {
+  Loopback *l = static_cast<Loopback *>(ctx);
+  const jr_bulk_send_rc_t rc =
+      l->calls < l->script.size() ? l->script[l->calls] : JR_BULK_SEND_OK;
+  l->calls++;
+  l->offered.emplace_back(sdu, sdu + len);
+  if (rc == JR_BULK_SEND_OK || rc == JR_BULK_SEND_STALLED) {
+    l->accepted.emplace_back(sdu, sdu + len);
+  }
+  return rc;
+}
+
+/* ===== Receive side ===== */
+
+struct Received {
+  jr_bulk_rx_t rx;
+  uint32_t expectSeq; // next record seq
+  uint32_t records;
+  uint32_t badRecords;
+};
+
+static void receive(Received &r, const std::vector<uint8_t> &sdu) {
+  const uint8_t *records;
+  size_t len;
+  if (jr_bulk_rx_sdu(&r.rx, sdu.data(), sdu.size(), &records, &len) !=
+      JR_BULK_DATA) {
+    return;
+  }
+  size_t off = 0;
+  while (off + 6 <= len) {
+    uint32_t seq;
+    memcpy(&seq, records + off, 4);
+    const uint8_t rlen = records[off + 5];
+    bool ok = seq == r.expectSeq && rlen == recordLen(seq) &&
+              off + 6 + rlen <= len;
+    for (size_t i = 0; ok && i < rlen; i++) {
+      ok = records[off + 6 + i] == recordByte(seq, i);
+    }
+    if (!ok) {
+      r.badRecords++;
+    }
+    r.expectSeq = seq + 1;
+    r.records++;
+    off += 6 + rlen;
+  }
+  if (off != len) {
+    r.badRecords++;
+  }
+}
+
+static void receiveAll(Received &r, const Loopback &l, size_t from = 0) {
+  for (size_t i = from; i < l.accepted.size(); i++) {
+    receive(r, l.accepted[i]);
+  }
+}
+
+/* ===== Tests ===== */
+
+static const size_t SDU_CAP = 128;
+
+struct Fixture {
+  Loopback loop;
+  uint8_t buf[1024];
+  jr_bulk_tx_t tx;
+
+  Fixture(uint32_t oldest, uint32_t next, size_t cap = SDU_CAP) : loop{} {
+    loop.journal = {oldest, next};
+    const jr_bulk_io_t io = {loopSend, journalRead, &loop};
+    jr_bulk_tx_init(&tx, &io, buf, cap);
+  }
+};
+
+static void testPlainTransfer() {
+  Fixture f(0, 200);
+  jr_bulk_tx_start(&f.tx, 0);
+  CHECK(jr_bulk_tx_pump(&f.tx) == JR_BULK_DONE);
+
+  Received r = {};
+  jr_bulk_rx_init(&r.rx);
+  receiveAll(r, f.loop);
+  CHECK(r.records == 200);
+  CHECK(r.badRecords == 0);
+  CHECK(r.rx.done);
+  CHECK(r.rx.next_cursor == 200);
+  CHECK(r.rx.lost == 0);
+  CHECK(r.rx.malformed == 0);
+  CHECK(f.tx.sdus == f.loop.accepted.size());
+  for (const std::vector<uint8_t> &sdu : f.loop.accepted) {
+    CHECK(sdu.size() <= SDU_CAP);
+  }
+}
+
+static void testBusyOffersSameSdu() {
+  Fixture f(0, 50);
+  f.loop.script = {JR_BULK_SEND_OK, JR_BULK_SEND_BUSY};
+  jr_bulk_tx_start(&f.tx, 0);
+
+  CHECK(jr_bulk_tx_pump(&f.tx) == JR_BULK_RUNNING);
+  CHECK(f.loop.offered.size() == 2);
+  CHECK(f.tx.busy == 1);
+
+  // The refused SDU comes back byte for byte, with the same seq
+  CHECK(jr_bulk_tx_pump(&f.tx) == JR_BULK_DONE);
+  CHECK(f.loop.offered.size() > 3);
+  CHECK(f.loop.offered[2] == f.loop.offered[1]);
+
+  Received r = {};
+  jr_bulk_rx_init(&r.rx);
+  receiveAll(r, f.loop);
+  CHECK(r.records == 50);
+  CHECK(r.badRecords == 0);
+  CHECK(r.rx.lost == 0);
+  CHECK(r.rx.next_cursor == 50);
+}
+
+static void testStallWaitsForCredits() {
+  Fixture f(0, 50);
+  f.loop.script = {JR_BULK_SEND_OK, JR_BULK_SEND_STALLED};
+  jr_bulk_tx_start(&f.tx, 0);
+
+  CHECK(jr_bulk_tx_pump(&f.tx) == JR_BULK_STALLED);
+  CHECK(f.tx.stalls == 1);
+  const size_t sent = f.loop.calls;
+  CHECK(jr_bulk_tx_pump(&f.tx) == JR_BULK_STALLED);
+  CHECK(f.loop.calls == sent); // nothing sent without credits
+
+  jr_bulk_tx_unstalled(&f.tx);
+  CHECK(jr_bulk_tx_pump(&f.tx) == JR_BULK_DONE);
+
+  Received r = {};
+  jr_bulk_rx_init(&r.rx);
+  receiveAll(r, f.loop);
+  CHECK(r.records == 50);
+  CHECK(r.badRecords == 0);
+  CHECK(r.rx.lost == 0);
+}
+
+static void testErrorResumesFromCursor() {
+  Fixture f(0, 100);
+  f.loop.script = {JR_BULK_SEND_OK, JR_BULK_SEND_OK, JR_BULK_SEND_ERROR};
+  jr_bulk_tx_start(&f.tx, 0);
+  CHECK(jr_bulk_tx_pump(&f.tx) == JR_BULK_FAILED);
+
+  Received r = {};
+  jr_bulk_rx_init(&r.rx);
+  receiveAll(r, f.loop);
+  CHECK(!r.rx.done);
+  CHECK(r.records > 0 && r.records < 100);
+  // The cursor only moves past records the transport accepted
+  CHECK(f.tx.cursor == r.expectSeq);
+
+  // A new transfer from that cursor fills in the rest, nothing twice
+  const size_t before = f.loop.accepted.size();
+  jr_bulk_tx_start(&f.tx, f.tx.cursor);
+  CHECK(jr_bulk_tx_pump(&f.tx) == JR_BULK_DONE);
+  jr_bulk_rx_init(&r.rx);
+  receiveAll(r, f.loop, before);
+  CHECK(r.records == 100);
+  CHECK(r.badRecords == 0);
+  CHECK(r.rx.next_cursor == 100);
+}
+
+static void testEndCarriesResumeCursor() {
+  // Caught up: END only, cursor unchanged
+  {
+    Fixture f(0, 10);
+    jr_bulk_tx_start(&f.tx, 10);
+    CHECK(jr_bulk_tx_pump(&f.tx) == JR_BULK_DONE);
+    CHECK(f.loop.accepted.size() == 1);
+    Received r = {};
+    jr_bulk_rx_init(&r.rx);
+    receiveAll(r, f.loop);
+    CHECK(r.rx.done);
+    CHECK(r.rx.next_cursor == 10);
+    CHECK(r.records == 0);
+  }
+  // Cursor older than the journal: starts at the oldest record held
+  {
+    Fixture f(40, 60);
+    jr_bulk_tx_start(&f.tx, 5);
+    CHECK(jr_bulk_tx_pump(&f.tx) == JR_BULK_DONE);
+    Received r = {};
+    r.expectSeq = 40;
+    jr_bulk_rx_init(&r.rx);
+    receiveAll(r, f.loop);
+    CHECK(r.records == 20);
+    CHECK(r.badRecords == 0);
+    CHECK(r.rx.next_cursor == 60);
+  }
+}
+
+static void testSeqGaps() {
+  Fixture f(0, 200);
+  jr_bulk_tx_start(&f.tx, 0);
+  CHECK(jr_bulk_tx_pump(&f.tx) == JR_BULK_DONE);
+  CHECK(f.loop.accepted.size() > 4);
+
+  // Lose SDUs 1 and 2 between the transport and the receiver
+  Received r = {};
+  jr_bulk_rx_init(&r.rx);
+  for (size_t i = 0; i < f.loop.accepted.size(); i++) {
+    if (i != 1 && i != 2) {
+      receive(r, f.loop.accepted[i]);
+    }
+  }
+  CHECK(r.rx.lost == 2);
+  CHECK(r.rx.done);
+
+  // Sequence numbers wrap at 16 bits
+  uint8_t sdu[JR_BULK_HEADER_SIZE] = {JR_BULK_DATA, 0, 0, 0};
+  const uint8_t *records;
+  size_t len;
+  jr_bulk_rx_init(&r.rx);
+  r.rx.next_seq = 0xFFFE;
+  for (uint16_t seq : {0xFFFE, 0xFFFF, 0x0001}) {
+    sdu[2] = (uint8_t)seq;
+    sdu[3] = (uint8_t)(seq >> 8);
+    CHECK(jr_bulk_rx_sdu(&r.rx, sdu, sizeof(sdu), &records, &len) ==
+          JR_BULK_DATA);
+  }
+  CHECK(r.rx.lost == 1);
+  CHECK(r.rx.next_seq == 2);
+}
+
+static void testMalformed() {
+  jr_bulk_rx_t rx;
+  jr_bulk_rx_init(&rx);
+  const uint8_t *records;
+  size_t len;
+
+  const uint8_t shortSdu[3] = {JR_BULK_DATA, 0, 0};
+  CHECK(jr_bulk_rx_sdu(&rx, shortSdu, sizeof(shortSdu), &records, &len) == -1);
+  const uint8_t badType[4] = {0x42, 0, 0, 0};
+  CHECK(jr_bulk_rx_sdu(&rx, badType, sizeof(badType), &records, &len) == -1);
+  const uint8_t shortEnd[6] = {JR_BULK_END, 0, 0, 0, 1, 0};
+  CHECK(jr_bulk_rx_sdu(&rx, shortEnd, sizeof(shortEnd), &records, &len) == -1);
+  CHECK(rx.malformed == 3);
+  CHECK(rx.sdus == 0);
+  CHECK(!rx.done);
+}
+
+static void testTinyBufferFails() {
+  Fixture f(0, 10, JR_BULK_END_SIZE - 1);
+  jr_bulk_tx_start(&f.tx, 0);
+  CHECK(f.tx.state == JR_BULK_FAILED);
+  CHECK(jr_bulk_tx_pump(&f.tx) == JR_BULK_FAILED);
+  CHECK(f.loop.calls == 0);
+}
+
+int main() {
+  testPlainTransfer();
+  testBusyOffersSameSdu();
+  testStallWaitsForCredits();
+  testErrorResumesFromCursor();
+  testEndCarriesResumeCursor();
+  testSeqGaps();
+  testMalformed();
+  testTinyBufferFails();
+
+  if (failures) {
+    fprintf(stderr, "%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("jr_bulk: all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ * tools/jr_raw_decode.cpp
+ *
+ * Host-side decoder for raw streaming captures (see
+ * components/ble/jr_raw_codec.h). Reads a capture made by the web app's
+ * "Save raw capture" (each frame stored as u16 little-endian length followed
+ * by the notification bytes), prints samples as CSV on stdout and a
+ * throughput / loss report on stderr.
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 -Icomponents/ble tools/jr_raw_decode.cpp \
+ *       components/ble/jr_raw_codec.cpp -o jr_raw_decode
+ *
+ * Usage:
+ *   ./jr_raw_decode capture.bin > samples.csv
+ */
+
+#include "jr_raw_codec.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <vector>
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <capture.bin>\n", argv[0]);
+    return 2;
+  }
+
+  FILE *f = fopen(argv[1], "rb");
+  if (!f) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  uint32_t frames = 0, badFrames = 0, lostFrames = 0;
+  uint64_t samples = 0, bytes = 0, lateSamples = 0;
+  uint64_t firstUs = 0, lastUs = 0; // unwrapped sample time
+  uint32_t prevTs = 0;
+  uint16_t prevSeq = 0;
+  uint16_t periodUs = 0;
+  bool haveSample = false;
+  std::vector<uint8_t> frame;
+  jr_raw_sample_t out[UINT8_MAX];
+
+  printf("t_us,ax,ay,az\n");
+
+  uint8_t lenBytes[2];
+  while (fread(lenBytes, 1, sizeof(lenBytes), f) == sizeof(lenBytes)) {
+    const uint16_t len = (uint16_t)(lenBytes[0] | (lenBytes[1] << 8));
+    frame.resize(len);
+    if (fread(frame.data(), 1, len, f) != len) {
+      fprintf(stderr, "truncated capture\n");
+      break;
+    }
+
+    jr_raw_frame_info_t info;
+    const int n = jr_raw_decode(frame.data(), len, &info, out, UINT8_MAX);
+    if (n < 0) {
+      badFrames++;
+      continue;
+    }
+
+    if (frames > 0) {
+      lostFrames += (uint16_t)(info.seq - prevSeq - 1);
+    }
+    prevSeq = info.seq;
+    periodUs = info.period_us;
+    frames++;
+    bytes += len;
+
+    for (int i = 0; i < n; i++) {
+      const jr_raw_sample_t &s = out[i];
+      if (!haveSample) {
+        firstUs = lastUs = s.ts_us;
+        haveSample = true;
+      } else {
+        const uint32_t dt = s.ts_us - prevTs; // wraps with the device clock
+        if (periodUs && dt > periodUs + periodUs / 2) {
+          lateSamples += (dt + periodUs / 2) / periodUs - 1;
+        }
+        lastUs += dt;
+      }
+      prevTs = s.ts_us;
+      samples++;
+
+      printf("%" PRIu64 ",", lastUs - firstUs);
+      for (uint8_t c = 0; c < info.channels; c++) {
+        printf(c + 1 < info.channels ? "%d," : "%d\n", s.v[c]);
+      }
+    }
+  }
+  fclose(f);
+
+  const double seconds = (lastUs - firstUs) / 1e6;
+  const double expected = samples + lateSamples;
+  fprintf(stderr, "frames:      %" PRIu32 " (%" PRIu32 " lost, %" PRIu32
+                  " malformed)\n",
+          frames, lostFrames, badFrames);
+  fprintf(stderr, "samples:     %" PRIu64 " over %.2f s\n", samples, seconds);
+  if (seconds > 0) {
+    fprintf(stderr, "throughput:  %.1f samples/s, %.0f B/s\n",
+            samples / seconds, bytes / seconds);
+  }
+  if (samples > 0) {
+    fprintf(stderr, "size:        %.2f B/sample (incl. headers)\n",
+            (double)bytes / samples);
+    fprintf(stderr, "missing:     %" PRIu64 " samples (%.2f%%)\n",
+            lateSamples, 100.0 * lateSamples / expected);
+  }
+  return 0;
+}
@@ -0,0 +1,246 @@
+/*
+ * tools/jr_schema_gen.cpp
+ *
+ * Generates the web client's telemetry decoder from the record schema in
+ * components/ble/jr_telemetry.h, and checks the C codec against it.
+ *
+ * Without arguments, prints app/public/jr_telemetry.js on stdout. With
+ * --check, round-trips random records of every version through
+ * jr_telemetry_pack/unpack and the in-place accessors, then times the codec
+ * (ns per record); exits non-zero on any mismatch.
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 -Icomponents/ble tools/jr_schema_gen.cpp \
+ *       components/ble/jr_telemetry.cpp -o jr_schema_gen
+ *
+ * Usage:
+ *   ./jr_schema_gen > app/public/jr_telemetry.js
+ *   ./jr_schema_gen --check
+ */
+
+#include "jr_telemetry.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+static const char *jsGetter(uint8_t size) {
+  switch (size) {
+  case 1:
+    return "getUint8";
+  case 2:
+    return "getUint16";
+  case 4:
+    return "getUint32";
+  default:
+    return "getBigUint64";
+  }
+}
+
+// u64 fields become Numbers: exact up to 2^53 (285 years of microseconds).
+static std::string jsRead(const jr_tm_field_t &f) {
+  char buf[64];
+  const bool big = f.size == 8;
+  snprintf(buf, sizeof(buf), "%sv.%s(off + %u%s)%s", big ? "Number(" : "",
+           jsGetter(f.size), (unsigned)f.offset, f.size > 1 ? ", true" : "",
+           big ? ")" : "");
+  return buf;
+}
+
+static void printJs() {
+  printf("// Generated by tools/jr_schema_gen from components/ble/"
+         "jr_telemetry.h; do not edit.\n");
+  printf("// Telemetry records are little-endian and read in place from the "
+         "notification's\n// DataView.\n\n");
+
+  printf("const JR_TELEMETRY_VERSION = %d;\n\n", JR_TELEMETRY_VERSION);
+
+  printf("// Bytes per record, by version\nconst JR_TELEMETRY_SIZE = [0");
+  for (uint8_t v = 1; v <= JR_TELEMETRY_VERSION; v++) {
+    printf(", %u", (unsigned)jr_telemetry_size(v));
+  }
+  printf("];\n\n");
+
+  printf("const JR_TM_F = {\n");
+  for (size_t i = 0; i < jr_telemetry_flag_count; i++) {
+    const jr_tm_flag_t &f = jr_telemetry_flags[i];
+    printf("    %s: 0x%02x, // %s\n", f.name, 1u << f.bit, f.doc);
+  }
+  printf("};\n\n");
+
+  printf("// Field readers: jrTm.<field>(view, record offset)\n");
+  printf("const jrTm = {\n");
+  for (size_t i = 0; i < jr_telemetry_field_count; i++) {
+    const jr_tm_field_t &f = jr_telemetry_fields[i];
+    printf("    %s: (v, off) => %s, // v%u+: %s\n", f.name, jsRead(f).c_str(),
+           (unsigned)f.since, f.doc);
+  }
+  printf("};\n\n");
+
+  printf("// Decodes the record at off; fields newer than version are left "
+         "out.\n");
+  printf("function jrTelemetryDecode(v, off, version) {\n");
+  printf("    const r = {};\n");
+  for (uint8_t since = 1; since <= JR_TELEMETRY_VERSION; since++) {
+    const char *indent = since == 1 ? "    " : "        ";
+    if (since > 1) {
+      printf("    if (version >= %u) {\n", (unsigned)since);
+    }
+    for (size_t i = 0; i < jr_telemetry_field_count; i++) {
+      const jr_tm_field_t &f = jr_telemetry_fields[i];
+      if (f.since == since) {
+        printf("%sr.%s = %s;\n", indent, f.name, jsRead(f).c_str());
+      }
+    }
+    if (since > 1) {
+      printf("    }\n");
+    }
+  }
+  printf("    return r;\n}\n");
+}
+
+static jr_telemetry_t randomRecord(std::mt19937 &rng) {
+  jr_telemetry_t t;
+#define JR_TM_RANDOM(name, type, offset, since, doc)                           \
+  t.name = (jr_tm_##type##_t)(((uint64_t)rng() << 32) | rng());
+  JR_TELEMETRY_FIELDS(JR_TM_RANDOM)
+#undef JR_TM_RANDOM
+  return t;
+}
+
+// Expected unpack result: fields newer than version read as 0.
+static jr_telemetry_t truncated(const jr_telemetry_t &t, uint8_t version) {
+  jr_telemetry_t out;
+  memset(&out, 0, sizeof(out));
+#define JR_TM_TRUNC(name, type, offset, since, doc)                            \
+  if ((since) <= version) {                                                    \
+    out.name = t.name;                                                         \
+  }
+  JR_TELEMETRY_FIELDS(JR_TM_TRUNC)
+#undef JR_TM_TRUNC
+  return out;
+}
+
+static bool sameRecord(const jr_telemetry_t &a, const jr_telemetry_t &b) {
+  bool same = true;
+#define JR_TM_SAME(name, type, offset, since, doc)                             \
+  same = same && a.name == b.name;
+  JR_TELEMETRY_FIELDS(JR_TM_SAME)
+#undef JR_TM_SAME
+  return same;
+}
+
+static int check() {
+  std::mt19937 rng(12345);
+  uint32_t failures = 0;
+  const int rounds = 100000;
+
+  for (uint8_t v = 1; v <= JR_TELEMETRY_VERSION; v++) {
+    const size_t size = jr_telemetry_size(v);
+    for (int i = 0; i < rounds; i++) {
+      const jr_telemetry_t t = randomRecord(rng);
+      uint8_t buf[JR_TELEMETRY_MAX_SIZE + 1];
+      memset(buf, 0xEE, sizeof(buf));
+
+      jr_telemetry_t back;
+      bool ok = jr_telemetry_pack(&t, v, buf, sizeof(buf)) == size &&
+                buf[size] == 0xEE && // nothing written past the record
+                jr_telemetry_unpack(buf, size, v, &back) &&
+                sameRecord(back, truncated(t, v));
+
+      // Older decoders read the prefix of a newer record
+      for (uint8_t older = 1; ok && older < v; older++) {
+        ok = jr_telemetry_unpack(buf, size, older, &back) &&
+             sameRecord(back, truncated(t, older));
+      }
+      // In-place accessors agree with the codec
+      ok = ok && jr_tm_get_jump_count(buf) == t.jump_count &&
+           jr_tm_get_spo2_pct(buf) == t.spo2_pct &&
+           (v < 3 || jr_tm_get_event_us(buf) == t.event_us);
+
+      if (!ok && failures++ < 5) {
+        fprintf(stderr, "round-trip mismatch (v%u, record %d)\n", (unsigned)v,
+                i);
+      }
+    }
+
+    // Size guards
+    uint8_t small[JR_TELEMETRY_MAX_SIZE];
+    jr_telemetry_t t = randomRecord(rng);
+    if (jr_telemetry_pack(&t, v, small, size - 1) != 0 ||
+        jr_telemetry_unpack(small, size - 1, v, &t)) {
+      fprintf(stderr, "v%u: short buffer accepted\n", (unsigned)v);
+      failures++;
+    }
+  }
+  if (jr_telemetry_size(0) != 0 ||
+      jr_telemetry_size(JR_TELEMETRY_VERSION + 1) != 0) {
+    fprintf(stderr, "unknown version has a size\n");
+    failures++;
+  }
+
+  // Throughput: pack/unpack a notification's worth of records repeatedly
+  const size_t batch = 15;
+  const int iterations = 200000;
+  std::vector<jr_telemetry_t> recs(batch);
+  for (jr_telemetry_t &t : recs) {
+    t = randomRecord(rng);
+  }
+  std::vector<uint8_t> wire(batch * JR_TELEMETRY_MAX_SIZE);
+  volatile uint32_t sink = 0;
+
+  for (uint8_t v = 1; v <= JR_TELEMETRY_VERSION; v++) {
+    const size_t size = jr_telemetry_size(v);
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int it = 0; it < iterations; it++) {
+      recs[it % batch].seq = (uint32_t)it;
+      for (size_t i = 0; i < batch; i++) {
+        jr_telemetry_pack(&recs[i], v, &wire[i * size], size);
+      }
+      sink = sink + wire[it % wire.size()];
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int it = 0; it < iterations; it++) {
+      for (size_t i = 0; i < batch; i++) {
+        jr_telemetry_t t;
+        jr_telemetry_unpack(&wire[i * size], size, v, &t);
+        sink = sink + t.jump_count;
+      }
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    for (int it = 0; it < iterations; it++) {
+      for (size_t i = 0; i < batch; i++) {
+        sink = sink + jr_tm_get_jump_count(&wire[i * size]);
+      }
+    }
+    auto t3 = std::chrono::steady_clock::now();
+
+    const double n = (double)iterations * batch;
+    auto ns = [n](std::chrono::steady_clock::duration d) {
+      return std::chrono::duration<double, std::nano>(d).count() / n;
+    };
+    printf("v%u (%zu B): pack %.2f ns/record, unpack %.2f ns/record, "
+           "in-place field read %.2f ns\n",
+           (unsigned)v, size, ns(t1 - t0), ns(t2 - t1), ns(t3 - t2));
+  }
+
+  printf("%s (%u mismatches)\n", failures ? "FAILED" : "OK",
+         (unsigned)failures);
+  return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "--check") == 0) {
+    return check();
+  }
+  if (argc > 1) {
+    fprintf(stderr, "usage: %s [--check]\n", argv[0]);
+    return 2;
+  }
+  printJs();
+  return 0;
+}